@@ -2,7 +2,8 @@
 
 #include <sys/cdefs.h>
 #include <stdio.h>
-/* #include <time.h> */
+#include <string.h>
+#include <time.h>
 #include "lwip/netif.h"
 #include "netif/ethernet.h"
 #include "lwip/dhcp.h"
@@ -14,7 +15,25 @@
 #include "lwip/tcpip.h"
 #endif
 #include "lwip/apps/sntp.h"
+#include "lwip/apps/lwiperf.h"
+#if LWIP_GRO
+#include "netif/gro.h"
+#endif
+#include "boot.h"
+#if USE_HOST
+#include <signal.h>
+#include "netif/tapif.h"
+#include "netif/pcapif_replay.h"
+#include "netif/shmif.h"
+#else
 #include "eth_driver.h"
+#include "profiler.h"
+#include "trace.h"
+#include "uart.h"
+#endif
+#if LWIP_PERF
+#include "perfhist.h"		/* PERF_START/PERF_STOP come with lwip/def.h */
+#endif
 
 /* XXX Setup full debugging. Also locking not used until now. */
 /* XXX Test re-initializing of network devices. */
@@ -29,6 +48,7 @@
  * ntp client code on compile time, so define our own: */
 #define LWIP_SNTP 1
 
+#if !USE_HOST
 /* versatilepb maps LAN91C111 registers here */
 static void * const eth0_addr = (void * const) 0x10010000UL;
 
@@ -38,9 +58,17 @@ static s_lan91c111_state sls = {
   .tx_packet = 0,
   .irq_onoff = 0
 };
+#endif
 
 /* XXX check LWIP_SINGLE_NETIF: */
 static struct netif e0netif;
+#if USE_HOST
+/* Where e0 gets its frames from on the host */
+#define HOST_TAP 0U
+#define HOST_REPLAY 1U		/* capture in PCAPIF_REPLAY */
+#define HOST_SHM 2U		/* shared memory ring in SHMIF */
+static unsigned int host_if;
+#endif
 #if LWIP_DHCP
 static struct dhcp e0netif_dhcp;
 #endif
@@ -50,6 +78,23 @@ static struct autoip e0netif_autoip;
 
 #define CONFIG_WAIT_FOR_IP 0
 
+/* Serve the binary trace ring on UDP port TRACE_UDP_PORT */
+#if USE_HOST
+#define CONFIG_TRACE_UDP 0
+#else
+#define CONFIG_TRACE_UDP 1
+#endif
+
+/* lwiperf server on port 5001 and echo on port 7, "make bench" builds
+ * with BENCH=1 to turn them on */
+#ifndef CONFIG_BENCH
+#define CONFIG_BENCH 0
+#endif
+
+#if CONFIG_BENCH
+void echo_init (void);
+#endif
+
 #if CONFIG_WAIT_FOR_IP
 static unsigned int wait_for_ip;
 static unsigned int sntp_started;
@@ -89,9 +134,11 @@ static void link_callback (struct netif *netif)
 }
 #endif
 
+#if !USE_HOST
 /* feed frames from driver to LwIP */
 static int process_frames (r16 *frame, int frame_len)
 {
+  PERF_START;
   /* XXX seems adding ETH_PAD_SIZE is not required here: */
   struct pbuf *p = pbuf_alloc(PBUF_RAW, frame_len + ETH_PAD_SIZE, PBUF_POOL);
   if (NULL != p) {
@@ -107,7 +154,12 @@ static int process_frames (r16 *frame, int frame_len)
       (void) pbuf_add_header(p, ETH_PAD_SIZE);
 #endif
       /* XXX dynamically find correct device, check e0netif.input != NULL */
+#if LWIP_GRO
+      /* merge TCP segments of one RX batch, flushed in start_lwip() */
+      if (ERR_OK != gro_input(p, &e0netif)) {
+#else
       if (ERR_OK != e0netif.input(p, &e0netif)) {
+#endif
         (void) pbuf_free(p);
         LINK_STATS_INC(link.drop);
       }
@@ -116,24 +168,34 @@ static int process_frames (r16 *frame, int frame_len)
     LINK_STATS_INC(link.memerr);
     LINK_STATS_INC(link.drop);
   }
+  PERF_STOP("process_frames");
   return 0;
 }
 
 /* transmit frames from LwIP using driver */
 static err_t netif_output (struct netif *netif __unused, struct pbuf *p)
 {
+  PERF_START;
   unsigned int length = p->tot_len - ETH_PAD_SIZE;
   unsigned char mac_send_buffer[length];		/* XXX stack needs to be big enough */
+  err_t err = ERR_OK;
 
   LWIP_UNUSED_ARG(netif);
-  LINK_STATS_INC(link.xmit);
   if (length != pbuf_copy_partial(p, mac_send_buffer, length, ETH_PAD_SIZE)) {
+    /* do not send a truncated frame; leave through PERF_STOP below */
     LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("netif_output: not copying whole packet: %u\n", length));
+    LINK_STATS_INC(link.err);
+    LINK_STATS_INC(link.drop);
+    err = ERR_BUF;
+  } else {
+    LINK_STATS_INC(link.xmit);
+    nr_lan91c111_tx_frame(eth0_addr, &sls, mac_send_buffer, length);
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("netif_output: sending ethernet frame with size: %u\n", length));
   }
-  nr_lan91c111_tx_frame(eth0_addr, &sls, mac_send_buffer, length);
-  LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("netif_output: sending ethernet frame with size: %u\n", length));
-  return ERR_OK;
+  PERF_STOP("netif_output");
+  return err;
 }
+#endif /* !USE_HOST */
 
 #if 0
 /* XXX unused? */
@@ -255,6 +317,20 @@ static __always_inline unsigned int get_mode (netdev_config_t *dev)
 static err_t mynetif_init (struct netif *netif)
 {
   netdev_config_t *dev = netif->state;
+#if USE_HOST
+  /* the host driver brings its own output functions and netif->state */
+  err_t err;
+  if (host_if == HOST_REPLAY) {
+    err = pcapif_replay_init(netif);
+  } else if (host_if == HOST_SHM) {
+    err = shmif_init(netif);
+  } else {
+    err = tapif_init(netif);
+  }
+  if (ERR_OK != err) {
+    return err;
+  }
+#endif
 
 #if LWIP_NETIF_HOSTNAME
   /* LWIP_NETIF_HOSTNAME should not be set. If this is set and also LWIP_DHCP_DISCOVER_ADD_HOSTNAME
@@ -262,8 +338,10 @@ static err_t mynetif_init (struct netif *netif)
   netif->hostname = "lwip";
   #warning "LWIP_NETIF_HOSTNAME should not be set"
 #endif
+#if !USE_HOST
   netif->linkoutput = &netif_output;
   netif->output = &etharp_output;
+#endif
   netif->mtu = 1500U; 					/* u16 in lwip */
   if (0U != dev->mtu) {
     netif->mtu = dev->mtu;
@@ -433,8 +511,45 @@ static void net_config_read (void)
 {
   /* Read in the network configuration for a specific network device. */
   /* Change e0 with new values. */
+#if USE_HOST
+  /* Replaying a capture: fixed address instead of DHCP, see pcapif_replay.h */
+  if (host_if == HOST_REPLAY) {
+#if CONFIG_EXTRA_IP_TYPE
+    e0.mode = NET_STATIC;
+#endif
+    IP4_ADDR(&e0.ipaddr, 10, 0, 2, 99);
+    IP4_ADDR(&e0.netmask, 255, 255, 0, 0);
+    IP4_ADDR(&e0.gw, 10, 0, 0, 1);
+  }
+  /* Shared memory: 10.0.3.<port + 1>/24 and the MAC of the port, see shmif.h */
+  if (host_if == HOST_SHM) {
+    const char *port = getenv("SHMIF_PORT");
+#if CONFIG_EXTRA_IP_TYPE
+    e0.mode = NET_STATIC;
+#endif
+    IP4_ADDR(&e0.ipaddr, 10, 0, 3, (NULL != port) ? atoi(port) + 1 : 1);
+    IP4_ADDR(&e0.netmask, 255, 255, 255, 0);
+    ip4_addr_set_zero(&e0.gw);
+    (void) memset(e0.hwaddr, 0, sizeof(e0.hwaddr));
+  }
+#endif
 }
 
+#if CONFIG_BENCH
+static void lwiperf_report (void *arg, enum lwiperf_report_type report_type,
+  const ip_addr_t *local_addr, u16_t local_port, const ip_addr_t *remote_addr,
+  u16_t remote_port, u32_t bytes_transferred, u32_t ms_duration, u32_t bandwidth_kbitpsec)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(local_addr);
+  LWIP_UNUSED_ARG(local_port);
+  LWIP_UNUSED_ARG(remote_addr);
+  LWIP_UNUSED_ARG(remote_port);
+  printf("lwiperf: report %d, %lu bytes in %lu ms, %lu kbit/s\n", (int) report_type,
+    (unsigned long) bytes_transferred, (unsigned long) ms_duration, (unsigned long) bandwidth_kbitpsec);
+}
+#endif
+
 #if NO_SYS
 static void lwip_config_init (void)
 #else
@@ -443,8 +558,10 @@ static void lwip_config_init (void *init_sem)
 {
   net_config_read();
 
+#if !USE_HOST
   nr_lan91c111_reset(eth0_addr, &sls, &sls);
   (void) nr_lan91c111_set_promiscuous(eth0_addr, &sls, 1);
+#endif
 
 #if CONFIG_WAIT_FOR_IP
   sntp_started = 0U;
@@ -465,6 +582,14 @@ static void lwip_config_init (void *init_sem)
 #endif
 #endif
 
+#if CONFIG_TRACE_UDP
+  trace_udp_init();
+#endif
+#if CONFIG_BENCH
+  (void) lwiperf_start_tcp_server_default(lwiperf_report, NULL);
+  echo_init();
+#endif
+
 #if !NO_SYS
   sys_sem_signal((sys_sem_t *) init_sem);
 #endif
@@ -473,6 +598,65 @@ static void lwip_config_init (void *init_sem)
 /* Change from debugger to exit: */
 static volatile unsigned int keep_running = 1U;
 
+#if USE_HOST
+/* Ctrl-C ends the main loop, so gprof gets a normal exit to write gmon.out */
+static void stop_running (int sig)
+{
+  (void) sig;
+  keep_running = 0U;
+}
+#endif
+
+/* Report time-to-network once the first IP address is configured. */
+static void boot_check_ip (void)
+{
+  if (!boot_stamped(BOOT_FIRST_IP) && !ip4_addr_isany_val(*netif_ip4_addr(&e0netif))) {
+    boot_stamp(BOOT_FIRST_IP);
+    boot_report();
+  }
+}
+
+#if NO_SYS
+static void check_timeouts (void)
+{
+  PERF_START;
+  sys_check_timeouts();
+  PERF_STOP("sys_check_timeouts");
+}
+#endif
+
+#if !USE_HOST
+/* Single key commands on the serial console. */
+static void console_poll (void)
+{
+  switch (uart_getc()) {
+  case 't':
+    trace_dump();
+    break;
+  case 's':
+    if (prof_running()) {
+      prof_stop();
+    } else {
+      prof_start();
+    }
+    break;
+  case 'd':
+    prof_dump();
+    break;
+#if LWIP_PERF
+  case 'p':
+    perf_dump();
+    break;
+  case 'r':
+    perf_reset();
+    break;
+#endif
+  default:
+    break;
+  }
+}
+#endif
+
 void start_lwip (void)
 {
 #if !NO_SYS
@@ -483,12 +667,43 @@ void start_lwip (void)
   srand((unsigned int)time(NULL));
   /* XXX srand(read_rtc()); */
 
+#if USE_HOST
+  (void) signal(SIGINT, stop_running);
+  if (NULL != getenv("PCAPIF_REPLAY")) {
+    host_if = HOST_REPLAY;
+  } else if (NULL != getenv("SHMIF")) {
+    host_if = HOST_SHM;
+  }
+#endif
+
 #if NO_SYS
   lwip_init();
+  boot_stamp(BOOT_LWIP_INIT);
   lwip_config_init();
   while (keep_running) {
+#if USE_HOST
+    if (host_if == HOST_REPLAY) {
+      if (0 == pcapif_replay_poll(&e0netif)) {
+        keep_running = 0U;
+      }
+    } else if (host_if == HOST_SHM) {
+      /* sleeps until a frame is queued or the next timeout is due */
+      (void) shmif_select(&e0netif);
+    } else {
+      /* sleeps until a frame arrives or the next timeout is due */
+      (void) tapif_select(&e0netif);
+    }
+#else
     (void) nr_lan91c111_check_for_events(eth0_addr, &sls, process_frames);
-    sys_check_timeouts();
+#endif
+#if LWIP_GRO
+    gro_flush();
+#endif
+    check_timeouts();
+    boot_check_ip();
+#if !USE_HOST
+    console_poll();
+#endif
     /* XXX netif_poll_all(); */
   }
 #else
@@ -498,7 +713,21 @@ void start_lwip (void)
   tcpip_init(lwip_config_init, &init_sem);
   sys_sem_wait(&init_sem);
   sys_sem_free(&init_sem);
+  boot_stamp(BOOT_LWIP_INIT);
   while (keep_running) {
+    boot_check_ip();
+#if USE_HOST
+    if (host_if == HOST_REPLAY && 0 == pcapif_replay_poll(&e0netif)) {
+      keep_running = 0U;
+    }
+#else
+    console_poll();
+#endif
+  }
+#endif
+#if USE_HOST
+  if (host_if == HOST_REPLAY) {
+    pcapif_replay_report(&e0netif);
   }
 #endif
   netdev_config_remove(&e0, &e0netif, &e0netif_dhcp, &e0netif_autoip);
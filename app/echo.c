@@ -0,0 +1,133 @@
+/* UDP and TCP echo (RFC 862) on port ECHO_PORT for the latency and packet
+ * rate measurements of "make bench". */
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+#define ECHO_PORT 7U
+
+void echo_init (void);
+
+#if LWIP_UDP
+static void echo_udp_recv (void *arg, struct udp_pcb *pcb, struct pbuf *p,
+  const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  (void) udp_sendto(pcb, p, addr, port);
+  (void) pbuf_free(p);
+}
+#endif
+
+#if LWIP_TCP
+/* Queue as much of the pending data (kept in the pcb's arg) as fits into
+ * the send buffer and free what was queued. */
+static void echo_tcp_send (struct tcp_pcb *pcb)
+{
+  struct pbuf *p = pcb->callback_arg;
+
+  while (p != NULL && p->len <= tcp_sndbuf(pcb)) {
+    struct pbuf *next = p->next;
+    if (ERR_OK != tcp_write(pcb, p->payload, p->len, TCP_WRITE_FLAG_COPY)) {
+      break;
+    }
+    tcp_recved(pcb, p->len);
+    if (next != NULL) {
+      pbuf_ref(next);
+    }
+    (void) pbuf_free(p);
+    p = next;
+  }
+  tcp_arg(pcb, p);
+  (void) tcp_output(pcb);
+}
+
+static err_t echo_tcp_sent (void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(len);
+  if (arg != NULL) {
+    echo_tcp_send(pcb);
+  }
+  return ERR_OK;
+}
+
+static err_t echo_tcp_recv (void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct pbuf *pending = arg;
+
+  if (p == NULL || err != ERR_OK) {
+    if (p != NULL) {
+      (void) pbuf_free(p);
+    }
+    if (pending != NULL) {
+      (void) pbuf_free(pending);
+    }
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    if (ERR_OK != tcp_close(pcb)) {
+      tcp_abort(pcb);
+      return ERR_ABRT;
+    }
+    return ERR_OK;
+  }
+  if (pending != NULL) {
+    pbuf_cat(pending, p);
+  } else {
+    tcp_arg(pcb, p);
+  }
+  echo_tcp_send(pcb);
+  return ERR_OK;
+}
+
+static void echo_tcp_err (void *arg, err_t err)
+{
+  LWIP_UNUSED_ARG(err);
+  /* the pcb is already gone */
+  if (arg != NULL) {
+    (void) pbuf_free((struct pbuf *)arg);
+  }
+}
+
+static err_t echo_tcp_accept (void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  if (err != ERR_OK || pcb == NULL) {
+    return ERR_VAL;
+  }
+  tcp_nagle_disable(pcb);
+  tcp_arg(pcb, NULL);
+  tcp_recv(pcb, echo_tcp_recv);
+  tcp_sent(pcb, echo_tcp_sent);
+  tcp_err(pcb, echo_tcp_err);
+  return ERR_OK;
+}
+#endif
+
+void echo_init (void)
+{
+#if LWIP_UDP
+  struct udp_pcb *upcb = udp_new();
+  if (upcb != NULL) {
+    if (ERR_OK == udp_bind(upcb, IP_ANY_TYPE, ECHO_PORT)) {
+      udp_recv(upcb, echo_udp_recv, NULL);
+    } else {
+      udp_remove(upcb);
+    }
+  }
+#endif
+#if LWIP_TCP
+  {
+    struct tcp_pcb *tpcb = tcp_new();
+    if (tpcb != NULL) {
+      if (ERR_OK == tcp_bind(tpcb, IP_ANY_TYPE, ECHO_PORT)) {
+        tpcb = tcp_listen(tpcb);
+        tcp_accept(tpcb, echo_tcp_accept);
+      } else {
+        (void) tcp_close(tpcb);
+      }
+    }
+  }
+#endif
+}
@@ -1,6 +1,24 @@
+#include "boot.h"
+#include "fastmem.h"
+#if !USE_HOST
+#include "irq.h"
+#include "uart.h"
+#endif
+
+/* Compare fast_memcpy() with the C library before starting the network */
+#define CONFIG_MEM_BENCH 0
+
 void start_lwip(void);
 
 int main (void)
 {
+  boot_stamp(BOOT_MAIN);
+#if !USE_HOST
+  irq_init();
+  uart_init();
+#endif
+#if CONFIG_MEM_BENCH
+  fastmem_bench();
+#endif
   start_lwip();
 }
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 lwIP contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_PCAPIF_REPLAY_H
+#define LWIP_PCAPIF_REPLAY_H
+
+#include "lwip/netif.h"
+
+/*
+ * Replays an Ethernet pcap file into netif->input.
+ *
+ * Configured from the environment when the netif is added:
+ *   PCAPIF_REPLAY=file         capture to replay (required)
+ *   PCAPIF_REPLAY_PACED=1      keep the recorded inter-frame gaps
+ *   PCAPIF_REPLAY_LOOPS=n      replay the capture n times (default 1)
+ *   PCAPIF_REPLAY_IP=a.b.c.d   address of the recorded device, the most
+ *                              frequent unicast IPv4 destination if unset
+ *
+ * Frames to the recorded device are rewritten to this netif's MAC and IPv4
+ * address, frames sent by it are left out.
+ */
+err_t pcapif_replay_init(struct netif *netif);
+/* Feeds the frames that are due, returns 0 when the replay is finished. */
+int pcapif_replay_poll(struct netif *netif);
+void pcapif_replay_report(struct netif *netif);
+
+#endif /* LWIP_PCAPIF_REPLAY_H */
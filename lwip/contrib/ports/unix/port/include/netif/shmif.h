@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 lwIP contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_SHMIF_H
+#define LWIP_SHMIF_H
+
+#include "lwip/netif.h"
+
+/*
+ * Ethernet between processes through a memory-mapped file, no root and no
+ * tap device needed. Every process attaches one port of the file:
+ *   SHMIF=path      shared file, created on first use (default SHMIF_DEFAULT_PATH)
+ *   SHMIF_PORT=n    port number 0..SHMIF_MAX_PORTS-1 (default 0)
+ * The MAC address is 02:12:34:56:79:<port>. Frames to unknown or group
+ * addresses go to all attached ports.
+ */
+#ifndef SHMIF_MAX_PORTS
+#define SHMIF_MAX_PORTS 4
+#endif
+
+err_t shmif_init(struct netif *netif);
+/* Feeds queued frames to netif->input, returns their number. */
+int shmif_poll(struct netif *netif);
+/* Sleeps until a frame is queued or msecs passed, returns 1 if frames are queued. */
+int shmif_wait(struct netif *netif, u32_t msecs);
+#if NO_SYS
+int shmif_select(struct netif *netif);
+#endif /* NO_SYS */
+
+#endif /* LWIP_SHMIF_H */
@@ -0,0 +1,706 @@
+/*
+ * Copyright (c) 2026 lwIP contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * pcap replay network interface.
+ *
+ * The capture is read into memory once and indexed, so the replay loop only
+ * copies each frame into a pool pbuf and calls netif->input(). The pcap file
+ * format is parsed here directly (microsecond and nanosecond variants, either
+ * byte order, link type Ethernet), libpcap is not needed.
+ *
+ * The time spent in netif->input() is accounted per protocol. With NO_SYS=0
+ * that is the tcpip_input() queueing only, so use NO_SYS=1 for cost numbers.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "lwip/opt.h"
+
+#include "lwip/debug.h"
+#include "lwip/def.h"
+#include "lwip/ip_addr.h"
+#include "lwip/mem.h"
+#include "lwip/stats.h"
+#include "lwip/snmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "netif/etharp.h"
+#include "lwip/ethip6.h"
+
+#include "netif/pcapif_replay.h"
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 'r'
+#define IFNAME1 'p'
+
+#ifndef PCAPIF_REPLAY_DEBUG
+#define PCAPIF_REPLAY_DEBUG LWIP_DBG_OFF
+#endif
+
+/* Frames fed per poll in fast mode, before timers get a chance to run. */
+#ifndef PCAPIF_REPLAY_BATCH
+#define PCAPIF_REPLAY_BATCH 64
+#endif
+
+#define PCAP_MAGIC_US   0xa1b2c3d4UL
+#define PCAP_MAGIC_NS   0xa1b23c4dUL
+#define PCAP_HDR_LEN    24
+#define PCAP_REC_LEN    16
+#define PCAP_LINKTYPE_ETHERNET 1
+
+#define FRAME_SKIP      0x01U
+
+enum replay_class {
+  REPLAY_ARP,
+  REPLAY_ICMP,
+  REPLAY_IGMP,
+  REPLAY_UDP,
+  REPLAY_TCP,
+  REPLAY_IPV6,
+  REPLAY_OTHER,
+  REPLAY_NUM_CLASSES
+};
+
+static const char * const replay_class_name[REPLAY_NUM_CLASSES] = {
+  "arp", "icmp", "igmp", "udp", "tcp", "ipv6", "other"
+};
+
+#if LWIP_STATS
+/* lwIP counters whose drops during the replay are reported */
+static const struct {
+  const char *name;
+  struct stats_proto *proto;
+} replay_stats[] = {
+#if LINK_STATS
+  { "link", &lwip_stats.link },
+#endif
+#if ETHARP_STATS
+  { "etharp", &lwip_stats.etharp },
+#endif
+#if IP_STATS
+  { "ip", &lwip_stats.ip },
+#endif
+#if ICMP_STATS
+  { "icmp", &lwip_stats.icmp },
+#endif
+#if UDP_STATS
+  { "udp", &lwip_stats.udp },
+#endif
+#if TCP_STATS
+  { "tcp", &lwip_stats.tcp },
+#endif
+  { NULL, NULL }
+};
+
+#define REPLAY_NUM_STATS LWIP_ARRAYSIZE(replay_stats)
+#endif /* LWIP_STATS */
+
+struct replay_frame {
+  size_t offset;
+  u32_t len;
+  u8_t flags;
+  u8_t cls;
+  u64_t ts_ns;
+};
+
+struct pcapif_replay {
+  u8_t *buf;
+  struct replay_frame *frames;
+  u32_t num_frames;
+  /* replay position */
+  u32_t next;
+  u32_t loop;
+  u32_t loops;
+  int paced;
+  int started;
+  u64_t start_ns;
+  u64_t loop_ns;
+  u64_t end_ns;
+  /* recorded device, replaced by this netif */
+  ip4_addr_t dev_ip;
+  int have_dev_ip;
+  u8_t dev_mac[ETH_HWADDR_LEN];
+  int have_dev_mac;
+  /* results */
+  u32_t truncated;
+  u32_t oversize;
+  u32_t from_dev;
+  u32_t fed;
+  u32_t alloc_drops;
+  u32_t tx;
+  u32_t cls_frames[REPLAY_NUM_CLASSES];
+  u32_t cls_errors[REPLAY_NUM_CLASSES];
+  u64_t cls_ns[REPLAY_NUM_CLASSES];
+#if LWIP_STATS
+  STAT_COUNTER drop0[REPLAY_NUM_STATS];
+#endif /* LWIP_STATS */
+};
+
+/*-----------------------------------------------------------------------------------*/
+static u64_t
+replay_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000U + (u64_t)ts.tv_nsec;
+}
+
+static u32_t
+replay_get32(const u8_t *p, int swap)
+{
+  if (swap) {
+    return ((u32_t)p[0] << 24) | ((u32_t)p[1] << 16) | ((u32_t)p[2] << 8) | p[3];
+  }
+  return ((u32_t)p[3] << 24) | ((u32_t)p[2] << 16) | ((u32_t)p[1] << 8) | p[0];
+}
+
+static u16_t
+replay_get16be(const u8_t *p)
+{
+  return (u16_t)((p[0] << 8) | p[1]);
+}
+
+/*
+ * RFC 1624 incremental checksum update for a 4 byte field that changes
+ * from 'from' to 'to'.
+ */
+static void
+replay_csum_adjust(u8_t *csum, const u8_t *from, const u8_t *to)
+{
+  u32_t sum = (u16_t)~replay_get16be(csum);
+
+  sum += (u16_t)~replay_get16be(from);
+  sum += (u16_t)~replay_get16be(from + 2);
+  sum += replay_get16be(to);
+  sum += replay_get16be(to + 2);
+  sum = (sum & 0xffffU) + (sum >> 16);
+  sum = (sum & 0xffffU) + (sum >> 16);
+  sum = ~sum & 0xffffU;
+  csum[0] = (u8_t)(sum >> 8);
+  csum[1] = (u8_t)sum;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * replay_load():
+ *
+ * Reads the whole capture and builds the frame index.
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+replay_load(struct pcapif_replay *r, const char *path)
+{
+  FILE *f;
+  long size;
+  size_t pos;
+  u32_t magic;
+  u32_t cap = 0;
+  int swap;
+  int nsec;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    perror("pcapif_replay_init: cannot open capture");
+    exit(1);
+  }
+  if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < PCAP_HDR_LEN ||
+      fseek(f, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "pcapif_replay_init: %s: not a pcap file\n", path);
+    exit(1);
+  }
+  r->buf = (u8_t *)malloc((size_t)size);
+  if (r->buf == NULL || fread(r->buf, 1, (size_t)size, f) != (size_t)size) {
+    perror("pcapif_replay_init: cannot read capture");
+    exit(1);
+  }
+  fclose(f);
+
+  magic = replay_get32(r->buf, 0);
+  swap = (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS);
+  magic = replay_get32(r->buf, swap);
+  if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+    fprintf(stderr, "pcapif_replay_init: %s: not a pcap file (pcapng is not supported)\n", path);
+    exit(1);
+  }
+  nsec = (magic == PCAP_MAGIC_NS);
+  if ((replay_get32(r->buf + 20, swap) & 0x0fffffffUL) != PCAP_LINKTYPE_ETHERNET) {
+    fprintf(stderr, "pcapif_replay_init: %s: link type is not Ethernet\n", path);
+    exit(1);
+  }
+
+  for (pos = PCAP_HDR_LEN; pos + PCAP_REC_LEN <= (size_t)size; ) {
+    struct replay_frame *frame;
+    u32_t caplen = replay_get32(r->buf + pos + 8, swap);
+    u32_t origlen = replay_get32(r->buf + pos + 12, swap);
+
+    if (caplen > (size_t)size - pos - PCAP_REC_LEN) {
+      /* cut off at the end of the file */
+      r->truncated++;
+      break;
+    }
+    if (r->num_frames == cap) {
+      cap = cap ? 2 * cap : 1024;
+      r->frames = (struct replay_frame *)realloc(r->frames, cap * sizeof(struct replay_frame));
+      if (r->frames == NULL) {
+        perror("pcapif_replay_init: frame index");
+        exit(1);
+      }
+    }
+    frame = &r->frames[r->num_frames++];
+    frame->offset = pos + PCAP_REC_LEN;
+    frame->len = caplen;
+    frame->flags = 0;
+    frame->cls = REPLAY_OTHER;
+    frame->ts_ns = (u64_t)replay_get32(r->buf + pos, swap) * 1000000000U +
+                   (u64_t)replay_get32(r->buf + pos + 4, swap) * (nsec ? 1U : 1000U);
+    if (caplen < origlen || caplen < SIZEOF_ETH_HDR) {
+      /* snaplen too small, the stack would see a damaged frame */
+      frame->flags |= FRAME_SKIP;
+      r->truncated++;
+    } else if (caplen > 0xffffU) {
+      frame->flags |= FRAME_SKIP;
+      r->oversize++;
+    }
+    pos += PCAP_REC_LEN + caplen;
+  }
+  LWIP_DEBUGF(PCAPIF_REPLAY_DEBUG, ("pcapif_replay_init: %"U32_F" frames\n", r->num_frames));
+}
+
+/* Offset of the layer 3 header, with the ethertype in *type. */
+static u32_t
+replay_l3(const u8_t *p, u32_t len, u16_t *type)
+{
+  u32_t off = SIZEOF_ETH_HDR;
+
+  *type = replay_get16be(p + 12);
+  if (*type == ETHTYPE_VLAN && len >= SIZEOF_ETH_HDR + 4) {
+    *type = replay_get16be(p + 16);
+    off += 4;
+  }
+  return off;
+}
+
+/* Most frequent unicast IPv4 destination, taken as the recorded device. */
+static void
+replay_find_dev_ip(struct pcapif_replay *r)
+{
+  u32_t addr[32];
+  u32_t count[32];
+  u32_t num = 0;
+  u32_t i, j, best = 0;
+
+  for (i = 0; i < r->num_frames; i++) {
+    const u8_t *p = r->buf + r->frames[i].offset;
+    u32_t len = r->frames[i].len;
+    u16_t type;
+    u32_t l3;
+    ip4_addr_t dst;
+
+    if ((r->frames[i].flags & FRAME_SKIP) || (p[0] & 0x01U)) {
+      continue;
+    }
+    l3 = replay_l3(p, len, &type);
+    if (type != ETHTYPE_IP || len < l3 + IP_HLEN) {
+      continue;
+    }
+    memcpy(&dst, p + l3 + 16, sizeof(dst));
+    if (ip4_addr_ismulticast(&dst) || dst.addr == IPADDR_BROADCAST) {
+      continue;
+    }
+    for (j = 0; j < num && addr[j] != dst.addr; j++) {
+    }
+    if (j == num) {
+      if (num == LWIP_ARRAYSIZE(addr)) {
+        continue;
+      }
+      addr[num] = dst.addr;
+      count[num++] = 0;
+    }
+    count[j]++;
+  }
+  for (j = 0; j < num; j++) {
+    if (count[j] > count[best]) {
+      best = j;
+    }
+  }
+  if (num > 0) {
+    r->dev_ip.addr = addr[best];
+    r->have_dev_ip = 1;
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * replay_rewrite():
+ *
+ * Moves the traffic of the recorded device over to this netif and sorts
+ * the frames into protocol classes. Runs once the netif is configured.
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+replay_rewrite(struct netif *netif, struct pcapif_replay *r)
+{
+  const u8_t *ip = (const u8_t *)netif_ip4_addr(netif);
+  u32_t i;
+
+  if (!r->have_dev_ip) {
+    replay_find_dev_ip(r);
+  }
+  if (r->have_dev_ip) {
+    /* the destination MAC of unicast frames to its address */
+    for (i = 0; i < r->num_frames && !r->have_dev_mac; i++) {
+      const u8_t *p = r->buf + r->frames[i].offset;
+      u16_t type;
+      u32_t l3 = replay_l3(p, r->frames[i].len, &type);
+
+      if (!(r->frames[i].flags & FRAME_SKIP) && type == ETHTYPE_IP &&
+          r->frames[i].len >= l3 + IP_HLEN && !(p[0] & 0x01U) &&
+          memcmp(p + l3 + 16, &r->dev_ip, 4) == 0) {
+        memcpy(r->dev_mac, p, ETH_HWADDR_LEN);
+        r->have_dev_mac = 1;
+      }
+    }
+  }
+
+  for (i = 0; i < r->num_frames; i++) {
+    struct replay_frame *frame = &r->frames[i];
+    u8_t *p = r->buf + frame->offset;
+    u32_t len = frame->len;
+    u16_t type;
+    u32_t l3;
+
+    if (frame->flags & FRAME_SKIP) {
+      continue;
+    }
+    if (r->have_dev_mac && memcmp(p, r->dev_mac, ETH_HWADDR_LEN) == 0) {
+      memcpy(p, netif->hwaddr, ETH_HWADDR_LEN);
+    }
+    l3 = replay_l3(p, len, &type);
+
+    if (type == ETHTYPE_ARP) {
+      frame->cls = REPLAY_ARP;
+      if (r->have_dev_ip && len >= l3 + 28) {
+        if (memcmp(p + l3 + 14, &r->dev_ip, 4) == 0) {
+          frame->flags |= FRAME_SKIP;
+          r->from_dev++;
+          continue;
+        }
+        if (memcmp(p + l3 + 24, &r->dev_ip, 4) == 0) {
+          memcpy(p + l3 + 24, ip, 4);
+          if (r->have_dev_mac && memcmp(p + l3 + 18, r->dev_mac, ETH_HWADDR_LEN) == 0) {
+            memcpy(p + l3 + 18, netif->hwaddr, ETH_HWADDR_LEN);
+          }
+        }
+      }
+    } else if (type == ETHTYPE_IPV6) {
+      frame->cls = REPLAY_IPV6;
+    } else if (type == ETHTYPE_IP && len >= l3 + IP_HLEN) {
+      u8_t *iph = p + l3;
+      u32_t hlen = (u32_t)(iph[0] & 0x0fU) * 4U;
+      u32_t l4 = l3 + hlen;
+      int first = ((replay_get16be(iph + 6) & IP_OFFMASK) == 0);
+
+      switch (iph[9]) {
+      case IP_PROTO_ICMP:
+        frame->cls = REPLAY_ICMP;
+        break;
+      case IP_PROTO_IGMP:
+        frame->cls = REPLAY_IGMP;
+        break;
+      case IP_PROTO_UDP:
+      case IP_PROTO_UDPLITE:
+        frame->cls = REPLAY_UDP;
+        break;
+      case IP_PROTO_TCP:
+        frame->cls = REPLAY_TCP;
+        break;
+      default:
+        break;
+      }
+      if (!r->have_dev_ip) {
+        continue;
+      }
+      if (memcmp(iph + 12, &r->dev_ip, 4) == 0) {
+        frame->flags |= FRAME_SKIP;
+        r->from_dev++;
+        continue;
+      }
+      if (memcmp(iph + 16, &r->dev_ip, 4) != 0 || hlen < IP_HLEN) {
+        continue;
+      }
+      /* the destination address is in the TCP/UDP pseudo header, too */
+      if (first && iph[9] == IP_PROTO_TCP && len >= l4 + 18) {
+        replay_csum_adjust(p + l4 + 16, iph + 16, ip);
+      } else if (first && iph[9] == IP_PROTO_UDP && len >= l4 + 8 &&
+                 replay_get16be(p + l4 + 6) != 0) {
+        replay_csum_adjust(p + l4 + 6, iph + 16, ip);
+        if (replay_get16be(p + l4 + 6) == 0) {
+          p[l4 + 6] = 0xff;
+          p[l4 + 7] = 0xff;
+        }
+      }
+      replay_csum_adjust(iph + 10, iph + 16, ip);
+      memcpy(iph + 16, ip, 4);
+    }
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct pcapif_replay *r = (struct pcapif_replay *)netif->state;
+
+  LWIP_UNUSED_ARG(p);
+
+  /* answers of the stack go nowhere, they are only counted */
+  r->tx++;
+  MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
+  return ERR_OK;
+}
+
+static void
+replay_feed(struct netif *netif, struct pcapif_replay *r, const struct replay_frame *frame)
+{
+  struct pbuf *p;
+  u64_t t0;
+  err_t err;
+
+  p = pbuf_alloc(PBUF_RAW, (u16_t)frame->len, PBUF_POOL);
+  if (p == NULL) {
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+    r->alloc_drops++;
+    return;
+  }
+  pbuf_take(p, r->buf + frame->offset, (u16_t)frame->len);
+  LINK_STATS_INC(link.recv);
+  MIB2_STATS_NETIF_ADD(netif, ifinoctets, frame->len);
+
+  t0 = replay_now_ns();
+  err = netif->input(p, netif);
+  r->cls_ns[frame->cls] += replay_now_ns() - t0;
+  r->cls_frames[frame->cls]++;
+  r->fed++;
+  if (err != ERR_OK) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_replay: netif input error\n"));
+    pbuf_free(p);
+    r->cls_errors[frame->cls]++;
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * pcapif_replay_init():
+ *
+ * Loads the capture named by PCAPIF_REPLAY and sets up the interface.
+ */
+/*-----------------------------------------------------------------------------------*/
+err_t
+pcapif_replay_init(struct netif *netif)
+{
+  struct pcapif_replay *r;
+  const char *path = getenv("PCAPIF_REPLAY");
+  const char *env;
+
+  if (path == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_replay_init: PCAPIF_REPLAY not set\n"));
+    return ERR_ARG;
+  }
+  r = (struct pcapif_replay *)calloc(1, sizeof(struct pcapif_replay));
+  if (r == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_replay_init: out of memory\n"));
+    return ERR_MEM;
+  }
+  env = getenv("PCAPIF_REPLAY_PACED");
+  r->paced = (env != NULL && atoi(env) != 0);
+  env = getenv("PCAPIF_REPLAY_LOOPS");
+  r->loops = (env != NULL && atoi(env) > 0) ? (u32_t)atoi(env) : 1U;
+  env = getenv("PCAPIF_REPLAY_IP");
+  if (env != NULL) {
+    if (!ip4addr_aton(env, &r->dev_ip)) {
+      fprintf(stderr, "pcapif_replay_init: bad PCAPIF_REPLAY_IP %s\n", env);
+      exit(1);
+    }
+    r->have_dev_ip = 1;
+  }
+  replay_load(r, path);
+
+  netif->state = r;
+  MIB2_INIT_NETIF(netif, snmp_ifType_other, 100000000);
+
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif /* LWIP_IPV6 */
+  netif->linkoutput = low_level_output;
+  netif->mtu = 1500;
+
+  /* (We just fake an address...) */
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 0x12;
+  netif->hwaddr[2] = 0x34;
+  netif->hwaddr[3] = 0x56;
+  netif->hwaddr[4] = 0x78;
+  netif->hwaddr[5] = 0xac;
+  netif->hwaddr_len = 6;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP;
+
+  netif_set_link_up(netif);
+
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+int
+pcapif_replay_poll(struct netif *netif)
+{
+  struct pcapif_replay *r = (struct pcapif_replay *)netif->state;
+  u64_t now;
+  int batch;
+
+  if (!r->started) {
+#if LWIP_STATS
+    size_t i;
+
+    for (i = 0; replay_stats[i].name != NULL; i++) {
+      r->drop0[i] = replay_stats[i].proto->drop;
+    }
+#endif /* LWIP_STATS */
+    replay_rewrite(netif, r);
+    r->started = 1;
+    r->start_ns = r->loop_ns = replay_now_ns();
+  }
+  if (r->loop >= r->loops) {
+    return 0;
+  }
+
+  now = r->paced ? replay_now_ns() : 0;
+  for (batch = 0; batch < PCAPIF_REPLAY_BATCH; batch++) {
+    const struct replay_frame *frame;
+
+    if (r->next == r->num_frames) {
+      r->next = 0;
+      r->loop_ns = replay_now_ns();
+      if (++r->loop >= r->loops || r->num_frames == 0) {
+        r->loop = r->loops;
+        r->end_ns = r->loop_ns;
+        return 0;
+      }
+    }
+    frame = &r->frames[r->next];
+    if (r->paced) {
+      /* captures are not always in time order: a frame stamped before
+       * the first one is due at once instead of ~584 years from now */
+      u64_t due = r->loop_ns + (frame->ts_ns > r->frames[0].ts_ns ?
+                                frame->ts_ns - r->frames[0].ts_ns : 0);
+
+      if (due > now) {
+        /* sleep at most 1ms, so the caller keeps the timers going */
+        struct timespec ts;
+        u64_t wait = LWIP_MIN(due - now, 1000000U);
+
+        ts.tv_sec = 0;
+        ts.tv_nsec = (long)wait;
+        nanosleep(&ts, NULL);
+        return 1;
+      }
+    }
+    r->next++;
+    if (!(frame->flags & FRAME_SKIP)) {
+      replay_feed(netif, r, frame);
+    }
+  }
+  return 1;
+}
+
+/*-----------------------------------------------------------------------------------*/
+void
+pcapif_replay_report(struct netif *netif)
+{
+  struct pcapif_replay *r = (struct pcapif_replay *)netif->state;
+  u64_t elapsed;
+  u32_t errors = 0;
+  size_t i;
+
+  if (!r->started) {
+    return;
+  }
+  elapsed = (r->end_ns ? r->end_ns : replay_now_ns()) - r->start_ns;
+  if (elapsed == 0) {
+    elapsed = 1;
+  }
+  for (i = 0; i < REPLAY_NUM_CLASSES; i++) {
+    errors += r->cls_errors[i];
+  }
+
+  printf("pcapif_replay: %"U32_F" frames x %"U32_F" loops, skipped %"U32_F" from device, "
+         "%"U32_F" truncated, %"U32_F" oversize\n", r->num_frames, r->loops, r->from_dev,
+         r->truncated, r->oversize);
+  if (r->have_dev_ip) {
+    char dev[IP4ADDR_STRLEN_MAX];
+    char own[IP4ADDR_STRLEN_MAX];
+
+    printf("pcapif_replay: device %s replaced by %s\n",
+           ip4addr_ntoa_r(&r->dev_ip, dev, sizeof(dev)),
+           ip4addr_ntoa_r(netif_ip4_addr(netif), own, sizeof(own)));
+  }
+  printf("pcapif_replay: fed %"U32_F" frames in %.3f s, %.0f pkts/s%s\n", r->fed,
+         (double)elapsed / 1e9, (double)r->fed * 1e9 / (double)elapsed,
+         r->paced ? " (paced)" : "");
+  printf("pcapif_replay: drops: %"U32_F" no pbuf, %"U32_F" input errors, tx %"U32_F" frames\n",
+         r->alloc_drops, errors, r->tx);
+  printf("pcapif_replay: %-6s %10s %10s %10s\n", "proto", "frames", "ns/frame", "errors");
+  for (i = 0; i < REPLAY_NUM_CLASSES; i++) {
+    if (r->cls_frames[i] == 0) {
+      continue;
+    }
+    printf("pcapif_replay: %-6s %10"U32_F" %10.0f %10"U32_F"\n", replay_class_name[i],
+           r->cls_frames[i], (double)r->cls_ns[i] / (double)r->cls_frames[i], r->cls_errors[i]);
+  }
+#if LWIP_STATS
+  for (i = 0; replay_stats[i].name != NULL; i++) {
+    printf("pcapif_replay: %s.drop +%lu\n", replay_stats[i].name,
+           (unsigned long)(replay_stats[i].proto->drop - r->drop0[i]));
+  }
+#endif /* LWIP_STATS */
+}
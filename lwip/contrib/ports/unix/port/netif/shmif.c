@@ -0,0 +1,545 @@
+/*
+ * Copyright (c) 2026 lwIP contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Shared memory network interface.
+ *
+ * The shared file holds one single-producer/single-consumer ring for every
+ * ordered pair of ports, ring[from][to], each with SHMIF_SLOTS preallocated
+ * frame slots. The producer owns 'tail', the consumer owns 'head'; both are
+ * free running counters on their own cache line, so the rings need no locks.
+ * A frame is copied into the slot at tail and published by storing tail with
+ * release semantics, the consumer takes a batch of slots and releases them
+ * with a single store of head.
+ *
+ * A consumer that finds its rings empty sets 'sleeping' and waits on its
+ * 'doorbell' word with a futex (the mapping is MAP_SHARED, so that works
+ * across processes). Producers only make the wake system call when the
+ * consumer sleeps, so under load there are no system calls at all. Other
+ * systems than Linux poll with a short sleep instead.
+ *
+ * Stale ports of crashed processes are taken over when their pid is gone.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "lwip/opt.h"
+
+#include "lwip/debug.h"
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/stats.h"
+#include "lwip/snmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
+#include "netif/etharp.h"
+#include "lwip/ethip6.h"
+
+#include "netif/shmif.h"
+
+#if defined(LWIP_UNIX_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#define SHMIF_DEFAULT_PATH "/dev/shm/lwip-shmif"
+#else
+#define SHMIF_DEFAULT_PATH "/tmp/lwip-shmif"
+#endif
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 's'
+#define IFNAME1 'm'
+
+#ifndef SHMIF_DEBUG
+#define SHMIF_DEBUG LWIP_DBG_OFF
+#endif
+
+/* Frame slots per ring, a power of two */
+#ifndef SHMIF_SLOTS
+#define SHMIF_SLOTS 256
+#endif
+/* Frames taken from one ring before the next ring gets its turn */
+#ifndef SHMIF_BATCH
+#define SHMIF_BATCH 32
+#endif
+
+#define SHMIF_SLOT_SIZE  1536
+#define SHMIF_CACHE_LINE 64
+/* changes with the layout of struct shmif_shared */
+#define SHMIF_MAGIC      (0x73686d00UL | (SHMIF_MAX_PORTS << 4) | 1)
+
+struct shmif_slot {
+  u32_t len;
+  u8_t data[SHMIF_SLOT_SIZE - 4];
+};
+
+struct shmif_ring {
+  u32_t head;
+  u8_t pad0[SHMIF_CACHE_LINE - 4];
+  u32_t tail;
+  u8_t pad1[SHMIF_CACHE_LINE - 4];
+  struct shmif_slot slot[SHMIF_SLOTS];
+};
+
+struct shmif_port {
+  u32_t pid;
+  u32_t doorbell;
+  u32_t sleeping;
+  u8_t hwaddr[ETH_HWADDR_LEN];
+  u8_t pad[SHMIF_CACHE_LINE - 12 - ETH_HWADDR_LEN];
+};
+
+struct shmif_shared {
+  u32_t magic;
+  u8_t pad[SHMIF_CACHE_LINE - 4];
+  struct shmif_port port[SHMIF_MAX_PORTS];
+  struct shmif_ring ring[SHMIF_MAX_PORTS][SHMIF_MAX_PORTS];
+};
+
+struct shmif {
+  struct shmif_shared *shm;
+  u32_t port;
+  /* where the last receive stopped, so all peers get their turn */
+  u32_t rx_next;
+};
+
+/* Forward declarations. */
+#if !NO_SYS
+static void shmif_thread(void *arg);
+#endif /* !NO_SYS */
+
+/*-----------------------------------------------------------------------------------*/
+static int
+shmif_pending(struct shmif *shmif)
+{
+  struct shmif_shared *shm = shmif->shm;
+  u32_t i;
+
+  for (i = 0; i < SHMIF_MAX_PORTS; i++) {
+    struct shmif_ring *ring = &shm->ring[i][shmif->port];
+
+    if (i != shmif->port &&
+        __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != ring->head) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void
+shmif_wake(struct shmif_port *port)
+{
+  /* pairs with the fence in shmif_wait(): either the consumer sees the
+     new tail or we see it sleeping */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&port->sleeping, __ATOMIC_RELAXED)) {
+    __atomic_add_fetch(&port->doorbell, 1, __ATOMIC_SEQ_CST);
+#if defined(LWIP_UNIX_LINUX)
+    syscall(SYS_futex, &port->doorbell, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * low_level_init():
+ *
+ * Maps the shared file and attaches to the configured port.
+ */
+/*-----------------------------------------------------------------------------------*/
+static void
+low_level_init(struct netif *netif)
+{
+  struct shmif *shmif = (struct shmif *)netif->state;
+  struct shmif_port *port;
+  const char *path = getenv("SHMIF");
+  const char *env = getenv("SHMIF_PORT");
+  u32_t expected = 0;
+  u32_t pid = (u32_t)getpid();
+  struct stat st;
+  void *mem;
+  int fd;
+  u32_t i;
+
+  if (path == NULL) {
+    path = SHMIF_DEFAULT_PATH;
+  }
+  shmif->port = (env != NULL) ? (u32_t)atoi(env) : 0;
+  if (shmif->port >= SHMIF_MAX_PORTS) {
+    fprintf(stderr, "shmif_init: SHMIF_PORT must be below %d\n", SHMIF_MAX_PORTS);
+    exit(1);
+  }
+
+  fd = open(path, O_RDWR | O_CREAT, 0600);
+  if (fd == -1) {
+    perror("shmif_init: cannot open shared file");
+    exit(1);
+  }
+  /* a new file reads as zeros, which is a valid state with all rings empty */
+  if (fstat(fd, &st) == -1 ||
+      (st.st_size < (off_t)sizeof(struct shmif_shared) &&
+       ftruncate(fd, (off_t)sizeof(struct shmif_shared)) == -1)) {
+    perror("shmif_init: cannot size shared file");
+    exit(1);
+  }
+  mem = mmap(NULL, sizeof(struct shmif_shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    perror("shmif_init: mmap");
+    exit(1);
+  }
+  shmif->shm = (struct shmif_shared *)mem;
+
+  if (!__atomic_compare_exchange_n(&shmif->shm->magic, &expected, SHMIF_MAGIC, 0,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) &&
+      expected != SHMIF_MAGIC) {
+    fprintf(stderr, "shmif_init: %s has a different layout, remove it\n", path);
+    exit(1);
+  }
+
+  /* claim the port, or take it over from a process that is gone */
+  port = &shmif->shm->port[shmif->port];
+  expected = 0;
+  while (!__atomic_compare_exchange_n(&port->pid, &expected, pid, 0,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    if (kill((pid_t)expected, 0) == 0 || errno != ESRCH) {
+      fprintf(stderr, "shmif_init: port %"U32_F" is used by pid %"U32_F"\n", shmif->port, expected);
+      exit(1);
+    }
+  }
+  /* drop what was queued for the previous owner */
+  for (i = 0; i < SHMIF_MAX_PORTS; i++) {
+    struct shmif_ring *ring = &shmif->shm->ring[i][shmif->port];
+
+    __atomic_store_n(&ring->head, __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+  }
+  port->sleeping = 0;
+
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 0x12;
+  netif->hwaddr[2] = 0x34;
+  netif->hwaddr[3] = 0x56;
+  netif->hwaddr[4] = 0x79;
+  netif->hwaddr[5] = (u8_t)shmif->port;
+  netif->hwaddr_len = 6;
+  memcpy(port->hwaddr, netif->hwaddr, ETH_HWADDR_LEN);
+
+  /* device capabilities */
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP;
+
+  LWIP_DEBUGF(SHMIF_DEBUG, ("shmif_init: %s port %"U32_F"\n", path, shmif->port));
+
+  netif_set_link_up(netif);
+
+#if !NO_SYS
+  sys_thread_new("shmif_thread", shmif_thread, netif, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+#endif /* !NO_SYS */
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * low_level_output():
+ *
+ * Copies the frame into the ring to the port owning the destination MAC,
+ * or into the rings to all attached ports.
+ */
+/*-----------------------------------------------------------------------------------*/
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct shmif *shmif = (struct shmif *)netif->state;
+  struct shmif_shared *shm = shmif->shm;
+  struct shmif_port *self = &shm->port[shmif->port];
+  u8_t dst[ETH_HWADDR_LEN];
+  u32_t i, first = 0, last = SHMIF_MAX_PORTS;
+  err_t err = ERR_OK;
+
+  if (p->tot_len > SHMIF_SLOT_SIZE - 4 ||
+      pbuf_copy_partial(p, dst, ETH_HWADDR_LEN, 0) != ETH_HWADDR_LEN) {
+    MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+    LINK_STATS_INC(link.lenerr);
+    return ERR_IF;
+  }
+  /* the application may have set its own MAC after shmif_init() */
+  if (memcmp(self->hwaddr, netif->hwaddr, ETH_HWADDR_LEN) != 0) {
+    memcpy(self->hwaddr, netif->hwaddr, ETH_HWADDR_LEN);
+  }
+
+  if (!(dst[0] & 0x01U)) {
+    for (i = 0; i < SHMIF_MAX_PORTS; i++) {
+      if (i != shmif->port && memcmp(shm->port[i].hwaddr, dst, ETH_HWADDR_LEN) == 0 &&
+          __atomic_load_n(&shm->port[i].pid, __ATOMIC_RELAXED) != 0) {
+        first = i;
+        last = i + 1;
+        break;
+      }
+    }
+  }
+
+  for (i = first; i < last; i++) {
+    struct shmif_ring *ring = &shm->ring[shmif->port][i];
+    struct shmif_slot *slot;
+    u32_t tail = ring->tail;
+
+    if (i == shmif->port || __atomic_load_n(&shm->port[i].pid, __ATOMIC_RELAXED) == 0) {
+      continue;
+    }
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= SHMIF_SLOTS) {
+      /* ring full: the sender sees ERR_MEM and may try again later */
+      MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+      LINK_STATS_INC(link.drop);
+      err = ERR_MEM;
+      continue;
+    }
+    slot = &ring->slot[tail & (SHMIF_SLOTS - 1)];
+    slot->len = p->tot_len;
+    pbuf_copy_partial(p, slot->data, p->tot_len, 0);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    shmif_wake(&shm->port[i]);
+  }
+  if (err == ERR_OK) {
+    MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
+    LINK_STATS_INC(link.xmit);
+  }
+  return err;
+}
+
+#if !NO_SYS && TCPIP_INPKT_BURST_MAX
+/*-----------------------------------------------------------------------------------*/
+static void
+shmif_input_burst(struct pbuf **p, struct netif **inp, u16_t count)
+{
+  if (tcpip_inpkt_burst(p, inp, count, ethernet_input) != ERR_OK) {
+    u16_t i;
+    LWIP_DEBUGF(NETIF_DEBUG, ("shmif_poll: tcpip_inpkt_burst error\n"));
+    for (i = 0; i < count; i++) {
+      LINK_STATS_INC(link.drop);
+      MIB2_STATS_NETIF_INC(inp[i], ifindiscards);
+      pbuf_free(p[i]);
+    }
+  }
+}
+#endif /* !NO_SYS && TCPIP_INPKT_BURST_MAX */
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * shmif_poll():
+ *
+ * Takes up to SHMIF_BATCH frames from each ring into pool pbufs and passes
+ * them to netif->input. With tcpip_input as input function, the frames
+ * are handed to tcpip_thread in bursts of up to TCPIP_INPKT_BURST_MAX.
+ */
+/*-----------------------------------------------------------------------------------*/
+int
+shmif_poll(struct netif *netif)
+{
+  struct shmif *shmif = (struct shmif *)netif->state;
+  struct shmif_shared *shm = shmif->shm;
+  int frames = 0;
+  u32_t n;
+#if !NO_SYS && TCPIP_INPKT_BURST_MAX
+  struct pbuf *burst[TCPIP_INPKT_BURST_MAX];
+  struct netif *burst_netif[TCPIP_INPKT_BURST_MAX];
+  u16_t burst_len = 0;
+#endif /* !NO_SYS && TCPIP_INPKT_BURST_MAX */
+
+  for (n = 0; n < SHMIF_MAX_PORTS; n++) {
+    u32_t from = (shmif->rx_next + n) % SHMIF_MAX_PORTS;
+    struct shmif_ring *ring = &shm->ring[from][shmif->port];
+    u32_t head = ring->head;
+    u32_t tail;
+    u32_t end;
+
+    if (from == shmif->port) {
+      continue;
+    }
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    end = (tail - head > SHMIF_BATCH) ? head + SHMIF_BATCH : tail;
+    for (; head != end; head++) {
+      const struct shmif_slot *slot = &ring->slot[head & (SHMIF_SLOTS - 1)];
+      /* the length comes from another process: read it once and never
+       * trust it past the slot */
+      u32_t len = __atomic_load_n(&slot->len, __ATOMIC_RELAXED);
+      struct pbuf *p;
+
+      if (len == 0 || len > SHMIF_SLOT_SIZE - 4) {
+        LWIP_DEBUGF(NETIF_DEBUG, ("shmif_poll: bad slot length %"U32_F"\n", len));
+        LINK_STATS_INC(link.lenerr);
+        LINK_STATS_INC(link.drop);
+        MIB2_STATS_NETIF_INC(netif, ifinerrors);
+        continue;
+      }
+      p = pbuf_alloc(PBUF_RAW, (u16_t)len, PBUF_POOL);
+      if (p == NULL) {
+        LINK_STATS_INC(link.memerr);
+        LINK_STATS_INC(link.drop);
+        MIB2_STATS_NETIF_INC(netif, ifindiscards);
+        continue;
+      }
+      pbuf_take(p, slot->data, (u16_t)len);
+      MIB2_STATS_NETIF_ADD(netif, ifinoctets, p->tot_len);
+      LINK_STATS_INC(link.recv);
+      frames++;
+#if !NO_SYS && TCPIP_INPKT_BURST_MAX
+      if (netif->input == tcpip_input) {
+        burst[burst_len] = p;
+        burst_netif[burst_len] = netif;
+        if (++burst_len == TCPIP_INPKT_BURST_MAX) {
+          shmif_input_burst(burst, burst_netif, burst_len);
+          burst_len = 0;
+        }
+        continue;
+      }
+#endif /* !NO_SYS && TCPIP_INPKT_BURST_MAX */
+      if (netif->input(p, netif) != ERR_OK) {
+        LWIP_DEBUGF(NETIF_DEBUG, ("shmif_poll: netif input error\n"));
+        pbuf_free(p);
+      }
+    }
+    /* one store hands the whole batch of slots back to the producer */
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+  }
+#if !NO_SYS && TCPIP_INPKT_BURST_MAX
+  if (burst_len > 0) {
+    shmif_input_burst(burst, burst_netif, burst_len);
+  }
+#endif /* !NO_SYS && TCPIP_INPKT_BURST_MAX */
+  shmif->rx_next = (shmif->rx_next + 1) % SHMIF_MAX_PORTS;
+  return frames;
+}
+
+/*-----------------------------------------------------------------------------------*/
+int
+shmif_wait(struct netif *netif, u32_t msecs)
+{
+  struct shmif *shmif = (struct shmif *)netif->state;
+  struct shmif_port *port = &shmif->shm->port[shmif->port];
+  u32_t doorbell;
+  struct timespec ts;
+
+  if (shmif_pending(shmif)) {
+    return 1;
+  }
+  if (msecs == 0) {
+    return 0;
+  }
+  doorbell = __atomic_load_n(&port->doorbell, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&port->sleeping, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (!shmif_pending(shmif)) {
+#if defined(LWIP_UNIX_LINUX)
+    ts.tv_sec = msecs / 1000;
+    ts.tv_nsec = (long)(msecs % 1000) * 1000000L;
+    syscall(SYS_futex, &port->doorbell, FUTEX_WAIT, doorbell,
+            (msecs == SYS_TIMEOUTS_SLEEPTIME_INFINITE) ? NULL : &ts, NULL, 0);
+#else
+    LWIP_UNUSED_ARG(doorbell);
+    ts.tv_sec = 0;
+    ts.tv_nsec = (long)LWIP_MIN(msecs, 1) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+  }
+  __atomic_store_n(&port->sleeping, 0, __ATOMIC_RELAXED);
+  return shmif_pending(shmif);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+ * shmif_init():
+ *
+ * Should be called at the beginning of the program to set up the
+ * network interface.
+ */
+/*-----------------------------------------------------------------------------------*/
+err_t
+shmif_init(struct netif *netif)
+{
+  struct shmif *shmif = (struct shmif *)mem_malloc(sizeof(struct shmif));
+
+  if (shmif == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("shmif_init: out of memory for shmif\n"));
+    return ERR_MEM;
+  }
+  memset(shmif, 0, sizeof(struct shmif));
+  netif->state = shmif;
+  MIB2_INIT_NETIF(netif, snmp_ifType_other, 1000000000);
+
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif /* LWIP_IPV6 */
+  netif->linkoutput = low_level_output;
+  netif->mtu = 1500;
+
+  low_level_init(netif);
+
+  return ERR_OK;
+}
+
+#if NO_SYS
+
+int
+shmif_select(struct netif *netif)
+{
+  if (shmif_wait(netif, sys_timeouts_sleeptime())) {
+    return shmif_poll(netif);
+  }
+  return 0;
+}
+
+#else /* NO_SYS */
+
+static void
+shmif_thread(void *arg)
+{
+  struct netif *netif = (struct netif *)arg;
+
+  while (1) {
+    (void)shmif_wait(netif, SYS_TIMEOUTS_SLEEPTIME_INFINITE);
+    (void)shmif_poll(netif);
+  }
+}
+
+#endif /* NO_SYS */
@@ -54,6 +54,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 
 #include "lwip/def.h"
@@ -68,6 +69,11 @@
 #include "lwip/stats.h"
 #include "lwip/tcpip.h"
 
+#ifdef LWIP_UNIX_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 #if LWIP_NETCONN_SEM_PER_THREAD
 /* pthread key to *our* thread local storage entry */
 static pthread_key_t sys_thread_sem_key;
@@ -101,9 +107,10 @@ get_monotonic_time(struct timespec *ts)
 }
 
 #if SYS_LIGHTWEIGHT_PROT
-static pthread_mutex_t lwprot_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_t lwprot_thread = (pthread_t)0xDEAD;
-static int lwprot_count = 0;
+/* spins before yielding the CPU in sys_arch_protect() */
+#define LWPROT_SPIN 100
+static int lwprot_lock = 0;
+static __thread int lwprot_depth = 0;
 #endif /* SYS_LIGHTWEIGHT_PROT */
 
 #if !NO_SYS
@@ -111,20 +118,34 @@ static int lwprot_count = 0;
 static struct sys_thread *threads = NULL;
 static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-struct sys_mbox_msg {
-  struct sys_mbox_msg *next;
-  void *msg;
+#define SYS_MBOX_SIZE 128 /* power of two, positions wrap around */
+#define SYS_CACHELINE 64
+
+struct sys_mbox_event {
+  u32_t seq;      /* bumped on every wakeup, the futex word on Linux */
+  u32_t waiters;
+#ifndef LWIP_UNIX_LINUX
+  pthread_condattr_t condattr;
+  pthread_cond_t cond;
+  pthread_mutex_t mutex;
+#endif /* LWIP_UNIX_LINUX */
 };
 
-#define SYS_MBOX_SIZE 128
+struct sys_mbox_cell {
+  u32_t seq;
+  void *msg;
+};
 
+/* posters and fetchers run on different threads: keep each position on its
+   own cache line, next to the sleepers it has to check after every update */
 struct sys_mbox {
-  int first, last;
-  void *msgs[SYS_MBOX_SIZE];
-  struct sys_sem *not_empty;
-  struct sys_sem *not_full;
-  struct sys_sem *mutex;
-  int wait_send;
+  u32_t enq;
+  struct sys_mbox_event not_empty;
+  u8_t pad1[SYS_CACHELINE];
+  u32_t deq;
+  struct sys_mbox_event not_full;
+  u8_t pad2[SYS_CACHELINE];
+  struct sys_mbox_cell cells[SYS_MBOX_SIZE];
 };
 
 struct sys_sem {
@@ -260,21 +281,184 @@ void sys_check_core_locking(void)
 
 /*-----------------------------------------------------------------------------------*/
 /* Mailbox */
+
+/* The mailbox is a bounded lock-free queue (D. Vyukov's sequence numbered
+ * ring): posters and fetchers each claim a position with one CAS and hand
+ * the cell over with its sequence number. Any number of threads may post
+ * (tcpip_inpkt from several drivers) and fetch (full-duplex netconns).
+ * Threads only go to sleep on an empty or full mailbox; the other side then
+ * pays for a wakeup only if someone is actually sleeping. */
+static void
+mbox_event_init(struct sys_mbox_event *ev)
+{
+  ev->seq = 0;
+  ev->waiters = 0;
+#ifndef LWIP_UNIX_LINUX
+  pthread_condattr_init(&ev->condattr);
+#if !(defined(LWIP_UNIX_MACH) || (defined(LWIP_UNIX_ANDROID) && __ANDROID_API__ < 21))
+  pthread_condattr_setclock(&ev->condattr, CLOCK_MONOTONIC);
+#endif
+  pthread_cond_init(&ev->cond, &ev->condattr);
+  pthread_mutex_init(&ev->mutex, NULL);
+#endif /* LWIP_UNIX_LINUX */
+}
+
+static void
+mbox_event_free(struct sys_mbox_event *ev)
+{
+#ifdef LWIP_UNIX_LINUX
+  LWIP_UNUSED_ARG(ev);
+#else /* LWIP_UNIX_LINUX */
+  pthread_cond_destroy(&ev->cond);
+  pthread_condattr_destroy(&ev->condattr);
+  pthread_mutex_destroy(&ev->mutex);
+#endif /* LWIP_UNIX_LINUX */
+}
+
+/* Sleeps until ev->seq moves away from 'key' or 'timeout' ms (0: forever)
+ * passed. Spurious returns are fine, callers retry their queue operation. */
+static void
+mbox_event_wait(struct sys_mbox_event *ev, u32_t key, u32_t timeout)
+{
+#ifdef LWIP_UNIX_LINUX
+  struct timespec ts;
+
+  ts.tv_sec = timeout / 1000L;
+  ts.tv_nsec = (timeout % 1000L) * 1000000L;
+  syscall(SYS_futex, &ev->seq, FUTEX_WAIT_PRIVATE, key,
+          timeout ? &ts : NULL, NULL, 0);
+#else /* LWIP_UNIX_LINUX */
+  pthread_mutex_lock(&ev->mutex);
+  if (__atomic_load_n(&ev->seq, __ATOMIC_RELAXED) == key) {
+    cond_wait(&ev->cond, &ev->mutex, timeout);
+  }
+  pthread_mutex_unlock(&ev->mutex);
+#endif /* LWIP_UNIX_LINUX */
+}
+
+/* Called after the queue was changed: wakes one sleeper, if there is one. */
+static void
+mbox_event_signal(struct sys_mbox_event *ev)
+{
+  /* pairs with the fence in mbox_event_prepare: either the sleeper sees
+     the queue change or we see the sleeper */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&ev->waiters, __ATOMIC_RELAXED) == 0) {
+    return;
+  }
+#ifdef LWIP_UNIX_LINUX
+  __atomic_add_fetch(&ev->seq, 1, __ATOMIC_RELEASE);
+  syscall(SYS_futex, &ev->seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else /* LWIP_UNIX_LINUX */
+  pthread_mutex_lock(&ev->mutex);
+  __atomic_add_fetch(&ev->seq, 1, __ATOMIC_RELEASE);
+  pthread_cond_signal(&ev->cond);
+  pthread_mutex_unlock(&ev->mutex);
+#endif /* LWIP_UNIX_LINUX */
+}
+
+/* Registers as sleeper, returns the key for mbox_event_wait. The caller
+ * must retry its queue operation before actually waiting. */
+static u32_t
+mbox_event_prepare(struct sys_mbox_event *ev)
+{
+  u32_t key = __atomic_load_n(&ev->seq, __ATOMIC_ACQUIRE);
+  __atomic_add_fetch(&ev->waiters, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return key;
+}
+
+static void
+mbox_event_finish(struct sys_mbox_event *ev)
+{
+  __atomic_sub_fetch(&ev->waiters, 1, __ATOMIC_RELAXED);
+}
+
+static int
+mbox_enqueue(struct sys_mbox *mbox, void *msg)
+{
+  struct sys_mbox_cell *cell;
+  u32_t pos = __atomic_load_n(&mbox->enq, __ATOMIC_RELAXED);
+
+  for (;;) {
+    s32_t diff;
+    cell = &mbox->cells[pos % SYS_MBOX_SIZE];
+    diff = (s32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&mbox->enq, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      /* full */
+      return 0;
+    } else {
+      pos = __atomic_load_n(&mbox->enq, __ATOMIC_RELAXED);
+    }
+  }
+  cell->msg = msg;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  mbox_event_signal(&mbox->not_empty);
+  return 1;
+}
+
+static int
+mbox_dequeue(struct sys_mbox *mbox, void **msg)
+{
+  struct sys_mbox_cell *cell;
+  u32_t pos = __atomic_load_n(&mbox->deq, __ATOMIC_RELAXED);
+
+  for (;;) {
+    s32_t diff;
+    cell = &mbox->cells[pos % SYS_MBOX_SIZE];
+    diff = (s32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&mbox->deq, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (diff < 0) {
+      /* empty */
+      return 0;
+    } else {
+      pos = __atomic_load_n(&mbox->deq, __ATOMIC_RELAXED);
+    }
+  }
+  if (msg != NULL) {
+    *msg = cell->msg;
+  }
+  __atomic_store_n(&cell->seq, pos + SYS_MBOX_SIZE, __ATOMIC_RELEASE);
+  mbox_event_signal(&mbox->not_full);
+  return 1;
+}
+
+static u32_t
+elapsed_ms(const struct timespec *start)
+{
+  struct timespec now;
+
+  get_monotonic_time(&now);
+  return (u32_t)((now.tv_sec - start->tv_sec) * 1000L +
+                 (now.tv_nsec - start->tv_nsec) / 1000000L);
+}
+
 err_t
 sys_mbox_new(struct sys_mbox **mb, int size)
 {
   struct sys_mbox *mbox;
+  u32_t i;
   LWIP_UNUSED_ARG(size);
 
   mbox = (struct sys_mbox *)malloc(sizeof(struct sys_mbox));
   if (mbox == NULL) {
     return ERR_MEM;
   }
-  mbox->first = mbox->last = 0;
-  mbox->not_empty = sys_sem_new_internal(0);
-  mbox->not_full = sys_sem_new_internal(0);
-  mbox->mutex = sys_sem_new_internal(1);
-  mbox->wait_send = 0;
+  mbox->enq = mbox->deq = 0;
+  for (i = 0; i < SYS_MBOX_SIZE; i++) {
+    mbox->cells[i].seq = i;
+  }
+  mbox_event_init(&mbox->not_empty);
+  mbox_event_init(&mbox->not_full);
 
   SYS_STATS_INC_USED(mbox);
   *mb = mbox;
@@ -287,12 +471,9 @@ sys_mbox_free(struct sys_mbox **mb)
   if ((mb != NULL) && (*mb != SYS_MBOX_NULL)) {
     struct sys_mbox *mbox = *mb;
     SYS_STATS_DEC(mbox.used);
-    sys_arch_sem_wait(&mbox->mutex, 0);
 
-    sys_sem_free_internal(mbox->not_empty);
-    sys_sem_free_internal(mbox->not_full);
-    sys_sem_free_internal(mbox->mutex);
-    mbox->not_empty = mbox->not_full = mbox->mutex = NULL;
+    mbox_event_free(&mbox->not_empty);
+    mbox_event_free(&mbox->not_full);
     /*  LWIP_DEBUGF("sys_mbox_free: mbox 0x%lx\n", mbox); */
     free(mbox);
   }
@@ -301,37 +482,14 @@ sys_mbox_free(struct sys_mbox **mb)
 err_t
 sys_mbox_trypost(struct sys_mbox **mb, void *msg)
 {
-  u8_t first;
-  struct sys_mbox *mbox;
   LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
-  mbox = *mb;
-
-  sys_arch_sem_wait(&mbox->mutex, 0);
 
   LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_trypost: mbox %p msg %p\n",
-                          (void *)mbox, (void *)msg));
+                          (void *)*mb, (void *)msg));
 
-  if ((mbox->last + 1) >= (mbox->first + SYS_MBOX_SIZE)) {
-    sys_sem_signal(&mbox->mutex);
+  if (!mbox_enqueue(*mb, msg)) {
     return ERR_MEM;
   }
-
-  mbox->msgs[mbox->last % SYS_MBOX_SIZE] = msg;
-
-  if (mbox->last == mbox->first) {
-    first = 1;
-  } else {
-    first = 0;
-  }
-
-  mbox->last++;
-
-  if (first) {
-    sys_sem_signal(&mbox->not_empty);
-  }
-
-  sys_sem_signal(&mbox->mutex);
-
   return ERR_OK;
 }
 
@@ -344,119 +502,77 @@ sys_mbox_trypost_fromisr(sys_mbox_t *q, void *msg)
 void
 sys_mbox_post(struct sys_mbox **mb, void *msg)
 {
-  u8_t first;
   struct sys_mbox *mbox;
   LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
   mbox = *mb;
 
-  sys_arch_sem_wait(&mbox->mutex, 0);
-
   LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_post: mbox %p msg %p\n", (void *)mbox, (void *)msg));
 
-  while ((mbox->last + 1) >= (mbox->first + SYS_MBOX_SIZE)) {
-    mbox->wait_send++;
-    sys_sem_signal(&mbox->mutex);
-    sys_arch_sem_wait(&mbox->not_full, 0);
-    sys_arch_sem_wait(&mbox->mutex, 0);
-    mbox->wait_send--;
-  }
-
-  mbox->msgs[mbox->last % SYS_MBOX_SIZE] = msg;
-
-  if (mbox->last == mbox->first) {
-    first = 1;
-  } else {
-    first = 0;
-  }
-
-  mbox->last++;
-
-  if (first) {
-    sys_sem_signal(&mbox->not_empty);
+  while (!mbox_enqueue(mbox, msg)) {
+    u32_t key = mbox_event_prepare(&mbox->not_full);
+    if (mbox_enqueue(mbox, msg)) {
+      mbox_event_finish(&mbox->not_full);
+      break;
+    }
+    mbox_event_wait(&mbox->not_full, key, 0);
+    mbox_event_finish(&mbox->not_full);
   }
-
-  sys_sem_signal(&mbox->mutex);
 }
 
 u32_t
 sys_arch_mbox_tryfetch(struct sys_mbox **mb, void **msg)
 {
-  struct sys_mbox *mbox;
   LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
-  mbox = *mb;
-
-  sys_arch_sem_wait(&mbox->mutex, 0);
 
-  if (mbox->first == mbox->last) {
-    sys_sem_signal(&mbox->mutex);
+  if (!mbox_dequeue(*mb, msg)) {
     return SYS_MBOX_EMPTY;
   }
-
-  if (msg != NULL) {
-    LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_tryfetch: mbox %p msg %p\n", (void *)mbox, *msg));
-    *msg = mbox->msgs[mbox->first % SYS_MBOX_SIZE];
-  }
-  else{
-    LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_tryfetch: mbox %p, null msg\n", (void *)mbox));
-  }
-
-  mbox->first++;
-
-  if (mbox->wait_send) {
-    sys_sem_signal(&mbox->not_full);
-  }
-
-  sys_sem_signal(&mbox->mutex);
-
+  LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_tryfetch: mbox %p msg %p\n",
+                          (void *)*mb, msg != NULL ? *msg : NULL));
   return 0;
 }
 
 u32_t
 sys_arch_mbox_fetch(struct sys_mbox **mb, void **msg, u32_t timeout)
 {
+  struct timespec start;
   u32_t time_needed = 0;
   struct sys_mbox *mbox;
   LWIP_ASSERT("invalid mbox", (mb != NULL) && (*mb != NULL));
   mbox = *mb;
 
-  /* The mutex lock is quick so we don't bother with the timeout
-     stuff here. */
-  sys_arch_sem_wait(&mbox->mutex, 0);
-
-  while (mbox->first == mbox->last) {
-    sys_sem_signal(&mbox->mutex);
+  if (mbox_dequeue(mbox, msg)) {
+    return 0;
+  }
 
-    /* We block while waiting for a mail to arrive in the mailbox. We
-       must be prepared to timeout. */
+  /* We block while waiting for a mail to arrive in the mailbox. We
+     must be prepared to timeout. */
+  get_monotonic_time(&start);
+  for (;;) {
+    u32_t key = mbox_event_prepare(&mbox->not_empty);
+    if (mbox_dequeue(mbox, msg)) {
+      mbox_event_finish(&mbox->not_empty);
+      break;
+    }
     if (timeout != 0) {
-      time_needed = sys_arch_sem_wait(&mbox->not_empty, timeout);
-
-      if (time_needed == SYS_ARCH_TIMEOUT) {
+      time_needed = elapsed_ms(&start);
+      if (time_needed >= timeout) {
+        mbox_event_finish(&mbox->not_empty);
         return SYS_ARCH_TIMEOUT;
       }
+      mbox_event_wait(&mbox->not_empty, key, timeout - time_needed);
     } else {
-      sys_arch_sem_wait(&mbox->not_empty, 0);
+      mbox_event_wait(&mbox->not_empty, key, 0);
+    }
+    mbox_event_finish(&mbox->not_empty);
+    if (mbox_dequeue(mbox, msg)) {
+      break;
     }
-
-    sys_arch_sem_wait(&mbox->mutex, 0);
-  }
-
-  if (msg != NULL) {
-    LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_fetch: mbox %p msg %p\n", (void *)mbox, *msg));
-    *msg = mbox->msgs[mbox->first % SYS_MBOX_SIZE];
-  }
-  else{
-    LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_fetch: mbox %p, null msg\n", (void *)mbox));
-  }
-
-  mbox->first++;
-
-  if (mbox->wait_send) {
-    sys_sem_signal(&mbox->not_full);
   }
+  time_needed = elapsed_ms(&start);
 
-  sys_sem_signal(&mbox->mutex);
-
+  LWIP_DEBUGF(SYS_DEBUG, ("sys_mbox_fetch: mbox %p msg %p\n",
+                          (void *)mbox, msg != NULL ? *msg : NULL));
   return time_needed;
 }
 
@@ -786,21 +902,22 @@ system.
 sys_prot_t
 sys_arch_protect(void)
 {
-    /* Note that for the UNIX port, we are using a lightweight mutex, and our
-     * own counter (which is locked by the mutex). The return code is not actually
-     * used. */
-    if (lwprot_thread != pthread_self())
-    {
-        /* We are locking the mutex where it has not been locked before *
-        * or is being locked by another thread */
-        pthread_mutex_lock(&lwprot_mutex);
-        lwprot_thread = pthread_self();
-        lwprot_count = 1;
+  /* For the UNIX port, this is a spinlock plus a per-thread nesting counter:
+   * the protected regions are a handful of instructions, so a contended
+   * locker spins a little and then yields instead of sleeping in the kernel.
+   * The return code is not actually used. */
+  if (lwprot_depth++ == 0) {
+    while (__atomic_exchange_n(&lwprot_lock, 1, __ATOMIC_ACQUIRE)) {
+      int spin = LWPROT_SPIN;
+      while (__atomic_load_n(&lwprot_lock, __ATOMIC_RELAXED)) {
+        if (--spin == 0) {
+          sched_yield();
+          spin = LWPROT_SPIN;
+        }
+      }
     }
-    else
-        /* It is already locked by THIS thread */
-        lwprot_count++;
-    return 0;
+  }
+  return 0;
 }
 
 /** void sys_arch_unprotect(sys_prot_t pval)
@@ -813,16 +930,11 @@ an operating system.
 void
 sys_arch_unprotect(sys_prot_t pval)
 {
-    LWIP_UNUSED_ARG(pval);
-    if (lwprot_thread == pthread_self())
-    {
-        lwprot_count--;
-        if (lwprot_count == 0)
-        {
-            lwprot_thread = (pthread_t) 0xDEAD;
-            pthread_mutex_unlock(&lwprot_mutex);
-        }
-    }
+  LWIP_UNUSED_ARG(pval);
+  LWIP_ASSERT("sys_arch_unprotect without sys_arch_protect", lwprot_depth > 0);
+  if (--lwprot_depth == 0) {
+    __atomic_store_n(&lwprot_lock, 0, __ATOMIC_RELEASE);
+  }
 }
 #endif /* SYS_LIGHTWEIGHT_PROT */
 
@@ -98,6 +98,7 @@ set(lwipnetif_SRCS
     ${LWIP_DIR}/src/netif/ethernet.c
     ${LWIP_DIR}/src/netif/bridgeif.c
     ${LWIP_DIR}/src/netif/bridgeif_fdb.c
+    ${LWIP_DIR}/src/netif/gro.c
 )
 
 if (NOT ${LWIP_EXCLUDE_SLIPIF})
@@ -86,6 +86,7 @@ APIFILES=$(LWIPDIR)/api/api_lib.c \
 NETIFFILES=$(LWIPDIR)/netif/ethernet.c \
 	$(LWIPDIR)/netif/bridgeif.c \
 	$(LWIPDIR)/netif/bridgeif_fdb.c \
+	$(LWIPDIR)/netif/gro.c \
 	$(LWIPDIR)/netif/slipif.c
 
 # SIXLOWPAN: 6LoWPAN
@@ -559,6 +559,66 @@ netconn_accept(struct netconn *conn, struct netconn **new_conn)
 #endif /* LWIP_TCP */
 }
 
+#if LWIP_TCP && LWIP_NETCONN_RECV_QUEUE
+/**
+ * Take the data queued by recv_tcp() off a TCP netconn.
+ *
+ * @param conn the netconn to take the data from
+ * @param woken 1 if the wakeup for the queue has been fetched from recvmbox
+ * @return everything queued as one pbuf chain (at most 0xFFFF bytes, the rest
+ *         stays queued) or NULL if the queue is empty
+ */
+static struct pbuf *
+netconn_recvq_take(struct netconn *conn, u8_t woken)
+{
+  struct pbuf *p, *q, *last = NULL;
+  u16_t len = 0;
+  u8_t empty;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  if (woken) {
+    conn->recvq_wakeup = NETCONN_RECVQ_WAKEUP_NONE;
+  }
+  p = conn->recvq_head;
+  for (q = p; (q != NULL) && ((u32_t)len + q->len <= 0xFFFF); q = q->next) {
+    len = (u16_t)(len + q->len);
+    last = q;
+  }
+  if (last != NULL) {
+    last->next = NULL;
+    conn->recvq_head = q;
+    if (q == NULL) {
+      conn->recvq_tail = NULL;
+    }
+#if LWIP_SO_RCVBUF
+    conn->recv_avail -= len;
+#endif /* LWIP_SO_RCVBUF */
+  }
+  empty = (conn->recvq_head == NULL);
+  if (empty && (conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_OWED)) {
+    /* nothing left to wake up for */
+    conn->recvq_wakeup = NETCONN_RECVQ_WAKEUP_NONE;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (last == NULL) {
+    return NULL;
+  }
+  /* make the packets one pbuf chain */
+  for (q = p; q != NULL; q = q->next) {
+    q->tot_len = len;
+    len = (u16_t)(len - q->len);
+  }
+  if (empty) {
+    /* Register event with callback */
+    API_EVENT(conn, NETCONN_EVT_RCVMINUS, p->tot_len);
+  }
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_recvq_take: took %p, len=%"U16_F"\n", (void *)p, p->tot_len));
+  return p;
+}
+#endif /* LWIP_TCP && LWIP_NETCONN_RECV_QUEUE */
+
 /**
  * @ingroup netconn_common
  * Receive data: actual implementation that doesn't care whether pbuf or netbuf
@@ -594,6 +654,17 @@ netconn_recv_data(struct netconn *conn, void **new_buf, u8_t apiflags)
     return ERR_CONN;
   }
 
+#if LWIP_TCP && LWIP_NETCONN_RECV_QUEUE
+  if (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP) {
+    /* queued data goes first, recvmbox only wakes us up for more and
+       passes on FIN and errors */
+    *new_buf = netconn_recvq_take(conn, 0);
+    if (*new_buf != NULL) {
+      return ERR_OK;
+    }
+  }
+recvq_wait:
+#endif /* LWIP_TCP && LWIP_NETCONN_RECV_QUEUE */
   NETCONN_MBOX_WAITING_INC(conn);
   if (netconn_is_nonblocking(conn) || (apiflags & NETCONN_DONTBLOCK) ||
       (conn->flags & NETCONN_FLAG_MBOXCLOSED) || (conn->pending_err != ERR_OK)) {
@@ -637,6 +708,16 @@ netconn_recv_data(struct netconn *conn, void **new_buf, u8_t apiflags)
 #endif /* (LWIP_UDP || LWIP_RAW) */
   {
     err_t err;
+#if LWIP_NETCONN_RECV_QUEUE
+    if (buf == conn) {
+      /* woken up for data queued by recv_tcp() */
+      *new_buf = netconn_recvq_take(conn, 1);
+      if (*new_buf != NULL) {
+        return ERR_OK;
+      }
+      goto recvq_wait;
+    }
+#endif /* LWIP_NETCONN_RECV_QUEUE */
     /* Check if this is an error message or a pbuf */
     if (lwip_netconn_is_err_msg(buf, &err)) {
       /* new_buf has been zeroed above already */
@@ -956,6 +1037,42 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
   return err;
 }
 
+/**
+ * @ingroup netconn_udp
+ * Send several netbufs over a UDP or RAW netconn with one core lock (or
+ * tcpip message). Sending stops at the first netbuf that fails.
+ *
+ * @param conn the UDP or RAW netconn over which to send data
+ * @param bufs array of netbufs containing the data to send
+ * @param count number of netbufs in bufs
+ * @param sent number of netbufs sent is stored here
+ * @return ERR_OK if at least one netbuf was sent, the error of the first
+ *         netbuf otherwise
+ */
+err_t
+netconn_send_batch(struct netconn *conn, struct netbuf *bufs, u16_t count, u16_t *sent)
+{
+  API_MSG_VAR_DECLARE(msg);
+  err_t err;
+
+  LWIP_ERROR("netconn_send_batch: invalid conn", (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_batch: invalid bufs", (bufs != NULL) && (count > 0), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_batch: invalid sent", (sent != NULL), return ERR_ARG;);
+
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send_batch: sending %"U16_F" netbufs\n", count));
+
+  API_MSG_VAR_ALLOC(msg);
+  API_MSG_VAR_REF(msg).conn = conn;
+  API_MSG_VAR_REF(msg).msg.bb.bufs = bufs;
+  API_MSG_VAR_REF(msg).msg.bb.count = count;
+  API_MSG_VAR_REF(msg).msg.bb.sent = 0;
+  err = netconn_apimsg(lwip_netconn_do_send_batch, &API_MSG_VAR_REF(msg));
+  *sent = API_MSG_VAR_REF(msg).msg.bb.sent;
+  API_MSG_VAR_FREE(msg);
+
+  return err;
+}
+
 /**
  * @ingroup netconn_tcp
  * Send data over a TCP netconn.
@@ -286,6 +286,21 @@ recv_udp(void *arg, struct udp_pcb *pcb, struct pbuf *p,
 #endif /* LWIP_UDP */
 
 #if LWIP_TCP
+#if LWIP_NETCONN_RECV_QUEUE
+/**
+ * Post the wakeup for the data queued by recv_tcp(). If recvmbox is full,
+ * the wakeup is owed and the next segment or poll_tcp() tries again, as the
+ * data has been ACKed already and cannot be refused like without the queue.
+ */
+static void
+recv_tcp_wakeup(struct netconn *conn)
+{
+  if (sys_mbox_trypost(&conn->recvmbox, conn) != ERR_OK) {
+    SYS_ARCH_SET(conn->recvq_wakeup, NETCONN_RECVQ_WAKEUP_OWED);
+  }
+}
+#endif /* LWIP_NETCONN_RECV_QUEUE */
+
 /**
  * Receive callback function for TCP netconns.
  * Posts the packet to conn->recvmbox, but doesn't delete it on errors.
@@ -323,6 +338,44 @@ recv_tcp(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
      using recv_avail since that could break the connection
      (data is already ACKed) */
 
+#if LWIP_NETCONN_RECV_QUEUE
+  if (p != NULL) {
+    struct pbuf *last;
+    u8_t was_empty, wakeup;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    for (last = p; last->next != NULL; last = last->next);
+    SYS_ARCH_PROTECT(lev);
+    was_empty = (conn->recvq_head == NULL);
+    if (was_empty) {
+      conn->recvq_head = p;
+    } else {
+      conn->recvq_tail->next = p;
+    }
+    conn->recvq_tail = last;
+    /* the reader only waits on recvmbox after finding the queue empty, so
+       the first data needs a wakeup, or the one that could not be posted */
+    wakeup = (was_empty && (conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_NONE)) ||
+             (conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_OWED);
+    if (wakeup) {
+      conn->recvq_wakeup = NETCONN_RECVQ_WAKEUP_POSTED;
+    }
+#if LWIP_SO_RCVBUF
+    conn->recv_avail += p->tot_len;
+#endif /* LWIP_SO_RCVBUF */
+    SYS_ARCH_UNPROTECT(lev);
+
+    if (wakeup) {
+      recv_tcp_wakeup(conn);
+    }
+    if (was_empty) {
+      /* Register event with callback */
+      API_EVENT(conn, NETCONN_EVT_RCVPLUS, p->tot_len);
+    }
+    return ERR_OK;
+  }
+#endif /* LWIP_NETCONN_RECV_QUEUE */
+
   if (p != NULL) {
     msg = p;
     len = p->tot_len;
@@ -376,6 +429,25 @@ poll_tcp(void *arg, struct tcp_pcb *pcb)
   }
   /* @todo: implement connect timeout here? */
 
+#if LWIP_NETCONN_RECV_QUEUE
+  /* Could recv_tcp() not post the wakeup for queued data? */
+  if ((conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_OWED) &&
+      NETCONN_MBOX_VALID(conn, &conn->recvmbox)) {
+    u8_t wakeup;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    wakeup = (conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_OWED);
+    if (wakeup) {
+      conn->recvq_wakeup = NETCONN_RECVQ_WAKEUP_POSTED;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    if (wakeup) {
+      recv_tcp_wakeup(conn);
+    }
+  }
+#endif /* LWIP_NETCONN_RECV_QUEUE */
+
   /* Did a nonblocking write fail before? Then check available write-space. */
   if (conn->flags & NETCONN_FLAG_CHECK_WRITESPACE) {
     /* If the queued byte- or pbuf-count drops below the configured low-water limit,
@@ -761,6 +833,11 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
 #if LWIP_TCP
   sys_mbox_set_invalid(&conn->acceptmbox);
 #endif
+#if LWIP_TCP && LWIP_NETCONN_RECV_QUEUE
+  conn->recvq_head   = NULL;
+  conn->recvq_tail   = NULL;
+  conn->recvq_wakeup = NETCONN_RECVQ_WAKEUP_NONE;
+#endif /* LWIP_TCP && LWIP_NETCONN_RECV_QUEUE */
   conn->state        = NETCONN_NONE;
   /* initialize socket to -1 since 0 is a valid socket */
   conn->callback_arg.socket = -1;
@@ -848,7 +925,11 @@ netconn_drain(struct netconn *conn)
 #if LWIP_TCP
         if (NETCONNTYPE_GROUP(conn->type) == NETCONN_TCP) {
           err_t err;
-          if (!lwip_netconn_is_err_msg(mem, &err)) {
+          if (!lwip_netconn_is_err_msg(mem, &err)
+#if LWIP_NETCONN_RECV_QUEUE
+              && (mem != conn)
+#endif /* LWIP_NETCONN_RECV_QUEUE */
+             ) {
             pbuf_free((struct pbuf *)mem);
           }
         } else
@@ -861,6 +942,12 @@ netconn_drain(struct netconn *conn)
     sys_mbox_free(&conn->recvmbox);
     sys_mbox_set_invalid(&conn->recvmbox);
   }
+#if LWIP_TCP && LWIP_NETCONN_RECV_QUEUE
+  if (conn->recvq_head != NULL) {
+    pbuf_free(conn->recvq_head);
+    conn->recvq_head = conn->recvq_tail = NULL;
+  }
+#endif /* LWIP_TCP && LWIP_NETCONN_RECV_QUEUE */
 
   /* Delete and drain the acceptmbox. */
 #if LWIP_TCP
@@ -1582,6 +1669,123 @@ lwip_netconn_do_send(void *m)
   TCPIP_APIMSG_ACK(msg);
 }
 
+#if LWIP_UDP
+/**
+ * Send one netbuf of a batch over a UDP pcb. Consecutive datagrams to the
+ * same destination reuse the route of the previous one: the netif cannot go
+ * away while the batch holds the core lock (or runs in tcpip_thread).
+ * ARP resolution is reused by etharp's cache of the last used entry.
+ *
+ * @param pcb the udp_pcb to send with
+ * @param buf the netbuf to send
+ * @param last_dst destination of the previous datagram of this batch
+ * @param last_netif route of last_dst, NULL if none yet
+ */
+static err_t
+lwip_netconn_send_udp_batched(struct udp_pcb *pcb, struct netbuf *buf,
+                              ip_addr_t *last_dst, struct netif **last_netif)
+{
+  const ip_addr_t *dst_ip;
+  u16_t dst_port;
+
+  if (ip_addr_isany_val(buf->addr) || IP_IS_ANY_TYPE_VAL(buf->addr)) {
+    if (IP_IS_ANY_TYPE_VAL(pcb->remote_ip)) {
+      /* let udp_send() report the error */
+      dst_ip = NULL;
+    } else {
+      dst_ip = &pcb->remote_ip;
+    }
+    dst_port = pcb->remote_port;
+  } else {
+    dst_ip = &buf->addr;
+    dst_port = buf->port;
+  }
+
+  if ((dst_ip != NULL) && (pcb->netif_idx == NETIF_NO_INDEX) &&
+      !ip_addr_ismulticast(dst_ip) && IP_ADDR_PCB_VERSION_MATCH(pcb, dst_ip)) {
+    if ((*last_netif == NULL) || !ip_addr_eq(last_dst, dst_ip)) {
+      *last_netif = ip_route(&pcb->local_ip, dst_ip);
+      ip_addr_copy(*last_dst, *dst_ip);
+    }
+    if (*last_netif != NULL) {
+#if LWIP_CHECKSUM_ON_COPY
+      return udp_sendto_if_chksum(pcb, buf->p, dst_ip, dst_port, *last_netif,
+                                  buf->flags & NETBUF_FLAG_CHKSUM, buf->toport_chksum);
+#else /* LWIP_CHECKSUM_ON_COPY */
+      return udp_sendto_if(pcb, buf->p, dst_ip, dst_port, *last_netif);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+    }
+  }
+
+  /* bound to a netif, multicast, no route: the regular path handles these */
+#if LWIP_CHECKSUM_ON_COPY
+  if (dst_ip == NULL) {
+    return udp_send_chksum(pcb, buf->p, buf->flags & NETBUF_FLAG_CHKSUM, buf->toport_chksum);
+  }
+  return udp_sendto_chksum(pcb, buf->p, dst_ip, dst_port,
+                           buf->flags & NETBUF_FLAG_CHKSUM, buf->toport_chksum);
+#else /* LWIP_CHECKSUM_ON_COPY */
+  if (dst_ip == NULL) {
+    return udp_send(pcb, buf->p);
+  }
+  return udp_sendto(pcb, buf->p, dst_ip, dst_port);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+}
+#endif /* LWIP_UDP */
+
+/**
+ * Send several netbufs on a RAW or UDP pcb, stopping at the first error.
+ * Called from netconn_send_batch
+ *
+ * @param m the api_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send_batch(void *m)
+{
+  struct api_msg *msg = (struct api_msg *)m;
+#if LWIP_UDP
+  ip_addr_t last_dst;
+  struct netif *last_netif = NULL;
+#endif /* LWIP_UDP */
+  u16_t i;
+
+  err_t err = netconn_err(msg->conn);
+  if ((err == ERR_OK) && (msg->conn->pcb.tcp == NULL)) {
+    err = ERR_CONN;
+  }
+#if LWIP_UDP
+  ip_addr_set_zero(&last_dst);
+#endif /* LWIP_UDP */
+  for (i = 0; (err == ERR_OK) && (i < msg->msg.bb.count); i++) {
+    struct netbuf *buf = &msg->msg.bb.bufs[i];
+    switch (NETCONNTYPE_GROUP(msg->conn->type)) {
+#if LWIP_RAW
+      case NETCONN_RAW:
+        if (ip_addr_isany(&buf->addr) || IP_IS_ANY_TYPE_VAL(buf->addr)) {
+          err = raw_send(msg->conn->pcb.raw, buf->p);
+        } else {
+          err = raw_sendto(msg->conn->pcb.raw, buf->p, &buf->addr);
+        }
+        break;
+#endif
+#if LWIP_UDP
+      case NETCONN_UDP:
+        err = lwip_netconn_send_udp_batched(msg->conn->pcb.udp, buf, &last_dst, &last_netif);
+        break;
+#endif /* LWIP_UDP */
+      default:
+        err = ERR_CONN;
+        break;
+    }
+    if (err == ERR_OK) {
+      msg->msg.bb.sent++;
+    }
+  }
+  /* a partly sent batch is a success, the caller sees how much was sent */
+  msg->err = (msg->msg.bb.sent > 0) ? ERR_OK : err;
+  TCPIP_APIMSG_ACK(msg);
+}
+
 #if LWIP_TCP
 /**
  * Indicate data has been received from a TCP pcb contained in a netconn
@@ -322,6 +322,29 @@ static volatile int select_cb_ctr;
 static struct lwip_select_cb *select_cb_list;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/** epoll instances are numbered after the sockets */
+#define LWIP_EPOLL_FD_OFFSET (LWIP_SOCKET_OFFSET + NUM_SOCKETS)
+
+/** An epoll instance, protected by SYS_ARCH_PROTECT like the socket events */
+struct lwip_epoll {
+  /** 1 while the instance is open */
+  u8_t used;
+  /** 1 while a task waits in lwip_epoll_wait */
+  u8_t waiting;
+  /** don't signal the semaphore twice: set to 1 when signalled */
+  u8_t sem_signalled;
+  /** registered sockets with pending events, oldest first */
+  struct lwip_epoll_item *ready_head;
+  struct lwip_epoll_item *ready_tail;
+  /** semaphore to wake up the task waiting in lwip_epoll_wait */
+  SELECT_SEM_T sem;
+};
+
+/** The global array of epoll instances */
+static struct lwip_epoll epolls[LWIP_SOCKET_EPOLL_NUM];
+#endif /* LWIP_SOCKET_EPOLL */
+
 /* Forward declaration of some functions */
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
 static void event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len);
@@ -330,6 +353,11 @@ static void select_check_waiters(int s, int has_recvevent, int has_sendevent, in
 #else
 #define DEFAULT_SOCKET_EVENTCB NULL
 #endif
+#if LWIP_SOCKET_EPOLL
+static int lwip_epoll_close(int epfd);
+static void lwip_epoll_drop_socket(struct lwip_sock *sock);
+static void lwip_epoll_sock_event(struct lwip_sock *sock);
+#endif /* LWIP_SOCKET_EPOLL */
 #if !LWIP_TCPIP_CORE_LOCKING
 static void lwip_getsockopt_callback(void *arg);
 static void lwip_setsockopt_callback(void *arg);
@@ -557,6 +585,9 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].fd_free_pending = 0;
 #endif
       sockets[i].conn       = newconn;
+#if LWIP_SOCKET_ZEROCOPY_RECV
+      sockets[i].gen++;
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV */
       /* The socket is not yet known to anyone, so no need to protect
          after having marked it as used. */
       SYS_ARCH_UNPROTECT(lev);
@@ -569,6 +600,9 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].sendevent  = (NETCONNTYPE_GROUP(newconn->type) == NETCONN_TCP ? (accepted != 0) : 1);
       sockets[i].errevent   = 0;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+      LWIP_ASSERT("sockets[i].epoll_items == NULL", sockets[i].epoll_items == NULL);
+#endif /* LWIP_SOCKET_EPOLL */
       return i + LWIP_SOCKET_OFFSET;
     }
     SYS_ARCH_UNPROTECT(lev);
@@ -815,6 +849,12 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if ((s >= LWIP_EPOLL_FD_OFFSET) && (s < LWIP_EPOLL_FD_OFFSET + LWIP_SOCKET_EPOLL_NUM)) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     return -1;
@@ -842,6 +882,10 @@ lwip_close(int s)
     return -1;
   }
 
+#if LWIP_SOCKET_EPOLL
+  /* remove the socket from all epoll instances */
+  lwip_epoll_drop_socket(sock);
+#endif /* LWIP_SOCKET_EPOLL */
   free_socket(sock, is_tcp);
   set_errno(0);
   return 0;
@@ -1315,6 +1359,28 @@ lwip_recv(int s, void *mem, size_t len, int flags)
   return lwip_recvfrom(s, mem, len, flags, NULL, NULL);
 }
 
+/**
+ * Check the vectors of a message to receive into.
+ *
+ * @return the summed up vector lengths; -1 if a vector is invalid
+ */
+static ssize_t
+lwip_recvmsg_buflen(const struct msghdr *message)
+{
+  msg_iovlen_t i;
+  ssize_t buflen = 0;
+
+  for (i = 0; i < message->msg_iovlen; i++) {
+    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
+        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
+        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
+      return -1;
+    }
+    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  }
+  return buflen;
+}
+
 ssize_t
 lwip_recvmsg(int s, struct msghdr *message, int flags)
 {
@@ -1337,17 +1403,11 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
     return -1;
   }
 
-  /* check for valid vectors */
-  buflen = 0;
-  for (i = 0; i < message->msg_iovlen; i++) {
-    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
-        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
-        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
-      set_errno(err_to_errno(ERR_VAL));
-      done_socket(sock);
-      return -1;
-    }
-    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  buflen = lwip_recvmsg_buflen(message);
+  if (buflen < 0) {
+    set_errno(err_to_errno(ERR_VAL));
+    done_socket(sock);
+    return -1;
   }
 
   if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
@@ -1416,6 +1476,327 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
 #endif /* LWIP_UDP || LWIP_RAW */
 }
 
+/**
+ * Receive several datagrams with one call. Only the first datagram is waited
+ * for (as with MSG_WAITFORONE), the call returns when no more are queued.
+ * The socket is looked up once and datagrams queued already are taken off
+ * the receive mailbox back to back.
+ *
+ * @param timeout unsupported, must be NULL
+ * @return number of messages received; -1 on error
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timeval *timeout)
+{
+  struct lwip_sock *sock;
+  unsigned int i;
+  int recv_flags;
+  int errval = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n", s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) && (vlen > 0),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: unsupported flags", (flags & ~(MSG_DONTWAIT|MSG_WAITFORONE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: unsupported timeout", timeout == NULL,
+             set_errno(EOPNOTSUPP); return -1;);
+  if (vlen > IOV_MAX) {
+    vlen = IOV_MAX;
+  }
+  recv_flags = flags & MSG_DONTWAIT;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    /* nothing to batch for streams: one lwip_recvmsg per message */
+    done_socket(sock);
+    for (i = 0; i < vlen; i++) {
+      ssize_t ret = lwip_recvmsg(s, &msgvec[i].msg_hdr, recv_flags);
+      if (ret <= 0) {
+        if ((ret == 0) && (i == 0)) {
+          /* end of stream */
+          msgvec[i].msg_len = 0;
+          i++;
+        }
+        break;
+      }
+      msgvec[i].msg_len = (unsigned int)ret;
+      recv_flags |= MSG_DONTWAIT;
+    }
+    if (i > 0) {
+      set_errno(0);
+      return (int)i;
+    }
+    return -1;
+  }
+  /* else, UDP and RAW NETCONNs */
+#if LWIP_UDP || LWIP_RAW
+  for (i = 0; i < vlen; i++) {
+    struct msghdr *message = &msgvec[i].msg_hdr;
+    u16_t datagram_len = 0;
+    ssize_t buflen;
+    err_t err;
+
+    if ((message->msg_iovlen <= 0) || (message->msg_iovlen > IOV_MAX)) {
+      errval = EMSGSIZE;
+      break;
+    }
+    buflen = lwip_recvmsg_buflen(message);
+    if (buflen < 0) {
+      errval = err_to_errno(ERR_VAL);
+      break;
+    }
+    err = lwip_recvfrom_udp_raw(sock, recv_flags, message, &datagram_len, s);
+    if (err != ERR_OK) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg[UDP/RAW](%d): message %u, error is \"%s\"\n",
+                                  s, i, lwip_strerr(err)));
+      errval = err_to_errno(err);
+      break;
+    }
+    if (datagram_len > buflen) {
+      message->msg_flags |= MSG_TRUNC;
+    }
+    msgvec[i].msg_len = datagram_len;
+    /* don't wait for the following datagrams */
+    recv_flags |= MSG_DONTWAIT;
+  }
+  done_socket(sock);
+  if (i > 0) {
+    set_errno(0);
+    return (int)i;
+  }
+  set_errno(errval);
+  return -1;
+#else /* LWIP_UDP || LWIP_RAW */
+  LWIP_UNUSED_ARG(errval);
+  set_errno(err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+#if LWIP_SOCKET_ZEROCOPY_RECV
+/* Point the vectors of a zero-copy receive at the payloads of a pbuf chain.
+ * Returns the number of bytes lent, *rest is the first pbuf that did not fit.
+ */
+static u16_t
+lwip_recvmsg_zc_fill(struct pbuf *p, struct msghdr *message, struct pbuf **rest)
+{
+  struct pbuf *q;
+  msg_iovlen_t i;
+  u16_t lent = 0;
+
+  for (q = p, i = 0; (q != NULL) && (i < message->msg_iovlen); q = q->next, i++) {
+    message->msg_iov[i].iov_base = q->payload;
+    message->msg_iov[i].iov_len = q->len;
+    lent = (u16_t)(lent + q->len);
+  }
+  message->msg_iovlen = i;
+  *rest = q;
+  return lent;
+}
+
+#if LWIP_TCP
+static ssize_t
+lwip_recvmsg_zc_tcp(struct lwip_sock *sock, struct msghdr *message, struct pbuf **lent_p, int flags)
+{
+  u8_t apiflags = NETCONN_NOAUTORCVD;
+  struct pbuf *p;
+  struct pbuf *rest;
+  u16_t lent;
+
+  if (flags & MSG_DONTWAIT) {
+    apiflags |= NETCONN_DONTBLOCK;
+  }
+
+  /* Check if there is data left from the last recv operation. */
+  p = sock->lastdata.pbuf;
+  if (p == NULL) {
+    err_t err = netconn_recv_tcp_pbuf_flags(sock->conn, &p, apiflags);
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zc_tcp: netconn_recv err=%d, pbuf=%p\n",
+                                err, (void *)p));
+    if (err != ERR_OK) {
+      set_errno(err_to_errno(err));
+      return (err == ERR_CLSD) ? 0 : -1;
+    }
+    LWIP_ASSERT("p != NULL", p != NULL);
+  }
+  sock->lastdata.pbuf = NULL;
+
+  lent = lwip_recvmsg_zc_fill(p, message, &rest);
+  if (rest != NULL) {
+    /* cut off the pbufs that did not fit, they are left for the next recv */
+    struct pbuf *q;
+    for (q = p; ; q = q->next) {
+      q->tot_len = (u16_t)(q->tot_len - rest->tot_len);
+      if (q->next == rest) {
+        q->next = NULL;
+        break;
+      }
+    }
+    sock->lastdata.pbuf = rest;
+  }
+  /* the window is updated when the pbufs are released */
+  *lent_p = p;
+  set_errno(0);
+  return lent;
+}
+#endif /* LWIP_TCP */
+
+#if LWIP_UDP || LWIP_RAW
+static ssize_t
+lwip_recvmsg_zc_udp_raw(struct lwip_sock *sock, struct msghdr *message, struct pbuf **lent_p, int flags)
+{
+  struct netbuf *buf;
+  struct pbuf *rest;
+  u16_t lent;
+
+  /* Check if there is data left from the last (peeking) recv operation. */
+  buf = sock->lastdata.netbuf;
+  if (buf == NULL) {
+    err_t err = netconn_recv_udp_raw_netbuf_flags(sock->conn, &buf, (flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0);
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zc_udp_raw: netconn_recv err=%d, netbuf=%p\n",
+                                err, (void *)buf));
+    if (err != ERR_OK) {
+      set_errno(err_to_errno(err));
+      return -1;
+    }
+    LWIP_ASSERT("buf != NULL", buf != NULL);
+  }
+  sock->lastdata.netbuf = NULL;
+
+  lent = lwip_recvmsg_zc_fill(buf->p, message, &rest);
+  if (rest != NULL) {
+    message->msg_flags |= MSG_TRUNC;
+  }
+  if (message->msg_name && message->msg_namelen) {
+    lwip_sock_make_addr(sock->conn, netbuf_fromaddr(buf), netbuf_fromport(buf),
+                        (struct sockaddr *)message->msg_name, &message->msg_namelen);
+  }
+  message->msg_controllen = 0;
+
+  /* the datagram is lent as a whole, only the netbuf goes back now */
+  *lent_p = buf->p;
+  buf->p = buf->ptr = NULL;
+  netbuf_delete(buf);
+  set_errno(0);
+  return lent;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
+/**
+ * Zero-copy receive: instead of copying into the buffers of the message's
+ * vectors, point the vectors at the payloads of the received pbufs.
+ * msg_iovlen is the number of vectors available on input and the number
+ * used on return. The data is read-only and stays valid until *handle is
+ * passed to lwip_recvmsg_zc_release(); for TCP, the receive window is only
+ * opened again then. A stream's pbufs that do not fit into the vectors are
+ * kept for the next receive, a datagram that does not fit is cut short
+ * (MSG_TRUNC). No control messages are returned.
+ *
+ * @return number of bytes lent; 0 at the end of a stream; -1 on error
+ *         (ENOMEM if MEMP_NUM_ZC_HANDLE receives are lent already).
+ *         *handle is NULL when nothing was lent.
+ */
+ssize_t
+lwip_recvmsg_zc(int s, struct msghdr *message, void **handle, int flags)
+{
+  struct lwip_sock *sock;
+  struct lwip_zc_handle *zc;
+  struct pbuf *p = NULL;
+  ssize_t ret;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zc(%d, message=%p, flags=0x%x)\n", s, (void *)message, flags));
+  LWIP_ERROR("lwip_recvmsg_zc: invalid arguments",
+             (message != NULL) && (message->msg_iov != NULL) && (handle != NULL),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_recvmsg_zc: unsupported flags", (flags & ~MSG_DONTWAIT) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+  *handle = NULL;
+
+  if ((message->msg_iovlen <= 0) || (message->msg_iovlen > IOV_MAX)) {
+    set_errno(EMSGSIZE);
+    return -1;
+  }
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  /* allocated up front: nothing is received if there is no handle for it */
+  zc = (struct lwip_zc_handle *)memp_malloc(MEMP_ZC_HANDLE);
+  if (zc == NULL) {
+    done_socket(sock);
+    set_errno(ENOMEM);
+    return -1;
+  }
+
+  message->msg_flags = 0;
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+#if LWIP_TCP
+    ret = lwip_recvmsg_zc_tcp(sock, message, &p, flags);
+#else /* LWIP_TCP */
+    set_errno(err_to_errno(ERR_ARG));
+    ret = -1;
+#endif /* LWIP_TCP */
+  } else {
+#if LWIP_UDP || LWIP_RAW
+    ret = lwip_recvmsg_zc_udp_raw(sock, message, &p, flags);
+#else /* LWIP_UDP || LWIP_RAW */
+    set_errno(err_to_errno(ERR_ARG));
+    ret = -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+  }
+  if (p != NULL) {
+    zc->p = p;
+    zc->sock = sock;
+    zc->sock_gen = sock->gen;
+    *handle = zc;
+  } else {
+    memp_free(MEMP_ZC_HANDLE, zc);
+  }
+  done_socket(sock);
+  return ret;
+}
+
+/**
+ * Give back the pbufs lent by lwip_recvmsg_zc(). For TCP, this opens the
+ * receive window by the number of bytes lent, but only on the socket they
+ * came from: if s was closed (EBADF), or closed and allocated again for
+ * another connection, or refers to another socket, the pbufs are just
+ * freed.
+ */
+int
+lwip_recvmsg_zc_release(int s, void *handle)
+{
+  struct lwip_zc_handle *zc = (struct lwip_zc_handle *)handle;
+  struct lwip_sock *sock;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg_zc_release(%d, handle=%p)\n", s, handle));
+  LWIP_ERROR("lwip_recvmsg_zc_release: invalid handle", (zc != NULL) && (zc->p != NULL),
+             set_errno(EINVAL); return -1;);
+
+  sock = get_socket(s);
+#if LWIP_TCP
+  if ((sock != NULL) && (sock == zc->sock) && (sock->gen == zc->sock_gen) &&
+      (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP)) {
+    netconn_tcp_recvd(sock->conn, zc->p->tot_len);
+  }
+#endif /* LWIP_TCP */
+  pbuf_free(zc->p);
+  memp_free(MEMP_ZC_HANDLE, zc);
+  if (sock == NULL) {
+    return -1;
+  }
+  done_socket(sock);
+  set_errno(0);
+  return 0;
+}
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV */
+
 ssize_t
 lwip_send(int s, const void *data, size_t size, int flags)
 {
@@ -1456,6 +1837,114 @@ lwip_send(int s, const void *data, size_t size, int flags)
   return (err == ERR_OK ? (ssize_t)written : -1);
 }
 
+#if LWIP_UDP || LWIP_RAW
+/**
+ * Set up a netbuf with the destination and the data of a message to send
+ * on a UDP or RAW socket (shared by lwip_sendmsg and lwip_sendmmsg).
+ * chain_buf must be freed with netbuf_free() also on error.
+ *
+ * @param msg the message to send
+ * @param chain_buf the netbuf to set up
+ * @param size the datagram size is stored here
+ * @return ERR_OK, ERR_MEM, ERR_ARG for an invalid message or ERR_VAL if the
+ *         datagram is too big (EMSGSIZE)
+ */
+static err_t
+lwip_sendmsg_udp_raw_netbuf(const struct msghdr *msg, struct netbuf *chain_buf, ssize_t *size)
+{
+  msg_iovlen_t i;
+  err_t err = ERR_OK;
+
+  /* initialize chain buffer with destination */
+  memset(chain_buf, 0, sizeof(struct netbuf));
+  LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
+             IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
+             return ERR_ARG;);
+  if (msg->msg_name) {
+    u16_t remote_port;
+    SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf->addr, remote_port);
+    netbuf_fromport(chain_buf) = remote_port;
+  }
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  *size = 0;
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    *size += msg->msg_iov[i].iov_len;
+    if ((msg->msg_iov[i].iov_len > INT_MAX) || (*size < (int)msg->msg_iov[i].iov_len)) {
+      /* overflow */
+      return ERR_VAL;
+    }
+  }
+  if (*size > 0xFFFF) {
+    /* overflow */
+    return ERR_VAL;
+  }
+  /* Allocate a new netbuf and copy the data into it. */
+  if (netbuf_alloc(chain_buf, (u16_t)*size) == NULL) {
+    err = ERR_MEM;
+  } else {
+    /* flatten the IO vectors */
+    size_t offset = 0;
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      MEMCPY(&((u8_t *)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+      offset += msg->msg_iov[i].iov_len;
+    }
+#if LWIP_CHECKSUM_ON_COPY
+    {
+      /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
+      u16_t chksum = ~inet_chksum_pbuf(chain_buf->p);
+      netbuf_set_chksum(chain_buf, chksum);
+    }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+    err = ERR_OK;
+  }
+#else /* LWIP_NETIF_TX_SINGLE_PBUF */
+  /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
+     manually to avoid having to allocate, chain, and delete a netbuf for each iov */
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    struct pbuf *p;
+    if (msg->msg_iov[i].iov_len > 0xFFFF) {
+      /* overflow */
+      return ERR_VAL;
+    }
+    p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
+      break;
+    }
+    p->payload = msg->msg_iov[i].iov_base;
+    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
+    /* netbuf empty, add new pbuf */
+    if (chain_buf->p == NULL) {
+      chain_buf->p = chain_buf->ptr = p;
+      /* add pbuf to existing pbuf chain */
+    } else {
+      if (chain_buf->p->tot_len + p->len > 0xffff) {
+        /* overflow */
+        pbuf_free(p);
+        return ERR_VAL;
+      }
+      pbuf_cat(chain_buf->p, p);
+    }
+  }
+  /* save size of total chain */
+  if (err == ERR_OK) {
+    *size = netbuf_len(chain_buf);
+  }
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+
+#if LWIP_IPV4 && LWIP_IPV6
+  if (err == ERR_OK) {
+    /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
+    if (IP_IS_V6_VAL(chain_buf->addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf->addr))) {
+      unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf->addr), ip_2_ip6(&chain_buf->addr));
+      IP_SET_TYPE_VAL(chain_buf->addr, IPADDR_TYPE_V4);
+    }
+  }
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+  return err;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
 ssize_t
 lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 {
@@ -1506,98 +1995,19 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 #if LWIP_UDP || LWIP_RAW
   {
     struct netbuf chain_buf;
-    msg_iovlen_t i;
     ssize_t size = 0;
 
     LWIP_UNUSED_ARG(flags);
-    LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
-               IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
-               set_errno(err_to_errno(ERR_ARG)); done_socket(sock); return -1;);
-
-    /* initialize chain buffer with destination */
-    memset(&chain_buf, 0, sizeof(struct netbuf));
-    if (msg->msg_name) {
-      u16_t remote_port;
-      SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf.addr, remote_port);
-      netbuf_fromport(&chain_buf) = remote_port;
-    }
-#if LWIP_NETIF_TX_SINGLE_PBUF
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      size += msg->msg_iov[i].iov_len;
-      if ((msg->msg_iov[i].iov_len > INT_MAX) || (size < (int)msg->msg_iov[i].iov_len)) {
-        /* overflow */
-        goto sendmsg_emsgsize;
-      }
-    }
-    if (size > 0xFFFF) {
-      /* overflow */
-      goto sendmsg_emsgsize;
-    }
-    /* Allocate a new netbuf and copy the data into it. */
-    if (netbuf_alloc(&chain_buf, (u16_t)size) == NULL) {
-      err = ERR_MEM;
-    } else {
-      /* flatten the IO vectors */
-      size_t offset = 0;
-      for (i = 0; i < msg->msg_iovlen; i++) {
-        MEMCPY(&((u8_t *)chain_buf.p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
-        offset += msg->msg_iov[i].iov_len;
-      }
-#if LWIP_CHECKSUM_ON_COPY
-      {
-        /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
-        u16_t chksum = ~inet_chksum_pbuf(chain_buf.p);
-        netbuf_set_chksum(&chain_buf, chksum);
-      }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-      err = ERR_OK;
-    }
-#else /* LWIP_NETIF_TX_SINGLE_PBUF */
-    /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
-       manually to avoid having to allocate, chain, and delete a netbuf for each iov */
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      struct pbuf *p;
-      if (msg->msg_iov[i].iov_len > 0xFFFF) {
-        /* overflow */
-        goto sendmsg_emsgsize;
-      }
-      p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
-      if (p == NULL) {
-        err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
-        break;
-      }
-      p->payload = msg->msg_iov[i].iov_base;
-      p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
-      /* netbuf empty, add new pbuf */
-      if (chain_buf.p == NULL) {
-        chain_buf.p = chain_buf.ptr = p;
-        /* add pbuf to existing pbuf chain */
-      } else {
-        if (chain_buf.p->tot_len + p->len > 0xffff) {
-          /* overflow */
-          pbuf_free(p);
-          goto sendmsg_emsgsize;
-        }
-        pbuf_cat(chain_buf.p, p);
-      }
-    }
-    /* save size of total chain */
-    if (err == ERR_OK) {
-      size = netbuf_len(&chain_buf);
-    }
-#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
-
+    err = lwip_sendmsg_udp_raw_netbuf(msg, &chain_buf, &size);
     if (err == ERR_OK) {
-#if LWIP_IPV4 && LWIP_IPV6
-      /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
-      if (IP_IS_V6_VAL(chain_buf.addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf.addr))) {
-        unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf.addr), ip_2_ip6(&chain_buf.addr));
-        IP_SET_TYPE_VAL(chain_buf.addr, IPADDR_TYPE_V4);
-      }
-#endif /* LWIP_IPV4 && LWIP_IPV6 */
-
       /* send the data */
       err = netconn_send(sock->conn, &chain_buf);
+    } else if (err == ERR_VAL) {
+      /* overflow */
+      netbuf_free(&chain_buf);
+      set_errno(EMSGSIZE);
+      done_socket(sock);
+      return -1;
     }
 
     /* deallocated the buffer */
@@ -1606,13 +2016,107 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
     set_errno(err_to_errno(err));
     done_socket(sock);
     return (err == ERR_OK ? size : -1);
-sendmsg_emsgsize:
-    set_errno(EMSGSIZE);
-    netbuf_free(&chain_buf);
+  }
+#else /* LWIP_UDP || LWIP_RAW */
+  set_errno(err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+/**
+ * Send several messages with one call. On UDP and RAW sockets, up to
+ * LWIP_SOCKET_MMSG_BATCH datagrams are passed to the stack at once (one core
+ * lock or tcpip message, see netconn_send_batch()), where consecutive
+ * datagrams to the same destination share the route lookup.
+ *
+ * @return number of messages sent; -1 on error
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int sent = 0;
+  int errval = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_sendmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n", s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) && (vlen > 0),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_sendmmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+  if (vlen > IOV_MAX) {
+    vlen = IOV_MAX;
+  }
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    /* nothing to batch for streams: one lwip_sendmsg per message */
     done_socket(sock);
+    for (sent = 0; sent < vlen; sent++) {
+      ssize_t ret = lwip_sendmsg(s, &msgvec[sent].msg_hdr, flags);
+      if (ret < 0) {
+        break;
+      }
+      msgvec[sent].msg_len = (unsigned int)ret;
+    }
+    if (sent > 0) {
+      set_errno(0);
+      return (int)sent;
+    }
     return -1;
   }
+  /* else, UDP and RAW NETCONNs */
+#if LWIP_UDP || LWIP_RAW
+  while ((errval == 0) && (sent < vlen)) {
+    struct netbuf bufs[LWIP_SOCKET_MMSG_BATCH];
+    u16_t count;
+    u16_t done = 0;
+    u16_t i;
+
+    /* set up the netbufs of the next batch */
+    for (count = 0; (count < LWIP_SOCKET_MMSG_BATCH) && (sent + count < vlen); count++) {
+      const struct msghdr *msg = &msgvec[sent + count].msg_hdr;
+      ssize_t size = 0;
+      err_t err;
+
+      if ((msg->msg_iov == NULL) || (msg->msg_iovlen <= 0) || (msg->msg_iovlen > IOV_MAX)) {
+        errval = EMSGSIZE;
+        break;
+      }
+      err = lwip_sendmsg_udp_raw_netbuf(msg, &bufs[count], &size);
+      if (err != ERR_OK) {
+        netbuf_free(&bufs[count]);
+        errval = (err == ERR_VAL) ? EMSGSIZE : err_to_errno(err);
+        break;
+      }
+      msgvec[sent + count].msg_len = (unsigned int)size;
+    }
+
+    if (count > 0) {
+      err_t err = netconn_send_batch(sock->conn, bufs, count, &done);
+      for (i = 0; i < count; i++) {
+        netbuf_free(&bufs[i]);
+      }
+      sent += done;
+      if (done < count) {
+        /* the error of the first datagram that was not sent */
+        errval = (err != ERR_OK) ? err_to_errno(err) : ENOBUFS;
+      }
+    }
+  }
+  done_socket(sock);
+  if (sent > 0) {
+    set_errno(0);
+    return (int)sent;
+  }
+  set_errno(errval);
+  return -1;
 #else /* LWIP_UDP || LWIP_RAW */
+  LWIP_UNUSED_ARG(errval);
   set_errno(err_to_errno(ERR_ARG));
   done_socket(sock);
   return -1;
@@ -2505,6 +3009,458 @@ lwip_poll_should_wake(const struct lwip_select_cb *scb, int fd, int has_recveven
 }
 #endif /* LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/**
+ * Map an epoll file descriptor to its instance.
+ *
+ * @param epfd file descriptor returned by lwip_epoll_create
+ * @return struct lwip_epoll for the instance or NULL if not open
+ */
+static struct lwip_epoll *
+get_epoll(int epfd)
+{
+  int i = epfd - LWIP_EPOLL_FD_OFFSET;
+  if ((i < 0) || (i >= LWIP_SOCKET_EPOLL_NUM) || !epolls[i].used) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_epoll(%d): invalid\n", epfd));
+    set_errno(EBADF);
+    return NULL;
+  }
+  return &epolls[i];
+}
+
+/* Events a socket currently has pending (called under SYS_ARCH_PROTECT). */
+static u32_t
+lwip_epoll_sock_ready(const struct lwip_sock *sock)
+{
+  u32_t events = 0;
+  if ((sock->lastdata.pbuf != NULL) || (sock->rcvevent > 0)) {
+    events |= EPOLLIN;
+  }
+  if (sock->sendevent != 0) {
+    events |= EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    /* EPOLLERR is reported whether requested or not */
+    events |= EPOLLERR;
+  }
+  return events;
+}
+
+/* Append item to the ready list and wake up the waiting task (called under SYS_ARCH_PROTECT). */
+static void
+lwip_epoll_enqueue(struct lwip_epoll *ep, struct lwip_epoll_item *item)
+{
+  LWIP_ASSERT("item not ready", !item->ready);
+  item->ready = 1;
+  item->ready_next = NULL;
+  if (ep->ready_tail != NULL) {
+    ep->ready_tail->ready_next = item;
+  } else {
+    ep->ready_head = item;
+  }
+  ep->ready_tail = item;
+
+  if (ep->waiting && !ep->sem_signalled) {
+    ep->sem_signalled = 1;
+    /* As in select_check_waiters, signal before unprotecting so the waiting
+       task cannot leave lwip_epoll_wait in between. */
+    sys_sem_signal(SELECT_SEM_PTR(ep->sem));
+  }
+}
+
+/* Remove item from the ready list (called under SYS_ARCH_PROTECT). */
+static void
+lwip_epoll_unlink_ready(struct lwip_epoll *ep, struct lwip_epoll_item *item)
+{
+  struct lwip_epoll_item *prev = NULL;
+  struct lwip_epoll_item *it;
+
+  for (it = ep->ready_head; it != NULL; prev = it, it = it->ready_next) {
+    if (it == item) {
+      if (prev != NULL) {
+        prev->ready_next = item->ready_next;
+      } else {
+        ep->ready_head = item->ready_next;
+      }
+      if (ep->ready_tail == item) {
+        ep->ready_tail = prev;
+      }
+      break;
+    }
+  }
+  LWIP_ASSERT("item on ready list", it != NULL);
+  item->ready = 0;
+  item->ready_next = NULL;
+}
+
+/**
+ * Called from event_callback (under SYS_ARCH_PROTECT) when a socket with
+ * epoll registrations became readable, writable or got an error: queues it
+ * on the ready list of every instance that is interested in its events.
+ */
+static void
+lwip_epoll_sock_event(struct lwip_sock *sock)
+{
+  struct lwip_epoll_item *item;
+  u32_t events = lwip_epoll_sock_ready(sock);
+
+  for (item = sock->epoll_items; item != NULL; item = item->sock_next) {
+    if (!item->ready && !item->disabled && ((events & (item->events | EPOLLERR)) != 0)) {
+      lwip_epoll_enqueue(item->ep, item);
+    }
+  }
+}
+
+/**
+ * Take events off the ready list (called under SYS_ARCH_PROTECT).
+ * Only the sockets that are on the list when called are examined: level
+ * triggered items that are reported go to the back of the list again, so
+ * the next call checks them again; items that are not ready any more and
+ * edge triggered items stay off the list until the next event.
+ *
+ * @return number of entries written to events
+ */
+static int
+lwip_epoll_collect(struct lwip_epoll *ep, struct epoll_event *events, int maxevents)
+{
+  struct lwip_epoll_item *last = ep->ready_tail;
+  struct lwip_epoll_item *item;
+  int nready = 0;
+
+  while ((nready < maxevents) && ((item = ep->ready_head) != NULL)) {
+    u32_t revents = 0;
+
+    ep->ready_head = item->ready_next;
+    if (ep->ready_head == NULL) {
+      ep->ready_tail = NULL;
+    }
+    item->ready = 0;
+    item->ready_next = NULL;
+
+    if (!item->disabled) {
+      struct lwip_sock *sock = tryget_socket_unconn_nouse(item->fd);
+      LWIP_ASSERT("registered socket exists", sock != NULL);
+      revents = lwip_epoll_sock_ready(sock) & (item->events | EPOLLERR);
+    }
+    if (revents != 0) {
+      events[nready].events = revents;
+      events[nready].data = item->data;
+      nready++;
+      if (item->events & EPOLLONESHOT) {
+        item->disabled = 1;
+      } else if (!(item->events & EPOLLET)) {
+        lwip_epoll_enqueue(ep, item);
+      }
+    }
+    if (item == last) {
+      break;
+    }
+  }
+  return nready;
+}
+
+/* Remove a socket that is being closed from all epoll instances. */
+static void
+lwip_epoll_drop_socket(struct lwip_sock *sock)
+{
+  struct lwip_epoll_item *items;
+  struct lwip_epoll_item *item;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  items = sock->epoll_items;
+  sock->epoll_items = NULL;
+  for (item = items; item != NULL; item = item->sock_next) {
+    if (item->ready) {
+      lwip_epoll_unlink_ready(item->ep, item);
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  while (items != NULL) {
+    item = items;
+    items = items->sock_next;
+    memp_free(MEMP_EPOLL_ITEM, item);
+  }
+}
+
+/* Close an epoll instance, called from lwip_close(). */
+static int
+lwip_epoll_close(int epfd)
+{
+  struct lwip_epoll *ep;
+  struct lwip_epoll_item *items = NULL;
+  struct lwip_epoll_item *item;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (ep->waiting) {
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EBUSY);
+    return -1;
+  }
+  /* closing is rare: walk all sockets instead of keeping a list per instance */
+  for (i = 0; i < NUM_SOCKETS; i++) {
+    struct lwip_epoll_item **pitem = &sockets[i].epoll_items;
+    while (*pitem != NULL) {
+      item = *pitem;
+      if (item->ep == ep) {
+        *pitem = item->sock_next;
+        item->sock_next = items;
+        items = item;
+      } else {
+        pitem = &item->sock_next;
+      }
+    }
+  }
+  ep->ready_head = NULL;
+  ep->ready_tail = NULL;
+  SYS_ARCH_UNPROTECT(lev);
+
+  while (items != NULL) {
+    item = items;
+    items = items->sock_next;
+    memp_free(MEMP_EPOLL_ITEM, item);
+  }
+#if !LWIP_NETCONN_SEM_PER_THREAD
+  sys_sem_free(&ep->sem);
+#endif /* !LWIP_NETCONN_SEM_PER_THREAD */
+  ep->used = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d): epoll instance closed\n", epfd));
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Create an epoll instance. Close it with lwip_close().
+ *
+ * @param size ignored, but must be greater than zero
+ * @return file descriptor of the instance; -1 on error
+ */
+int
+lwip_epoll_create(int size)
+{
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create(%d)\n", size));
+  LWIP_ERROR("lwip_epoll_create: invalid size", size > 0, set_errno(EINVAL); return -1;);
+
+  for (i = 0; i < LWIP_SOCKET_EPOLL_NUM; i++) {
+    SYS_ARCH_PROTECT(lev);
+    if (!epolls[i].used) {
+      epolls[i].used = 1;
+      SYS_ARCH_UNPROTECT(lev);
+      epolls[i].waiting = 0;
+      epolls[i].sem_signalled = 0;
+      epolls[i].ready_head = NULL;
+      epolls[i].ready_tail = NULL;
+#if !LWIP_NETCONN_SEM_PER_THREAD
+      if (sys_sem_new(&epolls[i].sem, 0) != ERR_OK) {
+        epolls[i].used = 0;
+        set_errno(ENOMEM);
+        return -1;
+      }
+#endif /* !LWIP_NETCONN_SEM_PER_THREAD */
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create() = %d\n", i + LWIP_EPOLL_FD_OFFSET));
+      set_errno(0);
+      return i + LWIP_EPOLL_FD_OFFSET;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  set_errno(ENFILE);
+  return -1;
+}
+
+/**
+ * Add, modify or remove the registration of a socket with an epoll instance.
+ * A socket that is ready already is queued right away. Closing a socket
+ * removes it from all instances.
+ *
+ * @param epfd epoll instance
+ * @param op EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL
+ * @param fd socket
+ * @param event events of interest (EPOLLIN, EPOLLOUT, optionally EPOLLET or
+ *              EPOLLONESHOT) and the data epoll_wait returns; unused for EPOLL_CTL_DEL
+ * @return 0 on success; -1 on error
+ */
+int
+lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_sock *sock;
+  struct lwip_epoll_item *item;
+  struct lwip_epoll_item *to_free = NULL;
+  struct lwip_epoll_item **pitem;
+  int err = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_ctl(%d, %d, %d)\n", epfd, op, fd));
+  LWIP_ERROR("lwip_epoll_ctl: invalid op",
+             (op == EPOLL_CTL_ADD) || (op == EPOLL_CTL_MOD) || (op == EPOLL_CTL_DEL),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_epoll_ctl: invalid event", (event != NULL) || (op == EPOLL_CTL_DEL),
+             set_errno(EINVAL); return -1;);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  sock = get_socket(fd);
+  if (sock == NULL) {
+    return -1;
+  }
+
+  if (op == EPOLL_CTL_ADD) {
+    /* allocate outside the protected region, freed again if already registered */
+    to_free = (struct lwip_epoll_item *)memp_malloc(MEMP_EPOLL_ITEM);
+    if (to_free == NULL) {
+      done_socket(sock);
+      set_errno(ENOMEM);
+      return -1;
+    }
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  for (pitem = &sock->epoll_items; *pitem != NULL; pitem = &(*pitem)->sock_next) {
+    if ((*pitem)->ep == ep) {
+      break;
+    }
+  }
+  item = *pitem;
+
+  if (op == EPOLL_CTL_ADD) {
+    if (item != NULL) {
+      err = EEXIST;
+    } else {
+      item = to_free;
+      to_free = NULL;
+      item->ep = ep;
+      item->fd = fd;
+      item->ready = 0;
+      item->ready_next = NULL;
+      item->sock_next = sock->epoll_items;
+      sock->epoll_items = item;
+    }
+  } else if (item == NULL) {
+    err = ENOENT;
+  } else if (op == EPOLL_CTL_DEL) {
+    *pitem = item->sock_next;
+    if (item->ready) {
+      lwip_epoll_unlink_ready(ep, item);
+    }
+    to_free = item;
+  }
+
+  if ((err == 0) && (op != EPOLL_CTL_DEL)) {
+    item->events = event->events;
+    item->data = event->data;
+    item->disabled = 0;
+    if (!item->ready && ((lwip_epoll_sock_ready(sock) & (item->events | EPOLLERR)) != 0)) {
+      lwip_epoll_enqueue(ep, item);
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  done_socket(sock);
+
+  if (to_free != NULL) {
+    memp_free(MEMP_EPOLL_ITEM, to_free);
+  }
+  if (err != 0) {
+    set_errno(err);
+    return -1;
+  }
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Wait for events on the sockets registered with an epoll instance.
+ * Only one task may wait on an instance at a time.
+ *
+ * @param epfd epoll instance
+ * @param events array that receives the events and the registered data
+ * @param maxevents number of entries in events
+ * @param timeout in milliseconds, -1 waits forever, 0 returns immediately
+ * @return number of entries written to events; 0 on timeout; -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  int nready;
+  u32_t start;
+  u32_t msectimeout;
+  u32_t waitres = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d, %p, %d, %d)\n",
+                              epfd, (void *)events, maxevents, timeout));
+  LWIP_ERROR("lwip_epoll_wait: invalid events", (events != NULL) && (maxevents > 0),
+             set_errno(EINVAL); return -1;);
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+
+  start = sys_now();
+  SYS_ARCH_PROTECT(lev);
+  if (ep->waiting) {
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EBUSY);
+    return -1;
+  }
+  for (;;) {
+    nready = lwip_epoll_collect(ep, events, maxevents);
+    if ((nready != 0) || (timeout == 0) || (waitres == SYS_ARCH_TIMEOUT)) {
+      break;
+    }
+    if (timeout < 0) {
+      /* Wait forever */
+      msectimeout = 0;
+    } else {
+      u32_t elapsed = sys_now() - start;
+      if (elapsed >= (u32_t)timeout) {
+        break;
+      }
+      msectimeout = (u32_t)timeout - elapsed;
+    }
+
+    /* None ready: wait to be woken by lwip_epoll_sock_event. After a wakeup
+       without events (e.g. another task read the data), wait again for the
+       rest of the timeout. */
+    ep->waiting = 1;
+    ep->sem_signalled = 0;
+#if LWIP_NETCONN_SEM_PER_THREAD
+    ep->sem = LWIP_NETCONN_THREAD_SEM_GET();
+#endif /* LWIP_NETCONN_SEM_PER_THREAD */
+    SYS_ARCH_UNPROTECT(lev);
+    waitres = sys_arch_sem_wait(SELECT_SEM_PTR(ep->sem), msectimeout);
+    SYS_ARCH_PROTECT(lev);
+    ep->waiting = 0;
+    if ((waitres == SYS_ARCH_TIMEOUT) && ep->sem_signalled) {
+      /* don't leave the semaphore signalled */
+      SYS_ARCH_UNPROTECT(lev);
+      sys_arch_sem_wait(SELECT_SEM_PTR(ep->sem), 1);
+      SYS_ARCH_PROTECT(lev);
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait: nready=%d\n", nready));
+  set_errno(0);
+  return nready;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
 /**
  * Callback registered in the netconn layer for each socket-netconn.
@@ -2590,6 +3546,14 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_EPOLL
+  if ((sock->epoll_items != NULL) &&
+      ((evt == NETCONN_EVT_RCVPLUS) || (evt == NETCONN_EVT_SENDPLUS) || (evt == NETCONN_EVT_ERROR))) {
+    /* queue the socket on the ready list of the epoll instances it is registered with */
+    lwip_epoll_sock_event(sock);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (sock->select_waiting && check_waiters) {
     /* Save which events are active */
     int has_recvevent, has_sendevent, has_errevent;
@@ -50,6 +50,8 @@
 #include "lwip/etharp.h"
 #include "netif/ethernet.h"
 
+#include <string.h>
+
 #define TCPIP_MSG_VAR_REF(name)     API_VAR_REF(name)
 #define TCPIP_MSG_VAR_DECLARE(name) API_VAR_DECLARE(struct tcpip_msg, name)
 #define TCPIP_MSG_VAR_ALLOC(name)   API_VAR_ALLOC(struct tcpip_msg, MEMP_TCPIP_MSG_API, name, ERR_MEM)
@@ -181,6 +183,21 @@ tcpip_thread_handle_msg(struct tcpip_msg *msg)
       }
       memp_free(MEMP_TCPIP_MSG_INPKT, msg);
       break;
+#if TCPIP_INPKT_BURST_MAX
+    case TCPIP_MSG_INPKT_BURST: {
+      struct tcpip_msg_inpkt_burst *burst = (struct tcpip_msg_inpkt_burst *)msg;
+      u16_t i;
+      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: PACKET BURST %p (%"U16_F")\n", (void *)msg, msg->msg.inp_burst.count));
+      /* the whole burst is processed before timeouts are checked again */
+      for (i = 0; i < msg->msg.inp_burst.count; i++) {
+        if (msg->msg.inp_burst.input_fn(burst->p[i], burst->netif[i]) != ERR_OK) {
+          pbuf_free(burst->p[i]);
+        }
+      }
+      memp_free(MEMP_TCPIP_MSG_INPKT_BURST, burst);
+      break;
+    }
+#endif /* TCPIP_INPKT_BURST_MAX */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 
 #if LWIP_TCPIP_TIMEOUT && LWIP_TIMERS
@@ -273,6 +290,60 @@ tcpip_inpkt(struct pbuf *p, struct netif *inp, netif_input_fn input_fn)
 #endif /* LWIP_TCPIP_CORE_LOCKING_INPUT */
 }
 
+#if TCPIP_INPKT_BURST_MAX
+/**
+ * Pass a burst of received packets to tcpip_thread for input processing
+ * in a single message.
+ *
+ * On ERR_OK, all packets are owned by the stack (packets rejected by
+ * input_fn are freed). On error, none of them was taken and the caller
+ * still owns all of them.
+ *
+ * @param p the received packets
+ * @param inp the network interface each packet was received on
+ * @param count number of packets, 1..TCPIP_INPKT_BURST_MAX
+ * @param input_fn input function to call for each packet
+ */
+err_t
+tcpip_inpkt_burst(struct pbuf **p, struct netif **inp, u16_t count, netif_input_fn input_fn)
+{
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+  u16_t i;
+  LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_inpkt_burst: %"U16_F" PACKETS\n", count));
+  LWIP_ASSERT("invalid burst", (count > 0) && (count <= TCPIP_INPKT_BURST_MAX));
+  LOCK_TCPIP_CORE();
+  for (i = 0; i < count; i++) {
+    if (input_fn(p[i], inp[i]) != ERR_OK) {
+      pbuf_free(p[i]);
+    }
+  }
+  UNLOCK_TCPIP_CORE();
+  return ERR_OK;
+#else /* LWIP_TCPIP_CORE_LOCKING_INPUT */
+  struct tcpip_msg_inpkt_burst *burst;
+
+  LWIP_ASSERT("Invalid mbox", sys_mbox_valid_val(tcpip_mbox));
+  LWIP_ASSERT("invalid burst", (count > 0) && (count <= TCPIP_INPKT_BURST_MAX));
+
+  burst = (struct tcpip_msg_inpkt_burst *)memp_malloc(MEMP_TCPIP_MSG_INPKT_BURST);
+  if (burst == NULL) {
+    return ERR_MEM;
+  }
+
+  burst->msg.type = TCPIP_MSG_INPKT_BURST;
+  burst->msg.msg.inp_burst.input_fn = input_fn;
+  burst->msg.msg.inp_burst.count = count;
+  MEMCPY(burst->p, p, count * sizeof(struct pbuf *));
+  MEMCPY(burst->netif, inp, count * sizeof(struct netif *));
+  if (sys_mbox_trypost(&tcpip_mbox, &burst->msg) != ERR_OK) {
+    memp_free(MEMP_TCPIP_MSG_INPKT_BURST, burst);
+    return ERR_MEM;
+  }
+  return ERR_OK;
+#endif /* LWIP_TCPIP_CORE_LOCKING_INPUT */
+}
+#endif /* TCPIP_INPKT_BURST_MAX */
+
 /**
  * @ingroup lwip_os
  * Pass a received packet to tcpip_thread for input processing with
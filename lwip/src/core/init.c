@@ -125,6 +125,9 @@ PACK_STRUCT_END
 #if ((LWIP_NETCONN || LWIP_SOCKET) && (MEMP_NUM_TCPIP_MSG_API<=0))
 #error "If you want to use Sequential API, you have to define MEMP_NUM_TCPIP_MSG_API>=1 in your lwipopts.h"
 #endif
+#if (LWIP_SOCKET && LWIP_SOCKET_EPOLL && !(LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL))
+#error "If you want to use LWIP_SOCKET_EPOLL, you have to define LWIP_SOCKET_SELECT==1 or LWIP_SOCKET_POLL==1 in your lwipopts.h"
+#endif
 /* There must be sufficient timeouts, taking into account requirements of the subsystems. */
 #if LWIP_TIMERS && (MEMP_NUM_SYS_TIMEOUT < LWIP_NUM_SYS_TIMEOUT_INTERNAL)
 #error "MEMP_NUM_SYS_TIMEOUT is too low to accommodate all required timeouts"
@@ -163,6 +166,9 @@ PACK_STRUCT_END
 #if (LWIP_TCP && TCP_LISTEN_BACKLOG && ((TCP_DEFAULT_LISTEN_BACKLOG < 0) || (TCP_DEFAULT_LISTEN_BACKLOG > 0xff)))
 #error "If you want to use TCP backlog, TCP_DEFAULT_LISTEN_BACKLOG must fit into an u8_t"
 #endif
+#if (LWIP_TCP && LWIP_TCP_WRITE_ZEROCOPY && !LWIP_SUPPORT_CUSTOM_PBUF)
+#error "To use LWIP_TCP_WRITE_ZEROCOPY, LWIP_SUPPORT_CUSTOM_PBUF needs to be enabled"
+#endif
 #if (LWIP_TCP && LWIP_TCP_SACK_OUT && !TCP_QUEUE_OOSEQ)
 #error "To use LWIP_TCP_SACK_OUT, TCP_QUEUE_OOSEQ needs to be enabled"
 #endif
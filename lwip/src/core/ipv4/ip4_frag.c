@@ -64,7 +64,9 @@
 
 /** Setting this to 0, you can turn off checking the fragments for overlapping
  * regions. The code gets a little smaller. Only use this if you know that
- * overlapping won't occur on your network! */
+ * overlapping won't occur on your network! (Completeness is detected by
+ * counting the bytes received, so overlapping fragments would corrupt the
+ * reassembled datagram.) */
 #ifndef IP_REASS_CHECK_OVERLAP
 #define IP_REASS_CHECK_OVERLAP 1
 #endif /* IP_REASS_CHECK_OVERLAP */
@@ -77,6 +79,15 @@
 #define IP_REASS_FREE_OLDEST 1
 #endif /* IP_REASS_FREE_OLDEST */
 
+/** Number of hash buckets used to find the datagram a fragment belongs to.
+ * Must be a power of 2. */
+#ifndef IP_REASS_HASH_SIZE
+#define IP_REASS_HASH_SIZE 8
+#endif /* IP_REASS_HASH_SIZE */
+#if (IP_REASS_HASH_SIZE & (IP_REASS_HASH_SIZE - 1)) != 0
+#error "IP_REASS_HASH_SIZE must be a power of 2"
+#endif
+
 #define IP_REASS_FLAG_LASTFRAG 0x01
 
 #define IP_REASS_VALIDATE_TELEGRAM_FINISHED  1
@@ -105,18 +116,28 @@ PACK_STRUCT_END
 #  include "arch/epstruct.h"
 #endif
 
-#define IP_ADDRESSES_AND_ID_MATCH(iphdrA, iphdrB)  \
+#define IP_ADDRESSES_ID_AND_PROTO_MATCH(iphdrA, iphdrB)  \
   (ip4_addr_eq(&(iphdrA)->src, &(iphdrB)->src) && \
    ip4_addr_eq(&(iphdrA)->dest, &(iphdrB)->dest) && \
-   IPH_ID(iphdrA) == IPH_ID(iphdrB)) ? 1 : 0
+   IPH_ID(iphdrA) == IPH_ID(iphdrB) && \
+   IPH_PROTO(iphdrA) == IPH_PROTO(iphdrB)) ? 1 : 0
+
+#define IP_REASS_HASH(iphdr) \
+  ((((iphdr)->src.addr ^ (iphdr)->dest.addr) ^ \
+    ((((iphdr)->src.addr ^ (iphdr)->dest.addr) >> 16) ^ IPH_ID(iphdr) ^ IPH_PROTO(iphdr))) & \
+   (IP_REASS_HASH_SIZE - 1))
 
 /* global variables */
+/** All datagrams being reassembled, oldest first */
 static struct ip_reassdata *reassdatagrams;
+static struct ip_reassdata *reassdatagrams_newest;
+/** The same datagrams, hashed by (src, dest, id, proto) */
+static struct ip_reassdata *reass_hash[IP_REASS_HASH_SIZE];
 static u16_t ip_reass_pbufcount;
 
 /* function prototypes */
-static void ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
-static int ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
+static void ip_reass_dequeue_datagram(struct ip_reassdata *ipr);
+static int ip_reass_free_complete_datagram(struct ip_reassdata *ipr);
 
 /**
  * Reassembly timer base function
@@ -127,7 +148,7 @@ static int ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_r
 void
 ip_reass_tmr(void)
 {
-  struct ip_reassdata *r, *prev = NULL;
+  struct ip_reassdata *r;
 
   r = reassdatagrams;
   while (r != NULL) {
@@ -136,7 +157,6 @@ ip_reass_tmr(void)
     if (r->timer > 0) {
       r->timer--;
       LWIP_DEBUGF(IP_REASS_DEBUG, ("ip_reass_tmr: timer dec %"U16_F"\n", (u16_t)r->timer));
-      prev = r;
       r = r->next;
     } else {
       /* reassembly timed out */
@@ -146,7 +166,7 @@ ip_reass_tmr(void)
       /* get the next pointer before freeing */
       r = r->next;
       /* free the helper struct and all enqueued pbufs */
-      ip_reass_free_complete_datagram(tmp, prev);
+      ip_reass_free_complete_datagram(tmp);
     }
   }
 }
@@ -157,22 +177,16 @@ ip_reass_tmr(void)
  * SNMP counters and sends an ICMP time exceeded packet.
  *
  * @param ipr datagram to free
- * @param prev the previous datagram in the linked list
  * @return the number of pbufs freed
  */
 static int
-ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev)
+ip_reass_free_complete_datagram(struct ip_reassdata *ipr)
 {
   u16_t pbufs_freed = 0;
   u16_t clen;
   struct pbuf *p;
   struct ip_reass_helper *iprh;
 
-  LWIP_ASSERT("prev != ipr", prev != ipr);
-  if (prev != NULL) {
-    LWIP_ASSERT("prev->next == ipr", prev->next == ipr);
-  }
-
   MIB2_STATS_INC(mib2.ipreasmfails);
 #if LWIP_ICMP
   iprh = (struct ip_reass_helper *)ipr->p->payload;
@@ -205,8 +219,9 @@ ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *p
     pbufs_freed = (u16_t)(pbufs_freed + clen);
     pbuf_free(pcur);
   }
-  /* Then, unchain the struct ip_reassdata from the list and free it. */
-  ip_reass_dequeue_datagram(ipr, prev);
+  LWIP_ASSERT("pbufs_freed == ipr->clen", pbufs_freed == ipr->clen);
+  /* Then, unchain the struct ip_reassdata from the lists and free it. */
+  ip_reass_dequeue_datagram(ipr);
   LWIP_ASSERT("ip_reass_pbufcount >= pbufs_freed", ip_reass_pbufcount >= pbufs_freed);
   ip_reass_pbufcount = (u16_t)(ip_reass_pbufcount - pbufs_freed);
 
@@ -226,48 +241,58 @@ ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *p
 static int
 ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
 {
-  /* @todo Can't we simply remove the last datagram in the
-   *       linked list behind reassdatagrams?
-   */
-  struct ip_reassdata *r, *oldest, *prev, *oldest_prev;
-  int pbufs_freed = 0, pbufs_freed_current;
-  int other_datagrams;
-
-  /* Free datagrams until being allowed to enqueue 'pbufs_needed' pbufs,
-   * but don't free the datagram that 'fraghdr' belongs to! */
-  do {
-    oldest = NULL;
-    prev = NULL;
-    oldest_prev = NULL;
-    other_datagrams = 0;
-    r = reassdatagrams;
-    while (r != NULL) {
-      if (!IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) {
-        /* Not the same datagram as fraghdr */
-        other_datagrams++;
-        if (oldest == NULL) {
-          oldest = r;
-          oldest_prev = prev;
-        } else if (r->timer <= oldest->timer) {
-          /* older than the previous oldest */
-          oldest = r;
-          oldest_prev = prev;
-        }
-      }
-      if (r->next != NULL) {
-        prev = r;
-      }
-      r = r->next;
-    }
-    if (oldest != NULL) {
-      pbufs_freed_current = ip_reass_free_complete_datagram(oldest, oldest_prev);
-      pbufs_freed += pbufs_freed_current;
+  struct ip_reassdata *r, *next;
+  int pbufs_freed = 0;
+
+  /* The list is sorted by age: free datagrams from its head until being
+   * allowed to enqueue 'pbufs_needed' pbufs, but don't free the datagram
+   * that 'fraghdr' belongs to! */
+  for (r = reassdatagrams; (r != NULL) && (pbufs_freed < pbufs_needed); r = next) {
+    next = r->next;
+    if (!IP_ADDRESSES_ID_AND_PROTO_MATCH(&r->iphdr, fraghdr)) {
+      pbufs_freed += ip_reass_free_complete_datagram(r);
     }
-  } while ((pbufs_freed < pbufs_needed) && (other_datagrams > 1));
+  }
   return pbufs_freed;
 }
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if IP_REASS_MAX_DATAGRAMS_PER_SRC
+/**
+ * Check if the source of 'fraghdr' may start reassembling another datagram.
+ * With IP_REASS_FREE_OLDEST, the oldest datagram of that source is freed
+ * if it is at its limit.
+ *
+ * @param fraghdr IP header of the current fragment
+ * @return 1 if a new datagram may be enqueued, 0 otherwise
+ */
+static int
+ip_reass_check_src_budget(struct ip_hdr *fraghdr)
+{
+  struct ip_reassdata *r, *oldest = NULL;
+  int datagrams = 0;
+
+  for (r = reassdatagrams; r != NULL; r = r->next) {
+    if (ip4_addr_eq(&r->iphdr.src, &fraghdr->src)) {
+      if (oldest == NULL) {
+        oldest = r;
+      }
+      datagrams++;
+    }
+  }
+  if (datagrams < IP_REASS_MAX_DATAGRAMS_PER_SRC) {
+    return 1;
+  }
+  LWIP_DEBUGF(IP_REASS_DEBUG, ("ip4_reass: too many datagrams from this source\n"));
+#if IP_REASS_FREE_OLDEST
+  ip_reass_free_complete_datagram(oldest);
+  return 1;
+#else /* IP_REASS_FREE_OLDEST */
+  return 0;
+#endif /* IP_REASS_FREE_OLDEST */
+}
+#endif /* IP_REASS_MAX_DATAGRAMS_PER_SRC */
+
 /**
  * Enqueues a new fragment into the fragment queue
  * @param fraghdr points to the new fragments IP hdr
@@ -278,6 +303,7 @@ static struct ip_reassdata *
 ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
 {
   struct ip_reassdata *ipr;
+  u16_t hash;
 #if ! IP_REASS_FREE_OLDEST
   LWIP_UNUSED_ARG(clen);
 #endif
@@ -300,12 +326,22 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
   memset(ipr, 0, sizeof(struct ip_reassdata));
   ipr->timer = IP_REASS_MAXAGE;
 
-  /* enqueue the new structure to the front of the list */
-  ipr->next = reassdatagrams;
-  reassdatagrams = ipr;
   /* copy the ip header for later tests and input */
   /* @todo: no ip options supported? */
   SMEMCPY(&(ipr->iphdr), fraghdr, IP_HLEN);
+
+  /* enqueue the new structure as the newest one of the age list */
+  ipr->prev = reassdatagrams_newest;
+  if (reassdatagrams_newest != NULL) {
+    reassdatagrams_newest->next = ipr;
+  } else {
+    reassdatagrams = ipr;
+  }
+  reassdatagrams_newest = ipr;
+  /* and to the front of its hash bucket */
+  hash = (u16_t)IP_REASS_HASH(&ipr->iphdr);
+  ipr->hash_next = reass_hash[hash];
+  reass_hash[hash] = ipr;
   return ipr;
 }
 
@@ -314,18 +350,30 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
  * @param ipr points to the queue entry to dequeue
  */
 static void
-ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev)
+ip_reass_dequeue_datagram(struct ip_reassdata *ipr)
 {
-  /* dequeue the reass struct  */
-  if (reassdatagrams == ipr) {
-    /* it was the first in the list */
+  struct ip_reassdata **pipr;
+
+  /* dequeue the reass struct from the age list */
+  if (ipr->prev != NULL) {
+    ipr->prev->next = ipr->next;
+  } else {
+    LWIP_ASSERT("sanity check linked list", reassdatagrams == ipr);
     reassdatagrams = ipr->next;
+  }
+  if (ipr->next != NULL) {
+    ipr->next->prev = ipr->prev;
   } else {
-    /* it wasn't the first, so it must have a valid 'prev' */
-    LWIP_ASSERT("sanity check linked list", prev != NULL);
-    prev->next = ipr->next;
+    LWIP_ASSERT("sanity check linked list", reassdatagrams_newest == ipr);
+    reassdatagrams_newest = ipr->prev;
   }
 
+  /* and from its hash bucket */
+  for (pipr = &reass_hash[IP_REASS_HASH(&ipr->iphdr)]; *pipr != ipr; pipr = &(*pipr)->hash_next) {
+    LWIP_ASSERT("sanity check hash bucket", *pipr != NULL);
+  }
+  *pipr = ipr->hash_next;
+
   /* now we can free the ip_reassdata struct */
   memp_free(MEMP_REASSDATA, ipr);
 }
@@ -333,8 +381,9 @@ ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev)
 /**
  * Chain a new pbuf into the pbuf list that composes the datagram.  The pbuf list
  * will grow over time as  new pbufs are rx.
- * Also checks that the datagram passes basic continuity checks (if the last
- * fragment was received at least once).
+ * Also checks whether the datagram is complete (if the last fragment was
+ * received at least once): as fragments never overlap, this is the case when
+ * the bytes received add up to the datagram length.
  * @param ipr points to the reassembly state
  * @param new_p points to the pbuf for the current fragment
  * @param is_last is 1 if this pbuf has MF==0 (ipr->flags not updated yet)
@@ -345,10 +394,9 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
 {
   struct ip_reass_helper *iprh, *iprh_tmp, *iprh_prev = NULL;
   struct pbuf *q;
-  u16_t offset, len;
+  u16_t offset, len, datagram_len;
   u8_t hlen;
   struct ip_hdr *fraghdr;
-  int valid = 1;
 
   /* Extract length and fragment offset from current fragment */
   fraghdr = (struct ip_hdr *)new_p->payload;
@@ -375,119 +423,81 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
     return IP_REASS_VALIDATE_PBUF_DROPPED;
   }
 
-  /* Iterate through until we either get to the end of the list (append),
-   * or we find one with a larger offset (insert). */
-  for (q = ipr->p; q != NULL;) {
-    iprh_tmp = (struct ip_reass_helper *)q->payload;
-    if (iprh->start < iprh_tmp->start) {
-      /* the new pbuf should be inserted before this */
-      iprh->next_pbuf = q;
-      if (iprh_prev != NULL) {
-        /* not the fragment with the lowest offset */
-#if IP_REASS_CHECK_OVERLAP
-        if ((iprh->start < iprh_prev->end) || (iprh->end > iprh_tmp->start)) {
-          /* fragment overlaps with previous or following, throw away */
-          return IP_REASS_VALIDATE_PBUF_DROPPED;
-        }
-#endif /* IP_REASS_CHECK_OVERLAP */
-        iprh_prev->next_pbuf = new_p;
-        if (iprh_prev->end != iprh->start) {
-          /* There is a fragment missing between the current
-           * and the previous fragment */
-          valid = 0;
-        }
-      } else {
+  /* Fragments must not reach beyond the end of the datagram: otherwise,
+   * counting the bytes received would not tell about holes */
+  if (is_last) {
+    datagram_len = iprh->end;
+    if ((ipr->p_last != NULL) &&
+        (((struct ip_reass_helper *)ipr->p_last->payload)->end > datagram_len)) {
+      return IP_REASS_VALIDATE_PBUF_DROPPED;
+    }
+  } else {
+    datagram_len = ipr->datagram_len;
+    if (((ipr->flags & IP_REASS_FLAG_LASTFRAG) != 0) && (iprh->end > datagram_len)) {
+      return IP_REASS_VALIDATE_PBUF_DROPPED;
+    }
+  }
+
+  if (ipr->p == NULL) {
+    /* this is the first fragment we ever received for this ip datagram */
+    ipr->p = new_p;
+    ipr->p_last = new_p;
+  } else if (iprh->start >= ((struct ip_reass_helper *)ipr->p_last->payload)->end) {
+    /* fragments mostly arrive in order: append to the one with the highest offset */
+    ((struct ip_reass_helper *)ipr->p_last->payload)->next_pbuf = new_p;
+    ipr->p_last = new_p;
+  } else if (iprh->end <= ((struct ip_reass_helper *)ipr->p->payload)->start) {
+    /* ... or in reverse order: this is the fragment with the lowest offset */
+    iprh->next_pbuf = ipr->p;
+    ipr->p = new_p;
+  } else {
+    /* Iterate through until we either get to the end of the list (append),
+     * or we find one with a larger offset (insert). */
+    for (q = ipr->p; q != NULL; q = iprh_tmp->next_pbuf) {
+      iprh_tmp = (struct ip_reass_helper *)q->payload;
+      if (iprh->start < iprh_tmp->start) {
 #if IP_REASS_CHECK_OVERLAP
         if (iprh->end > iprh_tmp->start) {
           /* fragment overlaps with following, throw away */
           return IP_REASS_VALIDATE_PBUF_DROPPED;
         }
 #endif /* IP_REASS_CHECK_OVERLAP */
-        /* fragment with the lowest offset */
-        ipr->p = new_p;
-      }
-      break;
-    } else if (iprh->start == iprh_tmp->start) {
-      /* received the same datagram twice: no need to keep the datagram */
-      return IP_REASS_VALIDATE_PBUF_DROPPED;
+        break;
+      } else if (iprh->start == iprh_tmp->start) {
+        /* received the same datagram twice: no need to keep the datagram */
+        return IP_REASS_VALIDATE_PBUF_DROPPED;
 #if IP_REASS_CHECK_OVERLAP
-    } else if (iprh->start < iprh_tmp->end) {
-      /* overlap: no need to keep the new datagram */
-      return IP_REASS_VALIDATE_PBUF_DROPPED;
+      } else if (iprh->start < iprh_tmp->end) {
+        /* overlap: no need to keep the new datagram */
+        return IP_REASS_VALIDATE_PBUF_DROPPED;
 #endif /* IP_REASS_CHECK_OVERLAP */
-    } else {
-      /* Check if the fragments received so far have no holes. */
-      if (iprh_prev != NULL) {
-        if (iprh_prev->end != iprh_tmp->start) {
-          /* There is a fragment missing between the current
-           * and the previous fragment */
-          valid = 0;
-        }
       }
+      iprh_prev = iprh_tmp;
     }
-    q = iprh_tmp->next_pbuf;
-    iprh_prev = iprh_tmp;
-  }
-
-  /* If q is NULL, then we made it to the end of the list. Determine what to do now */
-  if (q == NULL) {
+    /* insert the new pbuf before q */
+    iprh->next_pbuf = q;
     if (iprh_prev != NULL) {
-      /* this is (for now), the fragment with the highest offset:
-       * chain it to the last fragment */
-#if IP_REASS_CHECK_OVERLAP
-      LWIP_ASSERT("check fragments don't overlap", iprh_prev->end <= iprh->start);
-#endif /* IP_REASS_CHECK_OVERLAP */
       iprh_prev->next_pbuf = new_p;
-      if (iprh_prev->end != iprh->start) {
-        valid = 0;
-      }
     } else {
-#if IP_REASS_CHECK_OVERLAP
-      LWIP_ASSERT("no previous fragment, this must be the first fragment!",
-                  ipr->p == NULL);
-#endif /* IP_REASS_CHECK_OVERLAP */
-      /* this is the first fragment we ever received for this ip datagram */
       ipr->p = new_p;
     }
+    if (q == NULL) {
+      ipr->p_last = new_p;
+    }
   }
+  ipr->recv_len = (u16_t)(ipr->recv_len + len);
 
   /* At this point, the validation part begins: */
-  /* If we already received the last fragment */
-  if (is_last || ((ipr->flags & IP_REASS_FLAG_LASTFRAG) != 0)) {
-    /* and had no holes so far */
-    if (valid) {
-      /* then check if the rest of the fragments is here */
-      /* Check if the queue starts with the first datagram */
-      if ((ipr->p == NULL) || (((struct ip_reass_helper *)ipr->p->payload)->start != 0)) {
-        valid = 0;
-      } else {
-        /* and check that there are no holes after this datagram */
-        iprh_prev = iprh;
-        q = iprh->next_pbuf;
-        while (q != NULL) {
-          iprh = (struct ip_reass_helper *)q->payload;
-          if (iprh_prev->end != iprh->start) {
-            valid = 0;
-            break;
-          }
-          iprh_prev = iprh;
-          q = iprh->next_pbuf;
-        }
-        /* if still valid, all fragments are received
-         * (because to the MF==0 already arrived */
-        if (valid) {
-          LWIP_ASSERT("sanity check", ipr->p != NULL);
-          LWIP_ASSERT("sanity check",
-                      ((struct ip_reass_helper *)ipr->p->payload) != iprh);
-          LWIP_ASSERT("validate_datagram:next_pbuf!=NULL",
-                      iprh->next_pbuf == NULL);
-        }
-      }
-    }
-    /* If valid is 0 here, there are some fragments missing in the middle
-     * (since MF == 0 has already arrived). Such datagrams simply time out if
-     * no more fragments are received... */
-    return valid ? IP_REASS_VALIDATE_TELEGRAM_FINISHED : IP_REASS_VALIDATE_PBUF_QUEUED;
+  /* If we already received the last fragment and no bytes are missing,
+   * the datagram is complete. Otherwise there are some fragments missing
+   * in the middle: such datagrams simply time out if no more fragments are
+   * received... */
+  if ((is_last || ((ipr->flags & IP_REASS_FLAG_LASTFRAG) != 0)) &&
+      (ipr->recv_len == datagram_len)) {
+    LWIP_ASSERT("sanity check", ((struct ip_reass_helper *)ipr->p->payload)->start == 0);
+    LWIP_ASSERT("sanity check",
+                ((struct ip_reass_helper *)ipr->p_last->payload)->end == datagram_len);
+    return IP_REASS_VALIDATE_TELEGRAM_FINISHED;
   }
   /* If we come here, not all fragments were received, yet! */
   return IP_REASS_VALIDATE_PBUF_QUEUED; /* not yet valid! */
@@ -549,13 +559,12 @@ ip4_reass(struct pbuf *p)
     }
   }
 
-  /* Look for the datagram the fragment belongs to in the current datagram queue,
-   * remembering the previous in the queue for later dequeueing. */
-  for (ipr = reassdatagrams; ipr != NULL; ipr = ipr->next) {
+  /* Look for the datagram the fragment belongs to in its hash bucket */
+  for (ipr = reass_hash[IP_REASS_HASH(fraghdr)]; ipr != NULL; ipr = ipr->hash_next) {
     /* Check if the incoming fragment matches the one currently present
        in the reassembly buffer. If so, we proceed with copying the
        fragment into the buffer. */
-    if (IP_ADDRESSES_AND_ID_MATCH(&ipr->iphdr, fraghdr)) {
+    if (IP_ADDRESSES_ID_AND_PROTO_MATCH(&ipr->iphdr, fraghdr)) {
       LWIP_DEBUGF(IP_REASS_DEBUG, ("ip4_reass: matching previous fragment ID=%"X16_F"\n",
                                    lwip_ntohs(IPH_ID(fraghdr))));
       IPFRAG_STATS_INC(ip_frag.cachehit);
@@ -564,6 +573,16 @@ ip4_reass(struct pbuf *p)
   }
 
   if (ipr == NULL) {
+    if (clen > IP_REASS_MAX_PBUFS_PER_DATAGRAM) {
+      IPFRAG_STATS_INC(ip_frag.memerr);
+      goto nullreturn;
+    }
+#if IP_REASS_MAX_DATAGRAMS_PER_SRC
+    if (!ip_reass_check_src_budget(fraghdr)) {
+      IPFRAG_STATS_INC(ip_frag.memerr);
+      goto nullreturn;
+    }
+#endif /* IP_REASS_MAX_DATAGRAMS_PER_SRC */
     /* Enqueue a new datagram into the datagram queue */
     ipr = ip_reass_enqueue_new_datagram(fraghdr, clen);
     /* Bail if unable to enqueue */
@@ -571,6 +590,13 @@ ip4_reass(struct pbuf *p)
       goto nullreturn;
     }
   } else {
+    if ((ipr->clen + clen) > IP_REASS_MAX_PBUFS_PER_DATAGRAM) {
+      /* this datagram uses more than its share of pbufs: give up on it */
+      LWIP_DEBUGF(IP_REASS_DEBUG, ("ip4_reass: too many pbufs for this datagram\n"));
+      IPFRAG_STATS_INC(ip_frag.memerr);
+      ip_reass_free_complete_datagram(ipr);
+      goto nullreturn;
+    }
     if (((lwip_ntohs(IPH_OFFSET(fraghdr)) & IP_OFFMASK) == 0) &&
         ((lwip_ntohs(IPH_OFFSET(&ipr->iphdr)) & IP_OFFMASK) != 0)) {
       /* ipr->iphdr is not the header from the first fragment, but fraghdr is
@@ -605,6 +631,7 @@ ip4_reass(struct pbuf *p)
      the number of fragments that may be enqueued at any one time
      (overflow checked by testing against IP_REASS_MAX_PBUFS) */
   ip_reass_pbufcount = (u16_t)(ip_reass_pbufcount + clen);
+  ipr->clen = (u16_t)(ipr->clen + clen);
   if (is_last) {
     u16_t datagram_len = (u16_t)(offset + len);
     ipr->datagram_len = datagram_len;
@@ -615,7 +642,6 @@ ip4_reass(struct pbuf *p)
   }
 
   if (valid == IP_REASS_VALIDATE_TELEGRAM_FINISHED) {
-    struct ip_reassdata *ipr_prev;
     /* the totally last fragment (flag more fragments = 0) was received at least
      * once AND all fragments are received */
     u16_t datagram_len = (u16_t)(ipr->datagram_len + IP_HLEN);
@@ -648,25 +674,14 @@ ip4_reass(struct pbuf *p)
       r = iprh->next_pbuf;
     }
 
-    /* find the previous entry in the linked list */
-    if (ipr == reassdatagrams) {
-      ipr_prev = NULL;
-    } else {
-      for (ipr_prev = reassdatagrams; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
-        if (ipr_prev->next == ipr) {
-          break;
-        }
-      }
-    }
-
-    /* release the sources allocate for the fragment queue entry */
-    ip_reass_dequeue_datagram(ipr, ipr_prev);
-
     /* and adjust the number of pbufs currently queued for reassembly. */
-    clen = pbuf_clen(p);
+    clen = ipr->clen;
     LWIP_ASSERT("ip_reass_pbufcount >= clen", ip_reass_pbufcount >= clen);
     ip_reass_pbufcount = (u16_t)(ip_reass_pbufcount - clen);
 
+    /* release the sources allocate for the fragment queue entry */
+    ip_reass_dequeue_datagram(ipr);
+
     MIB2_STATS_INC(mib2.ipreasmoks);
 
     /* Return the pbuf chain */
@@ -680,8 +695,8 @@ nullreturn_ipr:
   LWIP_ASSERT("ipr != NULL", ipr != NULL);
   if (ipr->p == NULL) {
     /* dropped pbuf after creating a new datagram entry: remove the entry, too */
-    LWIP_ASSERT("not firstalthough just enqueued", ipr == reassdatagrams);
-    ip_reass_dequeue_datagram(ipr, NULL);
+    LWIP_ASSERT("not newest although just enqueued", ipr == reassdatagrams_newest);
+    ip_reass_dequeue_datagram(ipr);
   }
 
 nullreturn:
@@ -694,33 +709,33 @@ nullreturn:
 
 #if IP_FRAG
 #if !LWIP_NETIF_TX_SINGLE_PBUF
-/** Allocate a new struct pbuf_custom_ref */
-static struct pbuf_custom_ref *
-ip_frag_alloc_pbuf_custom_ref(void)
+/** Allocate a new struct ip_frag_hdr_pbuf */
+static struct ip_frag_hdr_pbuf *
+ip_frag_alloc_hdr_pbuf(void)
 {
-  return (struct pbuf_custom_ref *)memp_malloc(MEMP_FRAG_PBUF);
+  return (struct ip_frag_hdr_pbuf *)memp_malloc(MEMP_FRAG_PBUF);
 }
 
-/** Free a struct pbuf_custom_ref */
+/** Free a struct ip_frag_hdr_pbuf */
 static void
-ip_frag_free_pbuf_custom_ref(struct pbuf_custom_ref *p)
+ip_frag_free_hdr_pbuf(struct ip_frag_hdr_pbuf *p)
 {
   LWIP_ASSERT("p != NULL", p != NULL);
   memp_free(MEMP_FRAG_PBUF, p);
 }
 
-/** Free-callback function to free a 'struct pbuf_custom_ref', called by
+/** Free-callback function to free a 'struct ip_frag_hdr_pbuf', called by
  * pbuf_free. */
 static void
 ipfrag_free_pbuf_custom(struct pbuf *p)
 {
-  struct pbuf_custom_ref *pcr = (struct pbuf_custom_ref *)p;
-  LWIP_ASSERT("pcr != NULL", pcr != NULL);
-  LWIP_ASSERT("pcr == p", (void *)pcr == (void *)p);
-  if (pcr->original != NULL) {
-    pbuf_free(pcr->original);
+  struct ip_frag_hdr_pbuf *fhp = (struct ip_frag_hdr_pbuf *)p;
+  LWIP_ASSERT("fhp != NULL", fhp != NULL);
+  LWIP_ASSERT("fhp == p", (void *)fhp == (void *)p);
+  if (fhp->pcr.original != NULL) {
+    pbuf_free(fhp->pcr.original);
   }
-  ip_frag_free_pbuf_custom_ref(pcr);
+  ip_frag_free_hdr_pbuf(fhp);
 }
 #endif /* !LWIP_NETIF_TX_SINGLE_PBUF */
 
@@ -729,6 +744,8 @@ ipfrag_free_pbuf_custom(struct pbuf *p)
  *
  * Chop the datagram in MTU sized chunks and send them in order
  * by pointing PBUF_REFs into p.
+ * All fragment headers are built from one template, their checksums are
+ * derived from the template's checksum by adding the fields that change.
  *
  * @param p ip packet to send
  * @param netif the netif on which to send
@@ -741,11 +758,13 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
 {
   struct pbuf *rambuf;
 #if !LWIP_NETIF_TX_SINGLE_PBUF
+  struct pbuf *original = p;
+  struct ip_frag_hdr_pbuf *fhp;
   struct pbuf *newpbuf;
   u16_t newpbuflen = 0;
   u16_t left_to_copy;
 #endif
-  struct ip_hdr *original_iphdr;
+  struct ip_hdr iphdr_template;
   struct ip_hdr *iphdr;
   const u16_t nfb = (u16_t)((netif->mtu - IP_HLEN) / 8);
   u16_t left, fragsize;
@@ -754,9 +773,11 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
   u16_t poff = IP_HLEN;
   u16_t tmp;
   int mf_set;
+#if CHECKSUM_GEN_IP
+  u32_t chk_sum = 0;
+#endif /* CHECKSUM_GEN_IP */
 
-  original_iphdr = (struct ip_hdr *)p->payload;
-  iphdr = original_iphdr;
+  iphdr = (struct ip_hdr *)p->payload;
   if (IPH_HL_BYTES(iphdr) != IP_HLEN) {
     /* ip4_frag() does not support IP options */
     return ERR_VAL;
@@ -769,6 +790,17 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
   /* already fragmented? if so, the last fragment we create must have MF, too */
   mf_set = tmp & IP_MF;
 
+  /* The header template: only offset, length and checksum differ per fragment */
+  SMEMCPY(&iphdr_template, iphdr, IP_HLEN);
+  IPH_OFFSET_SET(&iphdr_template, 0);
+  IPH_LEN_SET(&iphdr_template, 0);
+  IPH_CHKSUM_SET(&iphdr_template, 0);
+#if CHECKSUM_GEN_IP
+  IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) {
+    chk_sum = (u16_t)~inet_chksum(&iphdr_template, IP_HLEN);
+  }
+#endif /* CHECKSUM_GEN_IP */
+
   left = (u16_t)(p->tot_len - IP_HLEN);
 
   while (left) {
@@ -788,27 +820,29 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
       pbuf_free(rambuf);
       goto memerr;
     }
-    /* fill in the IP header */
-    SMEMCPY(rambuf->payload, original_iphdr, IP_HLEN);
-    iphdr = (struct ip_hdr *)rambuf->payload;
 #else /* LWIP_NETIF_TX_SINGLE_PBUF */
     /* When not using a static buffer, create a chain of pbufs.
-     * The first will be a PBUF_RAM holding the link and IP header.
+     * The first will be a custom pbuf holding the link and IP header and
+     * a reference to the datagram to be fragged.
      * The rest will be PBUF_REFs mirroring the pbuf chain to be fragged,
      * but limited to the size of an mtu.
      */
-    rambuf = pbuf_alloc(PBUF_LINK, IP_HLEN, PBUF_RAM);
+    fhp = ip_frag_alloc_hdr_pbuf();
+    if (fhp == NULL) {
+      goto memerr;
+    }
+    rambuf = pbuf_alloced_custom(PBUF_LINK, IP_HLEN, PBUF_RAM, &fhp->pcr.pc,
+                                 fhp->hdr, sizeof(fhp->hdr));
     if (rambuf == NULL) {
+      ip_frag_free_hdr_pbuf(fhp);
       goto memerr;
     }
-    LWIP_ASSERT("this needs a pbuf in one piece!",
-                (rambuf->len >= (IP_HLEN)));
-    SMEMCPY(rambuf->payload, original_iphdr, IP_HLEN);
-    iphdr = (struct ip_hdr *)rambuf->payload;
+    pbuf_ref(original);
+    fhp->pcr.original = original;
+    fhp->pcr.pc.custom_free_function = ipfrag_free_pbuf_custom;
 
     left_to_copy = fragsize;
     while (left_to_copy) {
-      struct pbuf_custom_ref *pcr;
       u16_t plen = (u16_t)(p->len - poff);
       LWIP_ASSERT("p->len >= poff", p->len >= poff);
       newpbuflen = LWIP_MIN(left_to_copy, plen);
@@ -818,22 +852,14 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
         p = p->next;
         continue;
       }
-      pcr = ip_frag_alloc_pbuf_custom_ref();
-      if (pcr == NULL) {
-        pbuf_free(rambuf);
-        goto memerr;
-      }
-      /* Mirror this pbuf, although we might not need all of it. */
-      newpbuf = pbuf_alloced_custom(PBUF_RAW, newpbuflen, PBUF_REF, &pcr->pc,
-                                    (u8_t *)p->payload + poff, newpbuflen);
+      /* Mirror this pbuf, although we might not need all of it.
+       * The header pbuf keeps the data alive. */
+      newpbuf = pbuf_alloc(PBUF_RAW, newpbuflen, PBUF_REF);
       if (newpbuf == NULL) {
-        ip_frag_free_pbuf_custom_ref(pcr);
         pbuf_free(rambuf);
         goto memerr;
       }
-      pbuf_ref(p);
-      pcr->original = p;
-      pcr->pc.custom_free_function = ipfrag_free_pbuf_custom;
+      newpbuf->payload = (u8_t *)p->payload + poff;
 
       /* Add it to end of rambuf's chain, but using pbuf_cat, not pbuf_chain
        * so that it is removed when pbuf_dechain is later called on rambuf.
@@ -848,6 +874,10 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
     poff = (u16_t)(poff + newpbuflen);
 #endif /* LWIP_NETIF_TX_SINGLE_PBUF */
 
+    /* fill in the IP header */
+    SMEMCPY(rambuf->payload, &iphdr_template, IP_HLEN);
+    iphdr = (struct ip_hdr *)rambuf->payload;
+
     /* Correct header */
     last = (left <= netif->mtu - IP_HLEN);
 
@@ -859,10 +889,13 @@ ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
     }
     IPH_OFFSET_SET(iphdr, lwip_htons(tmp));
     IPH_LEN_SET(iphdr, lwip_htons((u16_t)(fragsize + IP_HLEN)));
-    IPH_CHKSUM_SET(iphdr, 0);
 #if CHECKSUM_GEN_IP
     IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) {
-      IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+      /* add the changed fields to the template's sum */
+      u32_t chk = chk_sum + IPH_OFFSET(iphdr) + IPH_LEN(iphdr);
+      chk = FOLD_U32T(chk);
+      chk = FOLD_U32T(chk);
+      IPH_CHKSUM_SET(iphdr, (u16_t)~chk);
     }
 #endif /* CHECKSUM_GEN_IP */
 
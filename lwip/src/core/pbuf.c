@@ -118,6 +118,9 @@ volatile u8_t pbuf_free_ooseq_pending;
  * if we run out of pool pbufs. It's better to give priority to new packets
  * if we're running out.
  *
+ * The upper half (by sequence number) of the largest ooseq queue is freed:
+ * the data at the upper end is the farthest from becoming in-sequence.
+ *
  * This must be done in the correct thread context therefore this function
  * can only be used with NO_SYS=0 and through tcpip_callback.
  */
@@ -127,15 +130,22 @@ static
 void
 pbuf_free_ooseq(void)
 {
-  struct tcp_pcb *pcb;
+  struct tcp_pcb *pcb, *victim = NULL;
   SYS_ARCH_SET(pbuf_free_ooseq_pending, 0);
 
   for (pcb = tcp_active_pcbs; NULL != pcb; pcb = pcb->next) {
-    if (pcb->ooseq != NULL) {
-      /** Free the ooseq pbufs of one PCB only */
-      LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free_ooseq: freeing out-of-sequence pbufs\n"));
-      tcp_free_ooseq(pcb);
-      return;
+    if ((pcb->ooseq != NULL) &&
+        ((victim == NULL) || (pcb->ooseq_bytes > victim->ooseq_bytes))) {
+      victim = pcb;
+    }
+  }
+  if (victim != NULL) {
+    /** Free the ooseq pbufs of one PCB only */
+    LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free_ooseq: freeing out-of-sequence pbufs\n"));
+    if (victim->ooseq->next == NULL) {
+      tcp_free_ooseq(victim);
+    } else {
+      tcp_ooseq_limit(victim, victim->ooseq_bytes / 2, 0xFFFF);
     }
   }
 }
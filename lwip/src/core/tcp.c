@@ -160,6 +160,10 @@ static u16_t tcp_port = TCP_LOCAL_PORT_RANGE_START;
 
 /* Incremented every coarse grained timer shot (typically every 500 ms). */
 u32_t tcp_ticks;
+#if TCP_QUEUE_OOSEQ
+/* Number of data bytes queued on ooseq over all pcbs. */
+u32_t tcp_ooseq_bytes;
+#endif /* TCP_QUEUE_OOSEQ */
 static const u8_t tcp_backoff[13] =
 { 1, 2, 3, 4, 5, 6, 7, 7, 7, 7, 7, 7, 7};
 /* Times per slowtmr hits */
@@ -609,7 +613,7 @@ tcp_abandon(struct tcp_pcb *pcb, int reset)
     }
 #if TCP_QUEUE_OOSEQ
     if (pcb->ooseq != NULL) {
-      tcp_segs_free(pcb->ooseq);
+      tcp_free_ooseq(pcb);
     }
 #endif /* TCP_QUEUE_OOSEQ */
     tcp_backlog_accepted(pcb);
@@ -2397,6 +2401,10 @@ tcp_free_ooseq(struct tcp_pcb *pcb)
   if (pcb->ooseq) {
     tcp_segs_free(pcb->ooseq);
     pcb->ooseq = NULL;
+    pcb->ooseq_tail = NULL;
+    LWIP_ASSERT("tcp_ooseq_bytes >= pcb->ooseq_bytes", tcp_ooseq_bytes >= pcb->ooseq_bytes);
+    tcp_ooseq_bytes -= pcb->ooseq_bytes;
+    pcb->ooseq_bytes = 0;
 #if LWIP_TCP_SACK_OUT
     memset(pcb->rcv_sacks, 0, sizeof(pcb->rcv_sacks));
 #endif /* LWIP_TCP_SACK_OUT */
@@ -100,9 +100,7 @@ static int tcp_input_delayed_close(struct tcp_pcb *pcb);
 #if LWIP_TCP_SACK_OUT
 static void tcp_add_sack(struct tcp_pcb *pcb, u32_t left, u32_t right);
 static void tcp_remove_sacks_lt(struct tcp_pcb *pcb, u32_t seq);
-#if defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)
 static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
-#endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
 #endif /* LWIP_TCP_SACK_OUT */
 
 /**
@@ -1055,13 +1053,35 @@ tcp_process(struct tcp_pcb *pcb)
 }
 
 #if TCP_QUEUE_OOSEQ
+/** Free a segment removed from pcb->ooseq and update the ooseq byte counts */
+static void
+tcp_oos_seg_free(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  LWIP_ASSERT("pcb->ooseq_bytes >= seg->len", pcb->ooseq_bytes >= seg->len);
+  pcb->ooseq_bytes -= seg->len;
+  tcp_ooseq_bytes -= seg->len;
+  tcp_seg_free(seg);
+}
+
+/** Trim the data of a segment on pcb->ooseq to len bytes */
+static void
+tcp_oos_seg_trim(struct tcp_pcb *pcb, struct tcp_seg *seg, u16_t len)
+{
+  LWIP_ASSERT("tcp_oos_seg_trim: only shrinking", len <= seg->len);
+  pcb->ooseq_bytes -= (u16_t)(seg->len - len);
+  tcp_ooseq_bytes -= (u16_t)(seg->len - len);
+  seg->len = len;
+  pbuf_realloc(seg->p, len);
+}
+
 /**
  * Insert segment into the list (segments covered with new one will be deleted)
  *
- * Called from tcp_receive()
+ * Called from tcp_receive() after linking cseg behind its predecessor (or
+ * as pcb->ooseq)
  */
 static void
-tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
+tcp_oos_insert_segment(struct tcp_pcb *pcb, struct tcp_seg *cseg, struct tcp_seg *next)
 {
   struct tcp_seg *old_seg;
 
@@ -1069,8 +1089,11 @@ tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
 
   if (TCPH_FLAGS(cseg->tcphdr) & TCP_FIN) {
     /* received segment overlaps all following segments */
-    tcp_segs_free(next);
-    next = NULL;
+    while (next != NULL) {
+      old_seg = next;
+      next = next->next;
+      tcp_oos_seg_free(pcb, old_seg);
+    }
   } else {
     /* delete some following segments
        oos queue may have segments with FIN flag */
@@ -1083,7 +1106,7 @@ tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
       }
       old_seg = next;
       next = next->next;
-      tcp_seg_free(old_seg);
+      tcp_oos_seg_free(pcb, old_seg);
     }
     if (next &&
         TCP_SEQ_GT(seqno + cseg->len, next->tcphdr->seqno)) {
@@ -1093,6 +1116,57 @@ tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
     }
   }
   cseg->next = next;
+  if (next == NULL) {
+    pcb->ooseq_tail = cseg;
+  }
+  pcb->ooseq_bytes += cseg->len;
+  tcp_ooseq_bytes += cseg->len;
+}
+
+/**
+ * Drop the highest-sequence segments on pcb->ooseq so that at most max_bytes
+ * of data in at most max_pbufs pbufs stay queued. The lowest-sequence data is
+ * kept since it is the closest to becoming in-sequence.
+ *
+ * Called from tcp_receive() to enforce the ooseq limits and from
+ * pbuf_free_ooseq() when running out of pbufs.
+ */
+void
+tcp_ooseq_limit(struct tcp_pcb *pcb, u32_t max_bytes, u16_t max_pbufs)
+{
+  struct tcp_seg *next, *prev = NULL;
+  u32_t ooseq_blen = 0;
+  u16_t ooseq_qlen = 0;
+
+  LWIP_ASSERT("tcp_ooseq_limit: invalid pcb", pcb != NULL);
+
+  for (next = pcb->ooseq; next != NULL; prev = next, next = next->next) {
+    ooseq_blen += next->len;
+    ooseq_qlen += pbuf_clen(next->p);
+    if ((ooseq_blen > max_bytes) || (ooseq_qlen > max_pbufs)) {
+#if LWIP_TCP_SACK_OUT
+      if (pcb->flags & TF_SACK) {
+        /* Let's remove all SACKs from next's seqno up. */
+        tcp_remove_sacks_gt(pcb, next->tcphdr->seqno);
+      }
+#endif /* LWIP_TCP_SACK_OUT */
+      /* too much ooseq data, dump this and everything after it */
+      if (prev == NULL) {
+        /* first ooseq segment is too much, dump the whole queue */
+        pcb->ooseq = NULL;
+      } else {
+        /* just dump 'next' and everything after it */
+        prev->next = NULL;
+      }
+      pcb->ooseq_tail = prev;
+      while (next != NULL) {
+        struct tcp_seg *old_seg = next;
+        next = next->next;
+        tcp_oos_seg_free(pcb, old_seg);
+      }
+      break;
+    }
+  }
 }
 #endif /* TCP_QUEUE_OOSEQ */
 
@@ -1500,11 +1574,7 @@ tcp_receive(struct tcp_pcb *pcb)
             /* Received in-order FIN means anything that was received
              * out of order must now have been received in-order, so
              * bin the ooseq queue */
-            while (pcb->ooseq != NULL) {
-              struct tcp_seg *old_ooseq = pcb->ooseq;
-              pcb->ooseq = pcb->ooseq->next;
-              tcp_seg_free(old_ooseq);
-            }
+            tcp_free_ooseq(pcb);
           } else {
             struct tcp_seg *next = pcb->ooseq;
             /* Remove all segments on ooseq that are covered by inseg already.
@@ -1521,7 +1591,7 @@ tcp_receive(struct tcp_pcb *pcb)
               }
               tmp = next;
               next = next->next;
-              tcp_seg_free(tmp);
+              tcp_oos_seg_free(pcb, tmp);
             }
             /* Now trim right side of inseg if it overlaps with the first
              * segment on ooseq */
@@ -1610,7 +1680,7 @@ tcp_receive(struct tcp_pcb *pcb)
           }
 
           pcb->ooseq = cseg->next;
-          tcp_seg_free(cseg);
+          tcp_oos_seg_free(pcb, cseg);
         }
 #if LWIP_TCP_SACK_OUT
         if (pcb->flags & TF_SACK) {
@@ -1628,7 +1698,16 @@ tcp_receive(struct tcp_pcb *pcb)
 
 
         /* Acknowledge the segment(s). */
-        tcp_ack(pcb);
+#if LWIP_GRO
+        if (tcplen > TCP_MSS) {
+          /* A coalesced segment stands for more than one full-sized
+             segment: ack it now as we would for every second one. */
+          tcp_ack_now(pcb);
+        } else
+#endif /* LWIP_GRO */
+        {
+          tcp_ack(pcb);
+        }
 
 #if LWIP_TCP_SACK_OUT
         if (LWIP_TCP_SACK_VALID(pcb, 0)) {
@@ -1654,6 +1733,9 @@ tcp_receive(struct tcp_pcb *pcb)
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
           pcb->ooseq = tcp_seg_copy(&inseg);
+          if (pcb->ooseq != NULL) {
+            tcp_oos_insert_segment(pcb, pcb->ooseq, NULL);
+          }
 #if LWIP_TCP_SACK_OUT
           if (pcb->flags & TF_SACK) {
             /* All the SACKs should be invalid, so we can simply store the most recent one: */
@@ -1679,8 +1761,20 @@ tcp_receive(struct tcp_pcb *pcb)
              It may start before the newly received segment (possibly adjusted below). */
           u32_t sackbeg = TCP_SEQ_LT(seqno, pcb->ooseq->tcphdr->seqno) ? seqno : pcb->ooseq->tcphdr->seqno;
 #endif /* LWIP_TCP_SACK_OUT */
-          struct tcp_seg *next, *prev = NULL;
-          for (next = pcb->ooseq; next != NULL; next = next->next) {
+          struct tcp_seg *next = pcb->ooseq, *prev = NULL;
+          LWIP_ASSERT("tcp_receive: ooseq_tail is not the last segment",
+                      pcb->ooseq_tail != NULL && pcb->ooseq_tail->next == NULL);
+          if (TCP_SEQ_GT(seqno, pcb->ooseq_tail->tcphdr->seqno)
+#if LWIP_TCP_SACK_OUT
+              /* finding the left edge of the SACK range needs the walk */
+              && !(pcb->flags & TF_SACK)
+#endif /* LWIP_TCP_SACK_OUT */
+             ) {
+            /* Segments mostly arrive in order behind a hole, so start at the
+               tail instead of walking the whole queue: this is appended below. */
+            next = pcb->ooseq_tail;
+          }
+          for (; next != NULL; next = next->next) {
             if (seqno == next->tcphdr->seqno) {
               /* The sequence number of the incoming segment is the
                  same as the sequence number of the segment on
@@ -1697,7 +1791,7 @@ tcp_receive(struct tcp_pcb *pcb)
                   } else {
                     pcb->ooseq = cseg;
                   }
-                  tcp_oos_insert_segment(cseg, next);
+                  tcp_oos_insert_segment(pcb, cseg, next);
                 }
                 break;
               } else {
@@ -1716,7 +1810,7 @@ tcp_receive(struct tcp_pcb *pcb)
                   struct tcp_seg *cseg = tcp_seg_copy(&inseg);
                   if (cseg != NULL) {
                     pcb->ooseq = cseg;
-                    tcp_oos_insert_segment(cseg, next);
+                    tcp_oos_insert_segment(pcb, cseg, next);
                   }
                   break;
                 }
@@ -1733,11 +1827,10 @@ tcp_receive(struct tcp_pcb *pcb)
                   if (cseg != NULL) {
                     if (TCP_SEQ_GT(prev->tcphdr->seqno + prev->len, seqno)) {
                       /* We need to trim the prev segment. */
-                      prev->len = (u16_t)(seqno - prev->tcphdr->seqno);
-                      pbuf_realloc(prev->p, prev->len);
+                      tcp_oos_seg_trim(pcb, prev, (u16_t)(seqno - prev->tcphdr->seqno));
                     }
                     prev->next = cseg;
-                    tcp_oos_insert_segment(cseg, next);
+                    tcp_oos_insert_segment(pcb, cseg, next);
                   }
                   break;
                 }
@@ -1769,8 +1862,7 @@ tcp_receive(struct tcp_pcb *pcb)
                 if (next->next != NULL) {
                   if (TCP_SEQ_GT(next->tcphdr->seqno + next->len, seqno)) {
                     /* We need to trim the last segment. */
-                    next->len = (u16_t)(seqno - next->tcphdr->seqno);
-                    pbuf_realloc(next->p, next->len);
+                    tcp_oos_seg_trim(pcb, next, (u16_t)(seqno - next->tcphdr->seqno));
                   }
                   /* check if the remote side overruns our receive window */
                   if (TCP_SEQ_GT((u32_t)tcplen + seqno, pcb->rcv_nxt + (u32_t)pcb->rcv_wnd)) {
@@ -1790,6 +1882,7 @@ tcp_receive(struct tcp_pcb *pcb)
                     LWIP_ASSERT("tcp_receive: segment not trimmed correctly to rcv_wnd",
                                 (seqno + tcplen) == (pcb->rcv_nxt + pcb->rcv_wnd));
                   }
+                  tcp_oos_insert_segment(pcb, next->next, NULL);
                 }
                 break;
               }
@@ -1822,55 +1915,35 @@ tcp_receive(struct tcp_pcb *pcb)
           }
 #endif /* LWIP_TCP_SACK_OUT */
         }
-#if defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)
+#if defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT) || TCP_OOSEQ_GLOBAL_MAX_BYTES
         {
           /* Check that the data on ooseq doesn't exceed one of the limits
              and throw away everything above that limit. */
-#ifdef TCP_OOSEQ_BYTES_LIMIT
-          const u32_t ooseq_max_blen = TCP_OOSEQ_BYTES_LIMIT(pcb);
-          u32_t ooseq_blen = 0;
+          u32_t ooseq_max_blen = 0xFFFFFFFFUL;
+#if TCP_OOSEQ_GLOBAL_MAX_BYTES
+          /* the part of the global budget not used by other pcbs */
+          const u32_t ooseq_other_blen = tcp_ooseq_bytes - pcb->ooseq_bytes;
 #endif
-#ifdef TCP_OOSEQ_PBUFS_LIMIT
-          const u16_t ooseq_max_qlen = TCP_OOSEQ_PBUFS_LIMIT(pcb);
-          u16_t ooseq_qlen = 0;
-#endif
-          struct tcp_seg *next, *prev = NULL;
-          for (next = pcb->ooseq; next != NULL; prev = next, next = next->next) {
-            struct pbuf *p = next->p;
-            int stop_here = 0;
 #ifdef TCP_OOSEQ_BYTES_LIMIT
-            ooseq_blen += p->tot_len;
-            if (ooseq_blen > ooseq_max_blen) {
-              stop_here = 1;
-            }
+          ooseq_max_blen = TCP_OOSEQ_BYTES_LIMIT(pcb);
 #endif
-#ifdef TCP_OOSEQ_PBUFS_LIMIT
-            ooseq_qlen += pbuf_clen(p);
-            if (ooseq_qlen > ooseq_max_qlen) {
-              stop_here = 1;
-            }
+#if TCP_OOSEQ_GLOBAL_MAX_BYTES
+          if (ooseq_other_blen >= TCP_OOSEQ_GLOBAL_MAX_BYTES) {
+            ooseq_max_blen = 0;
+          } else {
+            ooseq_max_blen = LWIP_MIN(ooseq_max_blen, TCP_OOSEQ_GLOBAL_MAX_BYTES - ooseq_other_blen);
+          }
 #endif
-            if (stop_here) {
-#if LWIP_TCP_SACK_OUT
-              if (pcb->flags & TF_SACK) {
-                /* Let's remove all SACKs from next's seqno up. */
-                tcp_remove_sacks_gt(pcb, next->tcphdr->seqno);
-              }
-#endif /* LWIP_TCP_SACK_OUT */
-              /* too much ooseq data, dump this and everything after it */
-              tcp_segs_free(next);
-              if (prev == NULL) {
-                /* first ooseq segment is too much, dump the whole queue */
-                pcb->ooseq = NULL;
-              } else {
-                /* just dump 'next' and everything after it */
-                prev->next = NULL;
-              }
-              break;
-            }
+#ifdef TCP_OOSEQ_PBUFS_LIMIT
+          /* the number of pbufs is not tracked, so this needs the walk */
+          tcp_ooseq_limit(pcb, ooseq_max_blen, TCP_OOSEQ_PBUFS_LIMIT(pcb));
+#else
+          if (pcb->ooseq_bytes > ooseq_max_blen) {
+            tcp_ooseq_limit(pcb, ooseq_max_blen, 0xFFFF);
           }
+#endif
         }
-#endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
+#endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT || TCP_OOSEQ_GLOBAL_MAX_BYTES */
 #endif /* TCP_QUEUE_OOSEQ */
 
         /* We send the ACK packet after we've (potentially) dealt with SACKs,
@@ -2138,7 +2211,6 @@ tcp_remove_sacks_lt(struct tcp_pcb *pcb, u32_t seq)
   }
 }
 
-#if defined(TCP_OOSEQ_BYTES_LIMIT) || defined(TCP_OOSEQ_PBUFS_LIMIT)
 /**
  * Called to remove a range of SACKs.
  *
@@ -2177,7 +2249,6 @@ tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq)
     pcb->rcv_sacks[i].left = pcb->rcv_sacks[i].right = 0;
   }
 }
-#endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
 
 #endif /* LWIP_TCP_SACK_OUT */
 
@@ -125,6 +125,7 @@
 #endif
 
 /* Forward declarations.*/
+struct tcp_zc_ref;
 static err_t tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif);
 static err_t tcp_output_control_segment_netif(const struct tcp_pcb *pcb, struct pbuf *p,
                                               const ip_addr_t *src, const ip_addr_t *dst,
@@ -350,47 +351,79 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
   return ERR_OK;
 }
 
+#if LWIP_TCP_WRITE_ZEROCOPY
+/** Drop one reference to a buffer passed to tcp_write_zc() and call the
+ * release callback when it was the last one. */
+static void
+tcp_zc_ref_free(struct tcp_zc_ref *zc)
+{
+  LWIP_ASSERT("zc != NULL", zc != NULL);
+  LWIP_ASSERT("zc->refcnt > 0", zc->refcnt > 0);
+  zc->refcnt--;
+  if (zc->refcnt == 0) {
+    tcp_zc_release_fn release = zc->release;
+    void *token = zc->token;
+    memp_free(MEMP_TCP_ZC_REF, zc);
+    release(token);
+  }
+}
+
+/** Free-callback function to free a 'struct tcp_zc_pbuf', called by
+ * pbuf_free. */
+static void
+tcp_zc_pbuf_free(struct pbuf *p)
+{
+  struct tcp_zc_pbuf *zp = (struct tcp_zc_pbuf *)p;
+  struct tcp_zc_ref *zc;
+  LWIP_ASSERT("zp != NULL", zp != NULL);
+  zc = zp->ref;
+  memp_free(MEMP_TCP_ZC_PBUF, zp);
+  tcp_zc_ref_free(zc);
+}
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+
 /**
- * @ingroup tcp_raw
- * Write data for sending (but does not send it immediately).
- *
- * It waits in the expectation of more data being sent soon (as
- * it can send them more efficiently by combining them together).
- * To prompt the system to send data now, call tcp_output() after
- * calling tcp_write().
- *
- * This function enqueues the data pointed to by the argument dataptr. The length of
- * the data is passed as the len parameter. The apiflags can be one or more of:
- * - TCP_WRITE_FLAG_COPY: indicates whether the new memory should be allocated
- *   for the data to be copied into. If this flag is not given, no new memory
- *   should be allocated and the data should only be referenced by pointer. This
- *   also means that the memory behind dataptr must not change until the data is
- *   ACKed by the remote host
- * - TCP_WRITE_FLAG_MORE: indicates that more data follows. If this is omitted,
- *   the PSH flag is set in the last segment created by this call to tcp_write.
- *   If this flag is given, the PSH flag is not set.
- *
- * The tcp_write() function will fail and return ERR_MEM if the length
- * of the data exceeds the current send buffer size or if the length of
- * the queue of outgoing segment is larger than the upper limit defined
- * in lwipopts.h. The number of bytes available in the output queue can
- * be retrieved with the tcp_sndbuf() function.
- *
- * The proper way to use this function is to call the function with at
- * most tcp_sndbuf() bytes of data. If the function returns ERR_MEM,
- * the application should wait until some of the currently enqueued
- * data has been successfully received by the other host and try again.
- *
- * @param pcb Protocol control block for the TCP connection to enqueue data for.
- * @param arg Pointer to the data to be enqueued for sending.
- * @param len Data length in bytes
- * @param apiflags combination of following flags :
- * - TCP_WRITE_FLAG_COPY (0x01) data will be copied into memory belonging to the stack
- * - TCP_WRITE_FLAG_MORE (0x02) for TCP connection, PSH flag will not be set on last segment sent,
- * @return ERR_OK if enqueued, another err_t on error
+ * Allocate a pbuf referencing len bytes at data without copying them.
+ * If zc is NULL, the data is non-volatile (PBUF_ROM); otherwise it belongs
+ * to a buffer passed to tcp_write_zc() and the pbuf keeps it referenced
+ * until freed.
  */
-err_t
-tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
+static struct pbuf *
+tcp_pbuf_ref(pbuf_layer layer, const u8_t *data, u16_t len, struct tcp_zc_ref *zc)
+{
+  struct pbuf *p;
+#if LWIP_TCP_WRITE_ZEROCOPY
+  if (zc != NULL) {
+    struct tcp_zc_pbuf *zp = (struct tcp_zc_pbuf *)memp_malloc(MEMP_TCP_ZC_PBUF);
+    if (zp == NULL) {
+      return NULL;
+    }
+    zp->pc.custom_free_function = tcp_zc_pbuf_free;
+    zp->ref = zc;
+    /* no header is ever prepended to this pbuf, so PBUF_RAW is fine */
+    p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &zp->pc, LWIP_CONST_CAST(u8_t *, data), len);
+    LWIP_ASSERT("pbuf_alloced_custom failed", p != NULL);
+    zc->refcnt++;
+    return p;
+  }
+#else /* LWIP_TCP_WRITE_ZEROCOPY */
+  LWIP_UNUSED_ARG(zc);
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+  p = pbuf_alloc(layer, len, PBUF_ROM);
+  if (p != NULL) {
+    /* reference the non-volatile payload data */
+    ((struct pbuf_rom *)p)->payload = data;
+  }
+  return p;
+}
+
+/**
+ * Common code of tcp_write() and tcp_write_zc(): zc is the buffer reference
+ * for tcp_write_zc() or NULL.
+ */
+static err_t
+tcp_write_data(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags,
+               struct tcp_zc_ref *zc)
 {
   struct pbuf *concat_p = NULL;
   struct tcp_seg *last_unsent = NULL, *seg = NULL, *prev_seg = NULL, *queue = NULL;
@@ -559,18 +592,19 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
         /* If the last unsent pbuf is of type PBUF_ROM, try to extend it. */
         struct pbuf *p;
         for (p = last_unsent->p; p->next != NULL; p = p->next);
-        if (((p->type_internal & (PBUF_TYPE_FLAG_STRUCT_DATA_CONTIGUOUS | PBUF_TYPE_FLAG_DATA_VOLATILE)) == 0) &&
+        /* (Data of tcp_write_zc() must not be referenced by pbufs that don't
+            keep that buffer referenced.) */
+        if ((zc == NULL) &&
+            ((p->type_internal & (PBUF_TYPE_FLAG_STRUCT_DATA_CONTIGUOUS | PBUF_TYPE_FLAG_DATA_VOLATILE)) == 0) &&
             (const u8_t *)p->payload + p->len == (const u8_t *)arg) {
           LWIP_ASSERT("tcp_write: ROM pbufs cannot be oversized", pos == 0);
           extendlen = seglen;
         } else {
-          if ((concat_p = pbuf_alloc(PBUF_RAW, seglen, PBUF_ROM)) == NULL) {
+          if ((concat_p = tcp_pbuf_ref(PBUF_RAW, (const u8_t *)arg + pos, seglen, zc)) == NULL) {
             LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
                         ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
             goto memerr;
           }
-          /* reference the non-volatile payload data */
-          ((struct pbuf_rom *)concat_p)->payload = (const u8_t *)arg + pos;
           queuelen += pbuf_clen(concat_p);
         }
 #if TCP_CHECKSUM_ON_COPY
@@ -621,13 +655,14 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
       /* Copy is not set: First allocate a pbuf for holding the data.
        * Since the referenced data is available at least until it is
        * sent out on the link (as it has to be ACKed by the remote
-       * party) we can safely use PBUF_ROM instead of PBUF_REF here.
+       * party) we can safely use PBUF_ROM instead of PBUF_REF here
+       * (tcp_write_zc() data is referenced by custom PBUF_REF pbufs).
        */
       struct pbuf *p2;
 #if TCP_OVERSIZE
       LWIP_ASSERT("oversize == 0", oversize == 0);
 #endif /* TCP_OVERSIZE */
-      if ((p2 = pbuf_alloc(PBUF_TRANSPORT, seglen, PBUF_ROM)) == NULL) {
+      if ((p2 = tcp_pbuf_ref(PBUF_TRANSPORT, (const u8_t *)arg + pos, seglen, zc)) == NULL) {
         LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
         goto memerr;
       }
@@ -639,8 +674,6 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
         chksum = SWAP_BYTES_IN_WORD(chksum);
       }
 #endif /* TCP_CHECKSUM_ON_COPY */
-      /* reference the non-volatile payload data */
-      ((struct pbuf_rom *)p2)->payload = (const u8_t *)arg + pos;
 
       /* Second, allocate a pbuf for the headers. */
       if ((p = pbuf_alloc(PBUF_TRANSPORT, optlen, PBUF_RAM)) == NULL) {
@@ -814,6 +847,113 @@ memerr:
   return ERR_MEM;
 }
 
+/**
+ * @ingroup tcp_raw
+ * Write data for sending (but does not send it immediately).
+ *
+ * It waits in the expectation of more data being sent soon (as
+ * it can send them more efficiently by combining them together).
+ * To prompt the system to send data now, call tcp_output() after
+ * calling tcp_write().
+ *
+ * This function enqueues the data pointed to by the argument dataptr. The length of
+ * the data is passed as the len parameter. The apiflags can be one or more of:
+ * - TCP_WRITE_FLAG_COPY: indicates whether the new memory should be allocated
+ *   for the data to be copied into. If this flag is not given, no new memory
+ *   should be allocated and the data should only be referenced by pointer. This
+ *   also means that the memory behind dataptr must not change until the data is
+ *   ACKed by the remote host
+ * - TCP_WRITE_FLAG_MORE: indicates that more data follows. If this is omitted,
+ *   the PSH flag is set in the last segment created by this call to tcp_write.
+ *   If this flag is given, the PSH flag is not set.
+ *
+ * The tcp_write() function will fail and return ERR_MEM if the length
+ * of the data exceeds the current send buffer size or if the length of
+ * the queue of outgoing segment is larger than the upper limit defined
+ * in lwipopts.h. The number of bytes available in the output queue can
+ * be retrieved with the tcp_sndbuf() function.
+ *
+ * The proper way to use this function is to call the function with at
+ * most tcp_sndbuf() bytes of data. If the function returns ERR_MEM,
+ * the application should wait until some of the currently enqueued
+ * data has been successfully received by the other host and try again.
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param arg Pointer to the data to be enqueued for sending.
+ * @param len Data length in bytes
+ * @param apiflags combination of following flags :
+ * - TCP_WRITE_FLAG_COPY (0x01) data will be copied into memory belonging to the stack
+ * - TCP_WRITE_FLAG_MORE (0x02) for TCP connection, PSH flag will not be set on last segment sent,
+ * @return ERR_OK if enqueued, another err_t on error
+ */
+err_t
+tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
+{
+  return tcp_write_data(pcb, arg, len, apiflags, NULL);
+}
+
+#if LWIP_TCP_WRITE_ZEROCOPY
+/**
+ * @ingroup tcp_raw
+ * Write data for sending without copying it, like tcp_write() without
+ * TCP_WRITE_FLAG_COPY, but with a completion notification per buffer.
+ *
+ * The memory behind dataptr is referenced by the enqueued segments until all
+ * of them have been ACKed by the remote host (or freed because the pcb was
+ * closed or aborted). At that point, the release callback is called with
+ * token and the application may reuse the memory.
+ *
+ * Data may still be copied into free space at the end of the last unsent
+ * segment (TCP_OVERSIZE). If no segment references the buffer at all, the
+ * release callback is called before this function returns.
+ *
+ * If an error is returned, nothing has been enqueued, the release callback
+ * will not be called and the buffer still belongs to the application.
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param arg Pointer to the data to be enqueued for sending.
+ * @param len Data length in bytes
+ * @param apiflags TCP_WRITE_FLAG_MORE (TCP_WRITE_FLAG_COPY is ignored)
+ * @param release callback called when the buffer is not referenced any more
+ * @param token argument passed to the release callback
+ * @return ERR_OK if enqueued, another err_t on error
+ */
+err_t
+tcp_write_zc(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags,
+             tcp_zc_release_fn release, void *token)
+{
+  struct tcp_zc_ref *zc;
+  err_t err;
+
+  LWIP_ERROR("tcp_write_zc: invalid pcb", pcb != NULL, return ERR_ARG);
+  LWIP_ERROR("tcp_write_zc: invalid release callback", release != NULL, return ERR_ARG);
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  zc = (struct tcp_zc_ref *)memp_malloc(MEMP_TCP_ZC_REF);
+  if (zc == NULL) {
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write_zc: could not allocate buffer reference\n"));
+    tcp_set_flags(pcb, TF_NAGLEMEMERR);
+    TCP_STATS_INC(tcp.memerr);
+    return ERR_MEM;
+  }
+  zc->release = release;
+  zc->token = token;
+  /* hold our own reference so the buffer is not released while enqueueing */
+  zc->refcnt = 1;
+
+  err = tcp_write_data(pcb, arg, len, (u8_t)(apiflags & ~TCP_WRITE_FLAG_COPY), zc);
+  if (err != ERR_OK) {
+    /* all pbufs created for this buffer have been freed again */
+    LWIP_ASSERT("zc->refcnt == 1", zc->refcnt == 1);
+    memp_free(MEMP_TCP_ZC_REF, zc);
+    return err;
+  }
+  tcp_zc_ref_free(zc);
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+
 /**
  * Split segment on the head of the unsent queue.  If return is not
  * ERR_OK, existing head remains intact
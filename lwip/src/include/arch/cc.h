@@ -48,9 +48,7 @@ typedef uintptr_t   mem_ptr_t;
         mch_abort();                        \
     } while (0)
 
-#if !USE_FREERTOS
-static inline u32_t sys_now(void) { return 0; /* return read_rtc() * 1000U; */ }
-#endif
+/* sys_now() is implemented with timer 0 in platform/timer.c */
 
 #define LWIP_RAND() ((u32_t)rand())
 
@@ -0,0 +1,7 @@
+#ifndef __ARCH_PERF_H__
+#define __ARCH_PERF_H__
+
+/* PERF_START/PERF_STOP latency histograms, see platform/perfhist.h */
+#include "perfhist.h"
+
+#endif /* __ARCH_PERF_H__ */
@@ -93,6 +93,16 @@ extern "C" {
 /** A FIN has been received but not passed to the application yet */
 #define NETCONN_FIN_RX_PENDING                0x80
 
+#if LWIP_TCP && LWIP_NETCONN_RECV_QUEUE
+/* Values of netconn->recvq_wakeup */
+/** No wakeup for recvq_head is pending */
+#define NETCONN_RECVQ_WAKEUP_NONE             0
+/** A wakeup for recvq_head is waiting in recvmbox */
+#define NETCONN_RECVQ_WAKEUP_POSTED           1
+/** recvmbox was full: the next segment or poll_tcp() posts the wakeup */
+#define NETCONN_RECVQ_WAKEUP_OWED             2
+#endif /* LWIP_TCP && LWIP_NETCONN_RECV_QUEUE */
+
 /* Helpers to process several netconn_types by the same code */
 #define NETCONNTYPE_GROUP(t)         ((t)&0xF0)
 #define NETCONNTYPE_DATAGRAM(t)      ((t)&0xE0)
@@ -241,6 +251,15 @@ struct netconn {
       by the application thread */
   sys_mbox_t acceptmbox;
 #endif /* LWIP_TCP */
+#if LWIP_TCP && LWIP_NETCONN_RECV_QUEUE
+  /** TCP: received data not taken by the application yet; the packets are
+      linked like in a pbuf chain but keep their own tot_len */
+  struct pbuf *recvq_head;
+  /** last pbuf of recvq_head */
+  struct pbuf *recvq_tail;
+  /** state of the recvmbox wakeup for recvq_head, NETCONN_RECVQ_WAKEUP_* */
+  u8_t recvq_wakeup;
+#endif /* LWIP_TCP && LWIP_NETCONN_RECV_QUEUE */
 #if LWIP_NETCONN_FULLDUPLEX
   /** number of threads waiting on an mbox. This is required to unblock
       all threads when closing while threads are waiting. */
@@ -340,6 +359,7 @@ err_t   netconn_tcp_recvd(struct netconn *conn, size_t len);
 err_t   netconn_sendto(struct netconn *conn, struct netbuf *buf,
                              const ip_addr_t *addr, u16_t port);
 err_t   netconn_send(struct netconn *conn, struct netbuf *buf);
+err_t   netconn_send_batch(struct netconn *conn, struct netbuf *bufs, u16_t count, u16_t *sent);
 err_t   netconn_write_partly(struct netconn *conn, const void *dataptr, size_t size,
                              u8_t apiflags, size_t *bytes_written);
 err_t   netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u16_t vectorcnt,
@@ -119,9 +119,16 @@
 #define LWIP_ASSERT(message, assertion)
 #endif /* LWIP_NOASSERT */
 
+/** Output of LWIP_DEBUGF() and LWIP_ERROR() messages. A port can define
+ *  it to something cheaper than formatting with LWIP_PLATFORM_DIAG().
+ */
+#ifndef LWIP_PLATFORM_DEBUGF
+#define LWIP_PLATFORM_DEBUGF(message) LWIP_PLATFORM_DIAG(message)
+#endif
+
 #ifndef LWIP_ERROR
 #ifdef LWIP_DEBUG
-#define LWIP_PLATFORM_ERROR(message) LWIP_PLATFORM_DIAG((message))
+#define LWIP_PLATFORM_ERROR(message) LWIP_PLATFORM_DEBUGF((message))
 #else
 #define LWIP_PLATFORM_ERROR(message)
 #endif
@@ -148,7 +155,7 @@
 
 #define LWIP_DEBUGF(debug, message) do { \
                                if (LWIP_DEBUG_ENABLED(debug)) { \
-                                 LWIP_PLATFORM_DIAG(message); \
+                                 LWIP_PLATFORM_DEBUGF(message); \
                                  if ((debug) & LWIP_DBG_HALT) { \
                                    while(1); \
                                  } \
@@ -59,10 +59,20 @@ extern "C" {
  * This is exported because memp needs to know the size.
  */
 struct ip_reassdata {
+  /* age list, oldest datagram first */
   struct ip_reassdata *next;
+  struct ip_reassdata *prev;
+  /* lookup hash bucket */
+  struct ip_reassdata *hash_next;
+  /* fragments sorted by offset */
   struct pbuf *p;
+  struct pbuf *p_last;
   struct ip_hdr iphdr;
   u16_t datagram_len;
+  /* data bytes received so far */
+  u16_t recv_len;
+  /* pbufs held by this datagram */
+  u16_t clen;
   u8_t flags;
   u8_t timer;
 };
@@ -86,6 +96,18 @@ struct pbuf_custom_ref {
   struct pbuf *original;
 };
 #endif /* LWIP_PBUF_CUSTOM_REF_DEFINED */
+
+/** The header pbuf of an outgoing fragment. It holds a reference to the
+ * datagram being fragmented, so the fragment's data can be chained as
+ * plain PBUF_REFs pointing into it.
+ * This is exported because memp needs to know the size.
+ */
+struct ip_frag_hdr_pbuf {
+  /** 'base class' */
+  struct pbuf_custom_ref pcr;
+  /** room for the link header and the IP header */
+  u8_t hdr[LWIP_MEM_ALIGN_SIZE(PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN) + IP_HLEN];
+};
 #endif /* !LWIP_NETIF_TX_SINGLE_PBUF */
 
 err_t ip4_frag(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest);
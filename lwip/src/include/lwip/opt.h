@@ -445,6 +445,24 @@
 #define MEMP_NUM_TCP_SEG                16
 #endif
 
+/**
+ * MEMP_NUM_TCP_ZC_REF: the number of application buffers that can be
+ * referenced by tcp_write_zc() at the same time (not yet released).
+ * (requires the LWIP_TCP_WRITE_ZEROCOPY option)
+ */
+#if !defined MEMP_NUM_TCP_ZC_REF || defined __DOXYGEN__
+#define MEMP_NUM_TCP_ZC_REF             8
+#endif
+
+/**
+ * MEMP_NUM_TCP_ZC_PBUF: the number of pbufs referencing application buffers
+ * passed to tcp_write_zc(). Each segment holds one such pbuf per buffer.
+ * (requires the LWIP_TCP_WRITE_ZEROCOPY option)
+ */
+#if !defined MEMP_NUM_TCP_ZC_PBUF || defined __DOXYGEN__
+#define MEMP_NUM_TCP_ZC_PBUF            TCP_SND_QUEUELEN
+#endif
+
 /**
  * MEMP_NUM_ALTCP_PCB: the number of simultaneously active altcp layer pcbs.
  * (requires the LWIP_ALTCP option)
@@ -468,7 +486,8 @@
  * (fragments, not whole packets!).
  * This is only used with LWIP_NETIF_TX_SINGLE_PBUF==0 and only has to be > 1
  * with DMA-enabled MACs where the packet is not yet sent when netif->output
- * returns.
+ * returns. The data of an IPv4 fragment is chained as PBUF_REFs, which come
+ * from MEMP_NUM_PBUF.
  */
 #if !defined MEMP_NUM_FRAG_PBUF || defined __DOXYGEN__
 #define MEMP_NUM_FRAG_PBUF              15
@@ -534,6 +553,24 @@
 #define MEMP_NUM_SELECT_CB              4
 #endif
 
+/**
+ * MEMP_NUM_EPOLL_ITEM: the number of sockets registered with epoll
+ * instances at the same time (one per socket and instance).
+ * (only needed if you use LWIP_SOCKET_EPOLL==1)
+ */
+#if !defined MEMP_NUM_EPOLL_ITEM || defined __DOXYGEN__
+#define MEMP_NUM_EPOLL_ITEM             MEMP_NUM_NETCONN
+#endif
+
+/**
+ * MEMP_NUM_ZC_HANDLE: the number of zero-copy receives that can be lent
+ * out at the same time (one per lwip_recvmsg_zc() until it is released).
+ * (only needed if you use LWIP_SOCKET_ZEROCOPY_RECV==1)
+ */
+#if !defined MEMP_NUM_ZC_HANDLE || defined __DOXYGEN__
+#define MEMP_NUM_ZC_HANDLE              MEMP_NUM_NETBUF
+#endif
+
 /**
  * MEMP_NUM_TCPIP_MSG_API: the number of struct tcpip_msg, which are used
  * for callback/timeout API communication.
@@ -552,6 +589,15 @@
 #define MEMP_NUM_TCPIP_MSG_INPKT        8
 #endif
 
+/**
+ * MEMP_NUM_TCPIP_MSG_INPKT_BURST: the number of burst messages, each of
+ * which carries up to TCPIP_INPKT_BURST_MAX incoming packets.
+ * (only needed if you use tcpip_inpkt_burst())
+ */
+#if !defined MEMP_NUM_TCPIP_MSG_INPKT_BURST || defined __DOXYGEN__
+#define MEMP_NUM_TCPIP_MSG_INPKT_BURST  4
+#endif
+
 /**
  * MEMP_NUM_NETDB: the number of concurrently running lwip_addrinfo() calls
  * (before freeing the corresponding memory using lwip_freeaddrinfo()).
@@ -800,6 +846,25 @@
 #define IP_REASS_MAX_PBUFS              10
 #endif
 
+/**
+ * IP_REASS_MAX_PBUFS_PER_DATAGRAM: Maximum amount of pbufs a single datagram
+ * may hold while being reassembled. A datagram exceeding this is dropped, so
+ * a stream of tiny fragments cannot take all of IP_REASS_MAX_PBUFS.
+ */
+#if !defined IP_REASS_MAX_PBUFS_PER_DATAGRAM || defined __DOXYGEN__
+#define IP_REASS_MAX_PBUFS_PER_DATAGRAM IP_REASS_MAX_PBUFS
+#endif
+
+/**
+ * IP_REASS_MAX_DATAGRAMS_PER_SRC: Maximum amount of datagrams from the same
+ * source address being reassembled at a time (0 = no limit). When a source
+ * reaches its limit, its oldest datagram is freed (or, without
+ * IP_REASS_FREE_OLDEST, the new fragment is dropped).
+ */
+#if !defined IP_REASS_MAX_DATAGRAMS_PER_SRC || defined __DOXYGEN__
+#define IP_REASS_MAX_DATAGRAMS_PER_SRC  0
+#endif
+
 /**
  * IP_DEFAULT_TTL: Default value for Time-To-Live used by transport layers.
  */
@@ -1437,6 +1502,16 @@
 #endif
 #endif
 
+/**
+ * TCP_OOSEQ_GLOBAL_MAX_BYTES: The maximum number of bytes queued on ooseq
+ * over all pcbs. When a pcb queues out-of-sequence data exceeding this limit,
+ * its highest-sequence segments are dropped first. Default is 0 (no limit).
+ * Only valid for TCP_QUEUE_OOSEQ==1.
+ */
+#if !defined TCP_OOSEQ_GLOBAL_MAX_BYTES || defined __DOXYGEN__
+#define TCP_OOSEQ_GLOBAL_MAX_BYTES      0
+#endif
+
 /**
  * TCP_LISTEN_BACKLOG: Enable the backlog option for tcp listen pcb.
  */
@@ -1530,6 +1605,16 @@
 #define LWIP_TCP_PCB_NUM_EXT_ARGS       0
 #endif
 
+/**
+ * LWIP_TCP_WRITE_ZEROCOPY==1: enable tcp_write_zc(), a variant of tcp_write()
+ * that references application memory and calls a release callback once the
+ * last segment referencing that memory has been ACKed and freed.
+ * Requires LWIP_SUPPORT_CUSTOM_PBUF.
+ */
+#if !defined LWIP_TCP_WRITE_ZEROCOPY || defined __DOXYGEN__
+#define LWIP_TCP_WRITE_ZEROCOPY         0
+#endif
+
 /** LWIP_ALTCP==1: enable the altcp API.
  * altcp is an abstraction layer that prevents applications linking against the
  * tcp.h functions but provides the same functionality. It is used to e.g. add
@@ -1724,6 +1809,33 @@
 #if !defined LWIP_NUM_NETIF_CLIENT_DATA || defined __DOXYGEN__
 #define LWIP_NUM_NETIF_CLIENT_DATA      0
 #endif
+
+/**
+ * LWIP_GRO==1: Support receive-side coalescing of back-to-back in-order
+ * TCP segments (see @ref gro). The driver passes received frames to
+ * gro_input() instead of netif->input() and calls gro_flush() after each
+ * RX batch.
+ */
+#if !defined LWIP_GRO || defined __DOXYGEN__
+#define LWIP_GRO                        0
+#endif
+
+/**
+ * LWIP_GRO_MAX_FLOWS: Number of TCP flows that can be coalesced at the
+ * same time. Each flow holds back one pbuf chain until it is flushed.
+ */
+#if !defined LWIP_GRO_MAX_FLOWS || defined __DOXYGEN__
+#define LWIP_GRO_MAX_FLOWS              2
+#endif
+
+/**
+ * LWIP_GRO_MAX_SEGS: Maximum number of segments merged into one. Keep this
+ * well below PBUF_POOL_SIZE: the merged segments stay allocated until the
+ * flow is flushed.
+ */
+#if !defined LWIP_GRO_MAX_SEGS || defined __DOXYGEN__
+#define LWIP_GRO_MAX_SEGS               4
+#endif
 /**
  * @}
  */
@@ -1834,6 +1946,16 @@
 #define TCPIP_MBOX_SIZE                 0
 #endif
 
+/**
+ * TCPIP_INPKT_BURST_MAX: the maximum number of packets tcpip_inpkt_burst()
+ * passes to tcpip_thread in one message. Drivers that receive packets in
+ * bursts then pay for one message and one mbox round trip per burst
+ * instead of per packet. 0 disables tcpip_inpkt_burst().
+ */
+#if !defined TCPIP_INPKT_BURST_MAX || defined __DOXYGEN__
+#define TCPIP_INPKT_BURST_MAX           0
+#endif
+
 /**
  * Define this to something that triggers a watchdog. This is called from
  * tcpip_thread after processing a message.
@@ -1977,6 +2099,17 @@
 #if !defined LWIP_NETCONN_FULLDUPLEX || defined __DOXYGEN__
 #define LWIP_NETCONN_FULLDUPLEX         0
 #endif
+
+/** LWIP_NETCONN_RECV_QUEUE==1: TCP netconns queue received data in a pbuf
+ * queue of their own instead of posting every segment to the recvmbox.
+ * Only a segment that finds the queue empty posts a wakeup to the recvmbox,
+ * and a receive takes everything queued (up to 64k) as one pbuf chain, so a
+ * reader is woken once per burst. The queue is protected by SYS_ARCH_PROTECT.
+ * The netconn callback sees NETCONN_EVT_RCVPLUS/RCVMINUS once per burst, too.
+ */
+#if !defined LWIP_NETCONN_RECV_QUEUE || defined __DOXYGEN__
+#define LWIP_NETCONN_RECV_QUEUE         0
+#endif
 /**
  * @}
  */
@@ -2145,6 +2278,45 @@
 #if !defined LWIP_SOCKET_POLL || defined __DOXYGEN__
 #define LWIP_SOCKET_POLL                1
 #endif
+
+/**
+ * LWIP_SOCKET_EPOLL==1: enable lwip_epoll_create(), lwip_epoll_ctl() and
+ * lwip_epoll_wait(). Each epoll instance keeps its interest list across
+ * calls and a ready list that is filled from the netconn event callback,
+ * so waiting costs O(ready sockets) instead of O(all sockets) as with
+ * select() and poll(). Needs LWIP_SOCKET_SELECT or LWIP_SOCKET_POLL for
+ * the per-socket event counters.
+ */
+#if !defined LWIP_SOCKET_EPOLL || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL               0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_NUM: the number of epoll instances that can be open
+ * at the same time. Their file descriptors follow the socket descriptors.
+ */
+#if !defined LWIP_SOCKET_EPOLL_NUM || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL_NUM           1
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG_BATCH: the maximum number of datagrams lwip_sendmmsg()
+ * passes to the stack with one core lock (or tcpip message). The netbufs
+ * for a batch live on the stack of the calling task.
+ */
+#if !defined LWIP_SOCKET_MMSG_BATCH || defined __DOXYGEN__
+#define LWIP_SOCKET_MMSG_BATCH          8
+#endif
+
+/**
+ * LWIP_SOCKET_ZEROCOPY_RECV==1: Enable lwip_recvmsg_zc(), which lends the
+ * received pbufs to the application instead of copying them. The pbufs (and
+ * for TCP, the receive window) are only given back by
+ * lwip_recvmsg_zc_release(), so holding on to them can drain PBUF_POOL.
+ */
+#if !defined LWIP_SOCKET_ZEROCOPY_RECV || defined __DOXYGEN__
+#define LWIP_SOCKET_ZEROCOPY_RECV       0
+#endif
 /**
  * @}
  */
@@ -3329,6 +3501,13 @@
 #define ETHARP_DEBUG                    LWIP_DBG_ON
 #endif
 
+/**
+ * GRO_DEBUG: Enable debugging in gro.c.
+ */
+#if !defined GRO_DEBUG || defined __DOXYGEN__
+#define GRO_DEBUG                       LWIP_DBG_OFF
+#endif
+
 /**
  * NETIF_DEBUG: Enable debugging in netif.c.
  */
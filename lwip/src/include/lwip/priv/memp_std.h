@@ -50,6 +50,10 @@ LWIP_MEMPOOL(UDP_PCB,        MEMP_NUM_UDP_PCB,         sizeof(struct udp_pcb),
 LWIP_MEMPOOL(TCP_PCB,        MEMP_NUM_TCP_PCB,         sizeof(struct tcp_pcb),        "TCP_PCB")
 LWIP_MEMPOOL(TCP_PCB_LISTEN, MEMP_NUM_TCP_PCB_LISTEN,  sizeof(struct tcp_pcb_listen), "TCP_PCB_LISTEN")
 LWIP_MEMPOOL(TCP_SEG,        MEMP_NUM_TCP_SEG,         sizeof(struct tcp_seg),        "TCP_SEG")
+#if LWIP_TCP_WRITE_ZEROCOPY
+LWIP_MEMPOOL(TCP_ZC_REF,     MEMP_NUM_TCP_ZC_REF,      sizeof(struct tcp_zc_ref),     "TCP_ZC_REF")
+LWIP_MEMPOOL(TCP_ZC_PBUF,    MEMP_NUM_TCP_ZC_PBUF,     sizeof(struct tcp_zc_pbuf),    "TCP_ZC_PBUF")
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
 #endif /* LWIP_TCP */
 
 #if LWIP_ALTCP && LWIP_TCP
@@ -59,14 +63,22 @@ LWIP_MEMPOOL(ALTCP_PCB,      MEMP_NUM_ALTCP_PCB,       sizeof(struct altcp_pcb),
 #if LWIP_IPV4 && IP_REASSEMBLY
 LWIP_MEMPOOL(REASSDATA,      MEMP_NUM_REASSDATA,       sizeof(struct ip_reassdata),   "REASSDATA")
 #endif /* LWIP_IPV4 && IP_REASSEMBLY */
-#if (IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG)
+#if LWIP_IPV4 && IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF
+LWIP_MEMPOOL(FRAG_PBUF,      MEMP_NUM_FRAG_PBUF,       sizeof(struct ip_frag_hdr_pbuf),"FRAG_PBUF")
+#elif LWIP_IPV6 && LWIP_IPV6_FRAG
 LWIP_MEMPOOL(FRAG_PBUF,      MEMP_NUM_FRAG_PBUF,       sizeof(struct pbuf_custom_ref),"FRAG_PBUF")
-#endif /* IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF || (LWIP_IPV6 && LWIP_IPV6_FRAG) */
+#endif /* LWIP_IPV4 && IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF */
 
 #if LWIP_NETCONN || LWIP_SOCKET
 LWIP_MEMPOOL(NETBUF,         MEMP_NUM_NETBUF,          sizeof(struct netbuf),         "NETBUF")
 LWIP_MEMPOOL(NETCONN,        MEMP_NUM_NETCONN,         sizeof(struct netconn),        "NETCONN")
 #endif /* LWIP_NETCONN || LWIP_SOCKET */
+#if LWIP_SOCKET && LWIP_SOCKET_EPOLL
+LWIP_MEMPOOL(EPOLL_ITEM,     MEMP_NUM_EPOLL_ITEM,      sizeof(struct lwip_epoll_item), "EPOLL_ITEM")
+#endif /* LWIP_SOCKET && LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET && LWIP_SOCKET_ZEROCOPY_RECV
+LWIP_MEMPOOL(ZC_HANDLE,      MEMP_NUM_ZC_HANDLE,       sizeof(struct lwip_zc_handle), "ZC_HANDLE")
+#endif /* LWIP_SOCKET && LWIP_SOCKET_ZEROCOPY_RECV */
 
 #if NO_SYS==0
 LWIP_MEMPOOL(TCPIP_MSG_API,  MEMP_NUM_TCPIP_MSG_API,   sizeof(struct tcpip_msg),      "TCPIP_MSG_API")
@@ -87,6 +99,9 @@ LWIP_MEMPOOL(NETIFAPI_MSG,   MEMP_NUM_NETIFAPI_MSG,    sizeof(struct netifapi_ms
 #endif /* LWIP_MPU_COMPATIBLE */
 #if !LWIP_TCPIP_CORE_LOCKING_INPUT
 LWIP_MEMPOOL(TCPIP_MSG_INPKT,MEMP_NUM_TCPIP_MSG_INPKT, sizeof(struct tcpip_msg),      "TCPIP_MSG_INPKT")
+#if TCPIP_INPKT_BURST_MAX
+LWIP_MEMPOOL(TCPIP_MSG_INPKT_BURST, MEMP_NUM_TCPIP_MSG_INPKT_BURST, sizeof(struct tcpip_msg_inpkt_burst), "TCPIP_MSG_INPKT_BURST")
+#endif /* TCPIP_INPKT_BURST_MAX */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 #endif /* NO_SYS==0 */
 
@@ -63,6 +63,43 @@ union lwip_sock_lastdata {
   struct pbuf *pbuf;
 };
 
+#if LWIP_SOCKET_EPOLL
+struct lwip_epoll;
+
+/** A socket registered with an epoll instance */
+struct lwip_epoll_item {
+  /** next item registered for the same socket */
+  struct lwip_epoll_item *sock_next;
+  /** next item on the ready list of the epoll instance */
+  struct lwip_epoll_item *ready_next;
+  /** the epoll instance this item belongs to */
+  struct lwip_epoll *ep;
+  /** the registered socket */
+  int fd;
+  /** events and flags passed to epoll_ctl */
+  u32_t events;
+  /** user data passed to epoll_ctl, returned by epoll_wait */
+  epoll_data_t data;
+  /** 1 while on the ready list */
+  u8_t ready;
+  /** EPOLLONESHOT: 1 after the event was reported, until EPOLL_CTL_MOD */
+  u8_t disabled;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
+#if LWIP_SOCKET_ZEROCOPY_RECV
+/** The pbufs lent by lwip_recvmsg_zc(), handed out as its handle */
+struct lwip_zc_handle {
+  /** the lent pbuf chain */
+  struct pbuf *p;
+  /** socket the pbufs were received on and its generation then: the TCP
+      window is only opened if the socket passed to the release is still
+      that one */
+  struct lwip_sock *sock;
+  u32_t sock_gen;
+};
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV */
+
 /** Contains all internal pointers and states used for a socket */
 struct lwip_sock {
   /** sockets currently are built on netconns, each socket has one netconn */
@@ -81,6 +118,16 @@ struct lwip_sock {
   /** counter of how many threads are waiting for this socket using select */
   SELWAIT_T select_waiting;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+  /** epoll instances this socket is registered with */
+  struct lwip_epoll_item *epoll_items;
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_ZEROCOPY_RECV
+  /** bumped each time the descriptor is allocated, so handles lent on an
+      earlier socket with the same descriptor (and maybe the same netconn
+      address, memp is LIFO) are told apart */
+  u32_t gen;
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV */
 #if LWIP_NETCONN_FULLDUPLEX
   /* counter of how many threads are using a struct lwip_sock (not the 'int') */
   u8_t fd_used;
@@ -270,6 +270,21 @@ struct tcp_seg {
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
+#if LWIP_TCP_WRITE_ZEROCOPY
+/* Application buffer passed to tcp_write_zc(), shared by all pbufs referencing it */
+struct tcp_zc_ref {
+  tcp_zc_release_fn release;
+  void *token;
+  u16_t refcnt;            /* number of pbufs + 1 while tcp_write_zc() runs */
+};
+
+/* A PBUF_REF pbuf pointing into a buffer passed to tcp_write_zc() */
+struct tcp_zc_pbuf {
+  struct pbuf_custom pc;
+  struct tcp_zc_ref *ref;
+};
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+
 #define LWIP_TCP_OPT_EOL        0
 #define LWIP_TCP_OPT_NOP        1
 #define LWIP_TCP_OPT_MSS        2
@@ -323,6 +338,9 @@ struct tcp_seg {
 extern struct tcp_pcb *tcp_input_pcb;
 extern u32_t tcp_ticks;
 extern u8_t tcp_active_pcbs_changed;
+#if TCP_QUEUE_OOSEQ
+extern u32_t tcp_ooseq_bytes;
+#endif /* TCP_QUEUE_OOSEQ */
 
 /* The TCP PCB lists. */
 union tcp_listen_pcbs_t { /* List of all TCP PCBs in LISTEN state. */
@@ -508,6 +526,7 @@ void tcp_netif_ip_addr_changed(const ip_addr_t* old_addr, const ip_addr_t* new_a
 
 #if TCP_QUEUE_OOSEQ
 void tcp_free_ooseq(struct tcp_pcb *pcb);
+void tcp_ooseq_limit(struct tcp_pcb *pcb, u32_t max_bytes, u16_t max_pbufs);
 #endif
 
 #if LWIP_TCP_PCB_NUM_EXT_ARGS
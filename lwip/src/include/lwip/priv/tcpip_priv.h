@@ -117,6 +117,9 @@ enum tcpip_msg_type {
 #endif /* !LWIP_TCPIP_CORE_LOCKING */
 #if !LWIP_TCPIP_CORE_LOCKING_INPUT
   TCPIP_MSG_INPKT,
+#if TCPIP_INPKT_BURST_MAX
+  TCPIP_MSG_INPKT_BURST,
+#endif /* TCPIP_INPKT_BURST_MAX */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 #if LWIP_TCPIP_TIMEOUT && LWIP_TIMERS
   TCPIP_MSG_TIMEOUT,
@@ -152,6 +155,12 @@ struct tcpip_msg {
       struct netif *netif;
       netif_input_fn input_fn;
     } inp;
+#if TCPIP_INPKT_BURST_MAX
+    struct {
+      netif_input_fn input_fn;
+      u16_t count;
+    } inp_burst;
+#endif /* TCPIP_INPKT_BURST_MAX */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
     struct {
       tcpip_callback_fn function;
@@ -167,6 +176,15 @@ struct tcpip_msg {
   } msg;
 };
 
+#if !LWIP_TCPIP_CORE_LOCKING_INPUT && TCPIP_INPKT_BURST_MAX
+/** A TCPIP_MSG_INPKT_BURST message, the packets follow the common header */
+struct tcpip_msg_inpkt_burst {
+  struct tcpip_msg msg;
+  struct pbuf *p[TCPIP_INPKT_BURST_MAX];
+  struct netif *netif[TCPIP_INPKT_BURST_MAX];
+};
+#endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT && TCPIP_INPKT_BURST_MAX */
+
 #ifdef __cplusplus
 }
 #endif
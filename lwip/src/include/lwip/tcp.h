@@ -96,6 +96,20 @@ typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb,
 typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb,
                               u16_t len);
 
+#if LWIP_TCP_WRITE_ZEROCOPY
+/** Function prototype for tcp_write_zc() release callback functions. Called
+ * when the stack does not reference the buffer passed to tcp_write_zc() any
+ * more, i.e. all data from it has been acknowledged (or the pcb was freed).
+ * The buffer may be reused or freed from now on.
+ *
+ * This is called from within the stack (usually while processing an ACK):
+ * don't call into the tcp API from this callback.
+ *
+ * @param token The token passed to tcp_write_zc()
+ */
+typedef void (*tcp_zc_release_fn)(void *token);
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+
 /** Function prototype for tcp poll callback functions. Called periodically as
  * specified by @see tcp_poll.
  *
@@ -339,6 +353,8 @@ struct tcp_pcb {
   struct tcp_seg *unacked;  /* Sent but unacknowledged segments. */
 #if TCP_QUEUE_OOSEQ
   struct tcp_seg *ooseq;    /* Received out of sequence segments. */
+  struct tcp_seg *ooseq_tail; /* Last segment on ooseq (valid if ooseq != NULL) */
+  u32_t ooseq_bytes;        /* Number of data bytes queued on ooseq */
 #endif /* TCP_QUEUE_OOSEQ */
 
   struct pbuf *refused_data; /* Data previously received but not yet taken by upper layer */
@@ -472,6 +488,10 @@ err_t            tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx);
 
 err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t len,
                               u8_t apiflags);
+#if LWIP_TCP_WRITE_ZEROCOPY
+err_t            tcp_write_zc(struct tcp_pcb *pcb, const void *dataptr, u16_t len,
+                              u8_t apiflags, tcp_zc_release_fn release, void *token);
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
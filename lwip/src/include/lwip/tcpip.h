@@ -78,6 +78,9 @@ void   tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg);
 
 err_t  tcpip_inpkt(struct pbuf *p, struct netif *inp, netif_input_fn input_fn);
 err_t  tcpip_input(struct pbuf *p, struct netif *inp);
+#if TCPIP_INPKT_BURST_MAX
+err_t  tcpip_inpkt_burst(struct pbuf **p, struct netif **inp, u16_t count, netif_input_fn input_fn);
+#endif /* TCPIP_INPKT_BURST_MAX */
 
 err_t  tcpip_try_callback(tcpip_callback_fn function, void *ctx);
 err_t  tcpip_callback(tcpip_callback_fn function, void *ctx);
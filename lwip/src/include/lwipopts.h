@@ -43,6 +43,23 @@
  * will be set to standard values. Override anything you dont like!
  */
 #include "lwipopts.h"
+
+/* Record LWIP_DEBUGF() and LWIP_ERROR() messages in the RAM ring of
+ * platform/trace.c instead of printing them, which would stall the packet
+ * path. Read them with trace_dump() or the UDP port of trace_udp_init()
+ * and render them with tools/trace_decode.py. The host build prints them.
+ * This has to come before lwip/debug.h supplies its default. */
+#if !USE_HOST
+#ifndef LWIP_DEBUGF_TRACE
+#define LWIP_DEBUGF_TRACE 1
+#endif
+
+#if LWIP_DEBUGF_TRACE
+#include "trace.h"
+#define LWIP_PLATFORM_DEBUGF(x) TRACE x
+#endif
+#endif /* !USE_HOST */
+
 #include "lwip/debug.h"
 
 /*
@@ -77,6 +94,15 @@
    ------------------------------------
 */
 
+/**
+ * MEMCPY, SMEMCPY: copy packet data with the burst copy from
+ * platform/fastmem.c. Small constant sized copies are left to memcpy(),
+ * which gcc inlines.
+ */
+#include "fastmem.h"
+#define MEMCPY(dst,src,len)             fast_memcpy(dst,src,len)
+#define SMEMCPY(dst,src,len)            (__builtin_constant_p(len) ? memcpy(dst,src,len) : fast_memcpy(dst,src,len))
+
 /**
  * MEM_ALIGNMENT: should be set to the alignment of the CPU
  *    4 byte alignment -> #define MEM_ALIGNMENT 4
@@ -350,6 +376,14 @@
 
 #define TCP_LISTEN_BACKLOG              1
 
+/**
+ * TCP_OOSEQ_MAX_BYTES / TCP_OOSEQ_GLOBAL_MAX_BYTES: out-of-sequence data
+ * sits in PBUF_POOL pbufs, so keep at least half of the (small) pool free
+ * for receiving, whatever the window and the number of connections.
+ */
+#define TCP_OOSEQ_MAX_BYTES             (2 * TCP_MSS)
+#define TCP_OOSEQ_GLOBAL_MAX_BYTES      (4 * TCP_MSS)
+
 
 /*
    ----------------------------------
@@ -371,6 +405,21 @@
  */
 #define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
 
+/*
+   ---------------------------------
+   ---------- NETIF options --------
+   ---------------------------------
+*/
+/**
+ * LWIP_GRO==1: Merge in-order TCP segments of one RX batch before passing
+ * them to ethernet_input(). Every merged segment keeps a PBUF_POOL buffer
+ * until the batch is flushed, so LWIP_GRO_MAX_SEGS must stay well below
+ * PBUF_POOL_SIZE.
+ */
+#define LWIP_GRO                        0
+#define LWIP_GRO_MAX_FLOWS              2
+#define LWIP_GRO_MAX_SEGS               4
+
 /*
    ------------------------------------
    ---------- LOOPIF options ----------
@@ -420,6 +469,13 @@
  * LWIP_STATS==1: Enable statistics collection in lwip_stats.
  */
 #define LWIP_STATS                      1
+
+/**
+ * LWIP_PERF==1: Record latency histograms for the PERF_START/PERF_STOP
+ * sites of lwIP and the probes in app.c (platform/perfhist.c). Press 'p'
+ * on the console to print them, 'r' to reset them.
+ */
+#define LWIP_PERF                       0
 /*
    ---------------------------------
    ---------- PPP options ----------
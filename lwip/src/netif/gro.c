@@ -0,0 +1,375 @@
+/**
+ * @file
+ * Receive-side coalescing of in-order TCP segments (GRO)
+ *
+ */
+
+/*
+ * Copyright (c) 2026 lwIP contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/**
+ * @defgroup gro Receive coalescing (GRO)
+ * @ingroup netifs
+ * Merges back-to-back in-order TCP segments of one flow that arrive within
+ * one RX batch into a single pbuf chain, so that ip4_input()/tcp_input()
+ * (PCB lookup, ACK processing, recv callback) run once per burst instead
+ * of once per segment.
+ *
+ * Usage: in the driver poll loop pass every received frame to gro_input()
+ * instead of netif->input() and call gro_flush() once the RX batch is done.
+ * Frames that can't be coalesced are passed on to netif->input() at once.
+ *
+ * Only plain IPv4/TCP frames are merged: no IP options, no fragments,
+ * ACK (and PSH) flags only, identical TCP options, ackno and TTL/TOS.
+ * The TCP checksum of the merged segment is derived incrementally from the
+ * checksums of its parts (RFC 1624), so a corrupted part still fails the
+ * checksum test in tcp_input(). PSH ends a burst.
+ *
+ * The merged segment covers more than one MSS; tcp_receive() acknowledges
+ * such a segment at once, just like it would have done for every second
+ * full-sized segment.
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_GRO /* don't build if not configured for use in lwipopts.h */
+
+#include "netif/gro.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/stats.h"
+
+#include <string.h>
+
+#if !LWIP_IPV4 || !LWIP_TCP || !(LWIP_ARP || LWIP_ETHERNET)
+#error "LWIP_GRO needs LWIP_IPV4, LWIP_TCP and ethernet support"
+#endif
+
+/* TCP header flags (and reserved bits) a segment may carry to be merged */
+#define GRO_TCPH_MASK 0x0fffU
+
+/** One TCP flow held back for coalescing */
+struct gro_flow {
+  /** merged frame (starting with the ethernet header) or NULL if unused */
+  struct pbuf *p;
+  struct netif *inp;
+  /** sequence number expected for the next segment of this flow */
+  u32_t next_seqno;
+  /** TCP payload bytes held so far */
+  u16_t payload_len;
+  /** number of segments merged into p */
+  u16_t segs;
+};
+
+static struct gro_flow gro_flows[LWIP_GRO_MAX_FLOWS];
+/** slot to take over when all slots are in use */
+static u8_t gro_victim;
+
+/** Headers of a frame that passed the GRO checks */
+struct gro_hdrs {
+  struct eth_hdr *ethhdr;
+  struct ip_hdr *iphdr;
+  struct tcp_hdr *tcphdr;
+  u16_t hdr_len;
+  u16_t tcp_len;
+  u16_t payload_len;
+};
+
+/** Parse the headers of a received frame.
+ * @return 1 if the frame is a TCP segment that may be merged, 0 otherwise
+ */
+static int
+gro_parse(struct pbuf *p, struct netif *inp, struct gro_hdrs *h)
+{
+  u16_t iphdr_len;
+  u16_t ip_len;
+  u16_t tcphdr_len;
+
+  LWIP_UNUSED_ARG(inp); /* without LWIP_CHECKSUM_CTRL_PER_NETIF */
+
+  if (p->len < SIZEOF_ETH_HDR + IP_HLEN + TCP_HLEN) {
+    return 0;
+  }
+  /* as in ethernet_input(), p->payload points to the ETH_PAD_SIZE bytes in
+     front of the header, which struct eth_hdr and SIZEOF_ETH_HDR include */
+  h->ethhdr = (struct eth_hdr *)p->payload;
+  if (h->ethhdr->type != PP_HTONS(ETHTYPE_IP)) {
+    return 0;
+  }
+  h->iphdr = (struct ip_hdr *)((u8_t *)p->payload + SIZEOF_ETH_HDR);
+  if ((IPH_V(h->iphdr) != 4) || (IPH_PROTO(h->iphdr) != IP_PROTO_TCP)) {
+    return 0;
+  }
+  iphdr_len = IPH_HL_BYTES(h->iphdr);
+  if (iphdr_len != IP_HLEN) {
+    /* IP options are not merged */
+    return 0;
+  }
+  if ((IPH_OFFSET(h->iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0) {
+    return 0;
+  }
+  ip_len = lwip_ntohs(IPH_LEN(h->iphdr));
+  if ((ip_len < IP_HLEN + TCP_HLEN) || (ip_len > p->tot_len - SIZEOF_ETH_HDR)) {
+    return 0;
+  }
+  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_IP) {
+    if (inet_chksum(h->iphdr, IP_HLEN) != 0) {
+      /* leave it to ip4_input() to drop and count this one */
+      return 0;
+    }
+  }
+  h->tcphdr = (struct tcp_hdr *)((u8_t *)h->iphdr + IP_HLEN);
+  tcphdr_len = TCPH_HDRLEN_BYTES(h->tcphdr);
+  if ((tcphdr_len < TCP_HLEN) || (tcphdr_len > ip_len - IP_HLEN) ||
+      (p->len < SIZEOF_ETH_HDR + IP_HLEN + tcphdr_len)) {
+    return 0;
+  }
+  h->hdr_len = (u16_t)(SIZEOF_ETH_HDR + IP_HLEN + tcphdr_len);
+  h->tcp_len = (u16_t)(ip_len - IP_HLEN);
+  h->payload_len = (u16_t)(h->tcp_len - tcphdr_len);
+  if (p->tot_len > SIZEOF_ETH_HDR + ip_len) {
+    /* cut ethernet padding so it does not end up in the middle of a chain */
+    pbuf_realloc(p, (u16_t)(SIZEOF_ETH_HDR + ip_len));
+  }
+  return 1;
+}
+
+/** A segment can start or extend a burst if it only carries ACK (and PSH) */
+static int
+gro_is_data(const struct gro_hdrs *h)
+{
+  return (h->payload_len > 0) &&
+         ((lwip_ntohs(h->tcphdr->_hdrlen_rsvd_flags) & GRO_TCPH_MASK & ~TCP_PSH) == TCP_ACK);
+}
+
+/** Check whether two frames belong to the same TCP flow */
+static int
+gro_same_flow(const struct gro_hdrs *a, const struct gro_hdrs *b)
+{
+  return ip4_addr_eq(&a->iphdr->src, &b->iphdr->src) &&
+         ip4_addr_eq(&a->iphdr->dest, &b->iphdr->dest) &&
+         (a->tcphdr->src == b->tcphdr->src) &&
+         (a->tcphdr->dest == b->tcphdr->dest);
+}
+
+/** One's complement sum over the TCP pseudo header and the TCP header
+ * (including its checksum field), not folded */
+static u32_t
+gro_hdr_sum(const struct gro_hdrs *h)
+{
+  u32_t acc;
+  u32_t addr;
+
+  addr = ip4_addr_get_u32(&h->iphdr->src);
+  acc = (addr & 0xffffUL) + ((addr >> 16) & 0xffffUL);
+  addr = ip4_addr_get_u32(&h->iphdr->dest);
+  acc += (addr & 0xffffUL) + ((addr >> 16) & 0xffffUL);
+  acc += (u32_t)lwip_htons((u16_t)IP_PROTO_TCP);
+  acc += (u32_t)lwip_htons(h->tcp_len);
+  acc += (u16_t)~inet_chksum(h->tcphdr, TCPH_HDRLEN_BYTES(h->tcphdr));
+  return acc;
+}
+
+/** Pass a held frame on to the stack and release its slot */
+static void
+gro_flush_flow(struct gro_flow *flow)
+{
+  struct pbuf *p = flow->p;
+  struct netif *inp = flow->inp;
+
+  flow->p = NULL;
+  flow->inp = NULL;
+  if (p != NULL) {
+    LWIP_DEBUGF(GRO_DEBUG | LWIP_DBG_TRACE, ("gro_flush_flow: %"U16_F" segments, %"U16_F" bytes\n",
+                flow->segs, flow->payload_len));
+    if (inp->input(p, inp) != ERR_OK) {
+      pbuf_free(p);
+      LINK_STATS_INC(link.drop);
+    }
+  }
+}
+
+/** Append the payload of q (with headers nq) to the frame held in flow.
+ * @return 1 if merged (q now belongs to the held frame), 0 if not mergeable
+ */
+static int
+gro_merge(struct gro_flow *flow, struct pbuf *q, const struct gro_hdrs *nq)
+{
+  struct gro_hdrs h;
+  u32_t acc;
+  u16_t tcphdr_len;
+
+  /* the held frame was checked by gro_parse() already */
+  h.ethhdr = (struct eth_hdr *)flow->p->payload;
+  h.iphdr = (struct ip_hdr *)((u8_t *)flow->p->payload + SIZEOF_ETH_HDR);
+  h.tcphdr = (struct tcp_hdr *)((u8_t *)h.iphdr + IP_HLEN);
+  tcphdr_len = TCPH_HDRLEN_BYTES(h.tcphdr);
+  h.tcp_len = (u16_t)(lwip_ntohs(IPH_LEN(h.iphdr)) - IP_HLEN);
+
+  if ((lwip_ntohl(nq->tcphdr->seqno) != flow->next_seqno) ||
+      (nq->tcphdr->ackno != h.tcphdr->ackno) ||
+      (TCPH_HDRLEN_BYTES(nq->tcphdr) != tcphdr_len) ||
+      (memcmp(nq->tcphdr + 1, h.tcphdr + 1, tcphdr_len - TCP_HLEN) != 0) ||
+      (IPH_TOS(nq->iphdr) != IPH_TOS(h.iphdr)) ||
+      (IPH_TTL(nq->iphdr) != IPH_TTL(h.iphdr)) ||
+      (IPH_OFFSET(nq->iphdr) != IPH_OFFSET(h.iphdr)) ||
+      (memcmp(&nq->ethhdr->dest, &h.ethhdr->dest, SIZEOF_ETH_HDR - ETH_PAD_SIZE) != 0)) {
+    return 0;
+  }
+  if ((flow->payload_len & 1) != 0) {
+    /* an odd offset would need the checksum of q's data byte-swapped */
+    return 0;
+  }
+  if ((u32_t)IP_HLEN + h.tcp_len + nq->payload_len > 0xffffUL) {
+    return 0;
+  }
+
+  /* Checksum of the merged segment: sum of both segments' sums, corrected
+     by the sum of the new header. Data sums are never touched. */
+  acc = gro_hdr_sum(&h) + gro_hdr_sum(nq);
+
+  h.tcp_len = (u16_t)(h.tcp_len + nq->payload_len);
+  IPH_LEN_SET(h.iphdr, lwip_htons((u16_t)(IP_HLEN + h.tcp_len)));
+  IPH_CHKSUM_SET(h.iphdr, 0);
+  IPH_CHKSUM_SET(h.iphdr, inet_chksum(h.iphdr, IP_HLEN));
+  /* the most recent window and PSH are valid for the whole burst */
+  h.tcphdr->wnd = nq->tcphdr->wnd;
+  if (TCPH_FLAGS(nq->tcphdr) & TCP_PSH) {
+    TCPH_SET_FLAG(h.tcphdr, TCP_PSH);
+  }
+  h.tcphdr->chksum = 0;
+  acc += (u16_t)~FOLD_U32T(FOLD_U32T(gro_hdr_sum(&h)));
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  h.tcphdr->chksum = (u16_t)acc;
+
+  /* cannot fail, gro_parse() made sure the headers are in the first pbuf */
+  pbuf_remove_header(q, nq->hdr_len);
+  pbuf_cat(flow->p, q);
+  flow->next_seqno += nq->payload_len;
+  flow->payload_len = (u16_t)(flow->payload_len + nq->payload_len);
+  flow->segs++;
+  return 1;
+}
+
+/**
+ * @ingroup gro
+ * Receive a frame from the driver. The frame is either held back to merge
+ * it with following segments of its flow, or passed to inp->input() now.
+ *
+ * @param p the received frame, starting with the ethernet header
+ * @param inp the netif p was received on
+ * @return ERR_OK if p was taken, any other value means the caller must
+ *         free p (just like for netif->input)
+ */
+err_t
+gro_input(struct pbuf *p, struct netif *inp)
+{
+  struct gro_hdrs nq;
+  struct gro_flow *flow = NULL;
+  u8_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("gro_input: invalid pbuf", p != NULL);
+  LWIP_ASSERT("gro_input: invalid netif", inp != NULL);
+
+  if (!gro_parse(p, inp, &nq)) {
+    return inp->input(p, inp);
+  }
+
+  for (i = 0; i < LWIP_GRO_MAX_FLOWS; i++) {
+    if ((gro_flows[i].p != NULL) && (gro_flows[i].inp == inp)) {
+      struct gro_hdrs h;
+      h.iphdr = (struct ip_hdr *)((u8_t *)gro_flows[i].p->payload + SIZEOF_ETH_HDR);
+      h.tcphdr = (struct tcp_hdr *)((u8_t *)h.iphdr + IP_HLEN);
+      if (gro_same_flow(&h, &nq)) {
+        flow = &gro_flows[i];
+        break;
+      }
+    }
+  }
+
+  if (flow != NULL) {
+    if (gro_is_data(&nq) && gro_merge(flow, p, &nq)) {
+      if ((TCPH_FLAGS(nq.tcphdr) & TCP_PSH) || (flow->segs >= LWIP_GRO_MAX_SEGS)) {
+        gro_flush_flow(flow);
+      }
+      return ERR_OK;
+    }
+    /* keep the order within the flow */
+    gro_flush_flow(flow);
+  }
+
+  if (!gro_is_data(&nq) || (TCPH_FLAGS(nq.tcphdr) & TCP_PSH)) {
+    return inp->input(p, inp);
+  }
+
+  if (flow == NULL) {
+    for (i = 0; i < LWIP_GRO_MAX_FLOWS; i++) {
+      if (gro_flows[i].p == NULL) {
+        flow = &gro_flows[i];
+        break;
+      }
+    }
+    if (flow == NULL) {
+      flow = &gro_flows[gro_victim];
+      gro_victim = (u8_t)((gro_victim + 1) % LWIP_GRO_MAX_FLOWS);
+      gro_flush_flow(flow);
+    }
+  }
+  flow->p = p;
+  flow->inp = inp;
+  flow->next_seqno = lwip_ntohl(nq.tcphdr->seqno) + nq.payload_len;
+  flow->payload_len = nq.payload_len;
+  flow->segs = 1;
+  return ERR_OK;
+}
+
+/**
+ * @ingroup gro
+ * Pass all frames held back by gro_input() on to the stack. Call this at the
+ * end of every RX batch (and before disabling or removing a netif).
+ */
+void
+gro_flush(void)
+{
+  u8_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  for (i = 0; i < LWIP_GRO_MAX_FLOWS; i++) {
+    gro_flush_flow(&gro_flows[i]);
+  }
+}
+
+#endif /* LWIP_GRO */
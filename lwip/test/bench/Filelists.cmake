@@ -0,0 +1,30 @@
+# lwIP micro benchmarks, built with the unit test lwipopts.h, port and helpers
+
+if(NOT ${CMAKE_VERSION} VERSION_LESS "3.10.0")
+    include_guard(GLOBAL)
+endif()
+
+set(LWIP_BENCHDIR ${LWIP_DIR}/test/bench)
+set(LWIP_BENCHFILES
+	${LWIP_BENCHDIR}/lwip_bench.c
+	${LWIP_BENCHDIR}/bench_pbuf.c
+	${LWIP_BENCHDIR}/bench_etharp.c
+	${LWIP_BENCHDIR}/bench_tcp.c
+	${LWIP_BENCHDIR}/bench_udp.c
+	${LWIP_BENCHDIR}/bench_timers.c
+	${LWIP_DIR}/test/unit/arch/sys_arch.c
+	${LWIP_DIR}/test/unit/tcp/tcp_helper.c
+)
+
+# TCP scenarios over a simulated link
+set(LWIP_SIMFILES
+	${LWIP_BENCHDIR}/lwip_sim.c
+	${LWIP_BENCHDIR}/sim_link.c
+	${LWIP_DIR}/test/unit/arch/sys_arch.c
+)
+
+set(LWIP_SHMIFFILES
+	${LWIP_BENCHDIR}/lwip_shmif.c
+	${LWIP_DIR}/contrib/ports/unix/port/netif/shmif.c
+	${LWIP_DIR}/test/unit/arch/sys_arch.c
+)
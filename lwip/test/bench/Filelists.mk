@@ -0,0 +1,20 @@
+# lwIP micro benchmarks, built with the unit test lwipopts.h, port and helpers
+
+BENCHDIR=$(LWIPDIR)/../test/bench
+BENCHFILES=$(BENCHDIR)/lwip_bench.c \
+	$(BENCHDIR)/bench_pbuf.c \
+	$(BENCHDIR)/bench_etharp.c \
+	$(BENCHDIR)/bench_tcp.c \
+	$(BENCHDIR)/bench_udp.c \
+	$(BENCHDIR)/bench_timers.c \
+	$(LWIPDIR)/../test/unit/arch/sys_arch.c \
+	$(LWIPDIR)/../test/unit/tcp/tcp_helper.c
+
+# TCP scenarios over a simulated link
+SIMFILES=$(BENCHDIR)/lwip_sim.c \
+	$(BENCHDIR)/sim_link.c \
+	$(LWIPDIR)/../test/unit/arch/sys_arch.c
+
+SHMIFFILES=$(BENCHDIR)/lwip_shmif.c \
+	$(LWIPDIR)/../contrib/ports/unix/port/netif/shmif.c \
+	$(LWIPDIR)/../test/unit/arch/sys_arch.c
@@ -0,0 +1,77 @@
+#include "lwip_bench.h"
+
+#include "lwip/etharp.h"
+#include "lwip/netif.h"
+
+#if !ETHARP_SUPPORT_STATIC_ENTRIES
+#error "This benchmark needs ETHARP_SUPPORT_STATIC_ENTRIES"
+#endif
+
+static struct netif bench_netif;
+
+static err_t
+bench_netif_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->output = etharp_output;
+  netif->linkoutput = bench_netif_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+bench_etharp_find(void *arg, u32_t iterations)
+{
+  const ip4_addr_t *addr = (const ip4_addr_t *)arg;
+  struct eth_addr *eth_ret;
+  const ip4_addr_t *ip_ret;
+  u32_t i;
+
+  for (i = 0; i < iterations; i++) {
+    etharp_find_addr(&bench_netif, addr, &eth_ret, &ip_ret);
+  }
+}
+
+/* etharp_find_entry() is static, etharp_find_addr() is its thinnest wrapper */
+void
+etharp_bench(void)
+{
+  static const int fills[] = {1, ARP_TABLE_SIZE / 4, ARP_TABLE_SIZE};
+  ip4_addr_t ipaddr, netmask, gw, addr, miss;
+  struct eth_addr ethaddr = {{0x02, 0, 0, 0, 0, 0}};
+  int filled = 0;
+  size_t i;
+
+  IP4_ADDR(&ipaddr, 192, 168, 0, 1);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 0, 254);
+  netif_add(&bench_netif, &ipaddr, &netmask, &gw, NULL, bench_netif_init, NULL);
+  netif_set_up(&bench_netif);
+  IP4_ADDR(&miss, 192, 168, 0, 250);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(fills); i++) {
+    for (; filled < fills[i]; filled++) {
+      IP4_ADDR(&addr, 192, 168, 0, 10 + filled);
+      ethaddr.addr[5] = (u8_t)filled;
+      etharp_add_static_entry(&addr, &ethaddr);
+    }
+    /* the newest entry, all others are searched before it */
+    bench_run(bench_name("etharp_find_entry/hit", "entries", filled), bench_etharp_find, &addr);
+    bench_run(bench_name("etharp_find_entry/miss", "entries", filled), bench_etharp_find, &miss);
+  }
+
+  for (; filled > 0; filled--) {
+    IP4_ADDR(&addr, 192, 168, 0, 10 + filled - 1);
+    etharp_remove_static_entry(&addr);
+  }
+  netif_remove(&bench_netif);
+}
@@ -0,0 +1,108 @@
+#include "lwip_bench.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/inet_chksum.h"
+
+struct pbuf_alloc_args {
+  pbuf_type type;
+  u16_t len;
+};
+
+static void
+bench_pbuf_alloc_free(void *arg, u32_t iterations)
+{
+  const struct pbuf_alloc_args *a = (const struct pbuf_alloc_args *)arg;
+  u32_t i;
+
+  for (i = 0; i < iterations; i++) {
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, a->len, a->type);
+    LWIP_ASSERT("alloc failed", p != NULL);
+    pbuf_free(p);
+  }
+}
+
+static u8_t copy_buf[1514];
+
+struct pbuf_copy_args {
+  struct pbuf *p;
+  u16_t len;
+  u16_t offset;
+};
+
+static void
+bench_pbuf_copy_partial(void *arg, u32_t iterations)
+{
+  const struct pbuf_copy_args *a = (const struct pbuf_copy_args *)arg;
+  u32_t i;
+
+  for (i = 0; i < iterations; i++) {
+    pbuf_copy_partial(a->p, copy_buf, a->len, a->offset);
+  }
+}
+
+static volatile u16_t chksum_sink;
+
+static void
+bench_inet_chksum_pbuf(void *arg, u32_t iterations)
+{
+  struct pbuf *p = (struct pbuf *)arg;
+  u32_t i;
+
+  for (i = 0; i < iterations; i++) {
+    chksum_sink = inet_chksum_pbuf(p);
+  }
+}
+
+static struct pbuf *
+bench_pbuf_filled(u16_t len, pbuf_type type)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, len, type);
+  u16_t i;
+
+  LWIP_ASSERT("alloc failed", p != NULL);
+  for (i = 0; i < len; i++) {
+    pbuf_put_at(p, i, (u8_t)(i * 7));
+  }
+  return p;
+}
+
+void
+pbuf_bench(void)
+{
+  static const u16_t sizes[] = {64, 1514};
+  struct pbuf_alloc_args alloc_args;
+  struct pbuf_copy_args copy_args;
+  struct pbuf *p;
+  size_t i;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(sizes); i++) {
+    alloc_args.len = sizes[i];
+    alloc_args.type = PBUF_RAM;
+    bench_run(bench_name("pbuf_alloc_free/ram", "len", sizes[i]), bench_pbuf_alloc_free, &alloc_args);
+    alloc_args.type = PBUF_POOL;
+    bench_run(bench_name("pbuf_alloc_free/pool", "len", sizes[i]), bench_pbuf_alloc_free, &alloc_args);
+  }
+  alloc_args.len = 1514;
+  alloc_args.type = PBUF_ROM;
+  bench_run("pbuf_alloc_free/rom", bench_pbuf_alloc_free, &alloc_args);
+  alloc_args.type = PBUF_REF;
+  bench_run("pbuf_alloc_free/ref", bench_pbuf_alloc_free, &alloc_args);
+
+  /* a full frame in a pool chain, as a driver hands it to the stack */
+  p = bench_pbuf_filled(1514, PBUF_POOL);
+  copy_args.p = p;
+  copy_args.len = 1514;
+  copy_args.offset = 0;
+  bench_run("pbuf_copy_partial/pool/len=1514", bench_pbuf_copy_partial, &copy_args);
+  copy_args.len = 64;
+  copy_args.offset = 1400;
+  bench_run("pbuf_copy_partial/pool/len=64,off=1400", bench_pbuf_copy_partial, &copy_args);
+  bench_run("inet_chksum_pbuf/pool/len=1514", bench_inet_chksum_pbuf, p);
+  pbuf_free(p);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(sizes); i++) {
+    p = bench_pbuf_filled(sizes[i], PBUF_RAM);
+    bench_run(bench_name("inet_chksum_pbuf/ram", "len", sizes[i]), bench_inet_chksum_pbuf, p);
+    pbuf_free(p);
+  }
+}
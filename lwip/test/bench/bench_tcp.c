@@ -0,0 +1,96 @@
+#include "lwip_bench.h"
+
+#include "../unit/tcp/tcp_helper.h"
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+
+#include <string.h>
+
+#define BENCH_TCP_MAX_PCBS 64
+
+/** A received segment that can be fed to tcp_input() over and over again:
+ * tcp_input() moves the payload pointer and converts the header in place */
+struct bench_segment {
+  struct pbuf *p;
+  void *payload;
+  u16_t len;
+  u8_t hdr[IP_HLEN + TCP_HLEN];
+};
+
+struct bench_tcp_args {
+  struct netif *netif;
+  struct bench_segment seg[BENCH_TCP_MAX_PCBS];
+  int num;
+};
+
+static void
+bench_segment_init(struct bench_segment *seg, struct pbuf *p)
+{
+  LWIP_ASSERT("segment must be a single pbuf", (p != NULL) && (p->next == NULL));
+  seg->p = p;
+  seg->payload = p->payload;
+  seg->len = p->len;
+  memcpy(seg->hdr, p->payload, sizeof(seg->hdr));
+}
+
+static void
+bench_tcp_input(void *arg, u32_t iterations)
+{
+  struct bench_tcp_args *a = (struct bench_tcp_args *)arg;
+  u32_t i;
+  int n = 0;
+
+  for (i = 0; i < iterations; i++) {
+    struct bench_segment *seg = &a->seg[n];
+    struct pbuf *p = seg->p;
+    pbuf_ref(p);
+    p->payload = seg->payload;
+    p->len = p->tot_len = seg->len;
+    memcpy(p->payload, seg->hdr, sizeof(seg->hdr));
+    test_tcp_input(p, a->netif);
+    /* round robin, so each lookup has to pass all other pcbs
+       (tcp_input() moves the pcb it found to the front) */
+    if (++n == a->num) {
+      n = 0;
+    }
+  }
+}
+
+void
+tcp_bench(void)
+{
+  static const int counts[] = {1, 8, 32, BENCH_TCP_MAX_PCBS};
+  static struct bench_tcp_args args;
+  struct test_tcp_counters counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct netif *old_netif_list = netif_list;
+  size_t i;
+  int j;
+
+  LWIP_ASSERT("MEMP_NUM_TCP_PCB too small", MEMP_NUM_TCP_PCB >= BENCH_TCP_MAX_PCBS);
+  memset(&counters, 0, sizeof(counters));
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  args.netif = &netif;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(counts); i++) {
+    args.num = counts[i];
+    for (j = 0; j < args.num; j++) {
+      struct tcp_pcb *pcb = test_tcp_new_counters_pcb(&counters);
+      LWIP_ASSERT("tcp_new failed", pcb != NULL);
+      tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip,
+                    TEST_LOCAL_PORT, (u16_t)(TEST_REMOTE_PORT + j));
+      /* a pure ACK of what the pcb has sent, it stays in ESTABLISHED */
+      bench_segment_init(&args.seg[j], tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK));
+    }
+    bench_run(bench_name("tcp_input/ack", "pcbs", args.num), bench_tcp_input, &args);
+    for (j = 0; j < args.num; j++) {
+      pbuf_free(args.seg[j].p);
+    }
+    tcp_remove_all();
+  }
+  netif_list = old_netif_list;
+}
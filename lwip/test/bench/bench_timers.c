@@ -0,0 +1,79 @@
+#include "lwip_bench.h"
+
+#include "lwip/def.h"
+#include "lwip/timeouts.h"
+#include "arch/sys_arch.h"
+
+#define BENCH_TIMERS_MAX   64
+/** Pending timeouts are this far in the future, they never fire */
+#define BENCH_TIMERS_LATER 1000000
+
+static void
+bench_timeout_handler(void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+}
+
+static void
+bench_check_idle(void *arg, u32_t iterations)
+{
+  u32_t i;
+  LWIP_UNUSED_ARG(arg);
+
+  for (i = 0; i < iterations; i++) {
+    sys_check_timeouts();
+  }
+}
+
+static void
+bench_check_fire(void *arg, u32_t iterations)
+{
+  u32_t i;
+  LWIP_UNUSED_ARG(arg);
+
+  for (i = 0; i < iterations; i++) {
+    sys_timeout(0, bench_timeout_handler, NULL);
+    sys_check_timeouts();
+  }
+}
+
+static void
+bench_timeout_untimeout(void *arg, u32_t iterations)
+{
+  u32_t i;
+  LWIP_UNUSED_ARG(arg);
+
+  /* sorted insert behind all pending timeouts, then the search to remove it */
+  for (i = 0; i < iterations; i++) {
+    sys_timeout(2 * BENCH_TIMERS_LATER, bench_timeout_handler, &i);
+    sys_untimeout(bench_timeout_handler, &i);
+  }
+}
+
+void
+timers_bench(void)
+{
+  static const int counts[] = {0, 8, BENCH_TIMERS_MAX};
+  static int ids[BENCH_TIMERS_MAX];
+  struct sys_timeo **list_head = sys_timeouts_get_next_timeout();
+  struct sys_timeo *old_list_head = *list_head;
+  int pending = 0;
+  size_t i;
+
+  /* start with an empty list like the timers unit test does */
+  *list_head = NULL;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(counts); i++) {
+    for (; pending < counts[i]; pending++) {
+      sys_timeout((u32_t)(BENCH_TIMERS_LATER + pending), bench_timeout_handler, &ids[pending]);
+    }
+    bench_run(bench_name("sys_check_timeouts/idle", "pending", pending), bench_check_idle, NULL);
+    bench_run(bench_name("sys_check_timeouts/fire", "pending", pending), bench_check_fire, NULL);
+    bench_run(bench_name("sys_timeout_untimeout", "pending", pending), bench_timeout_untimeout, NULL);
+  }
+
+  for (; pending > 0; pending--) {
+    sys_untimeout(bench_timeout_handler, &ids[pending - 1]);
+  }
+  *list_head = old_list_head;
+}
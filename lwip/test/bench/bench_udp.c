@@ -0,0 +1,160 @@
+#include "lwip_bench.h"
+
+#include "lwip/udp.h"
+#include "lwip/ip.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+
+#include <string.h>
+
+#define BENCH_UDP_MAX_PCBS 64
+#define BENCH_UDP_PORT     5000
+#define BENCH_UDP_DATA_LEN 32
+
+struct bench_datagram {
+  struct pbuf *p;
+  void *payload;
+  u16_t len;
+};
+
+struct bench_udp_args {
+  struct netif *netif;
+  struct bench_datagram dgram[BENCH_UDP_MAX_PCBS];
+  int num;
+};
+
+static struct netif bench_netif;
+static ip4_addr_t bench_local_ip, bench_remote_ip;
+
+static err_t
+bench_netif_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->output = bench_netif_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+bench_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  pbuf_free(p);
+}
+
+/** Build an IPv4/UDP datagram to port, p->payload points to the UDP header
+ * like udp_input() expects it */
+static void
+bench_datagram_init(struct bench_datagram *d, u16_t port)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, IP_HLEN + UDP_HLEN + BENCH_UDP_DATA_LEN, PBUF_POOL);
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  ip_addr_t src, dst;
+
+  LWIP_ASSERT("datagram must be a single pbuf", (p != NULL) && (p->next == NULL));
+  memset(p->payload, 0x5a, p->len);
+  iphdr = (struct ip_hdr *)p->payload;
+  memset(iphdr, 0, IP_HLEN);
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(p->tot_len));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  ip4_addr_copy(iphdr->src, bench_remote_ip);
+  ip4_addr_copy(iphdr->dest, bench_local_ip);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+
+  pbuf_remove_header(p, IP_HLEN);
+  udphdr = (struct udp_hdr *)p->payload;
+  udphdr->src = lwip_htons(BENCH_UDP_PORT);
+  udphdr->dest = lwip_htons(port);
+  udphdr->len = lwip_htons(p->tot_len);
+  udphdr->chksum = 0;
+  ip_addr_copy_from_ip4(src, bench_remote_ip);
+  ip_addr_copy_from_ip4(dst, bench_local_ip);
+  udphdr->chksum = ip_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len, &src, &dst);
+
+  d->p = p;
+  d->payload = p->payload;
+  d->len = p->len;
+}
+
+static void
+bench_udp_input(void *arg, u32_t iterations)
+{
+  struct bench_udp_args *a = (struct bench_udp_args *)arg;
+  u32_t i;
+  int n = 0;
+
+  for (i = 0; i < iterations; i++) {
+    struct bench_datagram *d = &a->dgram[n];
+    struct pbuf *p = d->p;
+    pbuf_ref(p);
+    p->payload = d->payload;
+    p->len = p->tot_len = d->len;
+    /* what ip4_input() sets up before it calls udp_input() */
+    ip_data.current_ip4_header = (struct ip_hdr *)((u8_t *)d->payload - IP_HLEN);
+    ip_data.current_ip_header_tot_len = IP_HLEN;
+    ip_data.current_netif = a->netif;
+    ip_data.current_input_netif = a->netif;
+    ip_addr_copy_from_ip4(*ip_current_src_addr(), bench_remote_ip);
+    ip_addr_copy_from_ip4(*ip_current_dest_addr(), bench_local_ip);
+    udp_input(p, a->netif);
+    /* round robin, so each lookup has to pass all other pcbs
+       (udp_input() moves the pcb it found to the front) */
+    if (++n == a->num) {
+      n = 0;
+    }
+  }
+  memset(&ip_data, 0, sizeof(ip_data));
+}
+
+void
+udp_bench(void)
+{
+  static const int counts[] = {1, 8, 32, BENCH_UDP_MAX_PCBS};
+  static struct bench_udp_args args;
+  struct udp_pcb *pcbs[BENCH_UDP_MAX_PCBS];
+  ip4_addr_t netmask, gw;
+  size_t i;
+  int j;
+
+  LWIP_ASSERT("MEMP_NUM_UDP_PCB too small", MEMP_NUM_UDP_PCB >= BENCH_UDP_MAX_PCBS);
+  IP4_ADDR(&bench_local_ip, 192, 168, 2, 1);
+  IP4_ADDR(&bench_remote_ip, 192, 168, 2, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 2, 254);
+  netif_add(&bench_netif, &bench_local_ip, &netmask, &gw, NULL, bench_netif_init, NULL);
+  netif_set_up(&bench_netif);
+  args.netif = &bench_netif;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(counts); i++) {
+    args.num = counts[i];
+    for (j = 0; j < args.num; j++) {
+      pcbs[j] = udp_new();
+      LWIP_ASSERT("udp_new failed", pcbs[j] != NULL);
+      udp_bind(pcbs[j], IP4_ADDR_ANY, (u16_t)(BENCH_UDP_PORT + 1 + j));
+      udp_recv(pcbs[j], bench_udp_recv, NULL);
+      bench_datagram_init(&args.dgram[j], (u16_t)(BENCH_UDP_PORT + 1 + j));
+    }
+    bench_run(bench_name("udp_input", "pcbs", args.num), bench_udp_input, &args);
+    for (j = 0; j < args.num; j++) {
+      pbuf_free(args.dgram[j].p);
+      udp_remove(pcbs[j]);
+    }
+  }
+  netif_remove(&bench_netif);
+}
@@ -0,0 +1,226 @@
+/*
+ * Micro benchmarks of lwIP core functions on the host.
+ *
+ * Usage: lwip_bench [-f filter] [-b baseline] [-s file] [-t percent]
+ *
+ *  -f  only run cases whose name contains filter
+ *  -b  compare against a baseline written by -s, exit with 1 when a case
+ *      got slower than the baseline by more than the threshold
+ *  -s  save the results as new baseline
+ *  -t  regression threshold in percent (default 10)
+ *
+ * Results are ns/op of the best of BENCH_RUNS runs, which is the most stable
+ * number on a machine that is doing other things as well.
+ */
+
+#include "lwip_bench.h"
+
+#include "lwip/init.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** A run has to take at least this long to count */
+#define BENCH_MIN_NS    20000000UL
+/** Number of measured runs per case, the fastest one is reported */
+#define BENCH_RUNS      5
+#define BENCH_MAX_CASES 128
+#define BENCH_NAME_LEN  64
+
+struct bench_result {
+  char name[BENCH_NAME_LEN];
+  double ns_per_op;
+};
+
+static struct bench_result results[BENCH_MAX_CASES];
+static int num_results;
+static struct bench_result baseline[BENCH_MAX_CASES];
+static int num_baseline;
+static const char *filter;
+static double threshold = 10.0;
+static int regressions;
+
+/* This function is used for LWIP_RAND by some ports... */
+unsigned int
+lwip_port_rand(void)
+{
+  return (unsigned int)rand();
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000UL + (u64_t)ts.tv_nsec;
+}
+
+static u64_t
+bench_time(bench_fn *fn, void *arg, u32_t iterations)
+{
+  u64_t start = bench_now_ns();
+  fn(arg, iterations);
+  return bench_now_ns() - start;
+}
+
+static const struct bench_result *
+bench_find(const struct bench_result *list, int num, const char *name)
+{
+  int i;
+  for (i = 0; i < num; i++) {
+    if (strcmp(list[i].name, name) == 0) {
+      return &list[i];
+    }
+  }
+  return NULL;
+}
+
+const char *
+bench_name(const char *name, const char *param, int value)
+{
+  static char buf[BENCH_NAME_LEN];
+  snprintf(buf, sizeof(buf), "%s/%s=%d", name, param, value);
+  return buf;
+}
+
+void
+bench_run(const char *name, bench_fn *fn, void *arg)
+{
+  u32_t iterations = 1;
+  u64_t ns;
+  double best = 0;
+  int i;
+  const struct bench_result *base;
+  struct bench_result *res;
+
+  if ((filter != NULL) && (strstr(name, filter) == NULL)) {
+    return;
+  }
+  LWIP_ASSERT("too many benchmark cases", num_results < BENCH_MAX_CASES);
+
+  /* find an iteration count that runs for BENCH_MIN_NS (this warms up caches, too) */
+  while ((ns = bench_time(fn, arg, iterations)) < BENCH_MIN_NS) {
+    if (ns < BENCH_MIN_NS / 16) {
+      iterations *= 16;
+    } else {
+      iterations = (u32_t)((double)iterations * BENCH_MIN_NS * 1.1 / (double)ns) + 1;
+    }
+  }
+  for (i = 0; i < BENCH_RUNS; i++) {
+    double ns_per_op = (double)bench_time(fn, arg, iterations) / iterations;
+    if ((i == 0) || (ns_per_op < best)) {
+      best = ns_per_op;
+    }
+  }
+
+  res = &results[num_results++];
+  snprintf(res->name, sizeof(res->name), "%s", name);
+  res->ns_per_op = best;
+
+  printf("%-40s %10.1f ns/op", name, best);
+  base = bench_find(baseline, num_baseline, name);
+  if (base != NULL) {
+    double change = (best - base->ns_per_op) * 100.0 / base->ns_per_op;
+    printf("  %+6.1f%%", change);
+    if (change > threshold) {
+      printf("  REGRESSION (baseline %.1f)", base->ns_per_op);
+      regressions++;
+    }
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+static int
+bench_load_baseline(const char *file)
+{
+  FILE *f = fopen(file, "r");
+  char line[BENCH_NAME_LEN + 32];
+
+  if (f == NULL) {
+    perror(file);
+    return -1;
+  }
+  while ((fgets(line, sizeof(line), f) != NULL) && (num_baseline < BENCH_MAX_CASES)) {
+    struct bench_result *b = &baseline[num_baseline];
+    if ((line[0] != '#') && (sscanf(line, "%63s %lf", b->name, &b->ns_per_op) == 2) &&
+        (b->ns_per_op > 0)) {
+      num_baseline++;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int
+bench_save(const char *file)
+{
+  FILE *f = fopen(file, "w");
+  int i;
+
+  if (f == NULL) {
+    perror(file);
+    return -1;
+  }
+  fprintf(f, "# lwip_bench baseline: case ns/op\n");
+  for (i = 0; i < num_results; i++) {
+    fprintf(f, "%s %.1f\n", results[i].name, results[i].ns_per_op);
+  }
+  fclose(f);
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  const char *save_file = NULL;
+  int opt;
+  size_t i;
+  bench_group_fn *groups[] = {
+    pbuf_bench,
+    etharp_bench,
+    tcp_bench,
+    udp_bench,
+    timers_bench
+  };
+
+  while ((opt = getopt(argc, argv, "f:b:s:t:")) != -1) {
+    switch (opt) {
+      case 'f':
+        filter = optarg;
+        break;
+      case 'b':
+        if (bench_load_baseline(optarg) != 0) {
+          return EXIT_FAILURE;
+        }
+        break;
+      case 's':
+        save_file = optarg;
+        break;
+      case 't':
+        threshold = atof(optarg);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f filter] [-b baseline] [-s file] [-t percent]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  lwip_init();
+
+  for (i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+    groups[i]();
+  }
+
+  if ((save_file != NULL) && (bench_save(save_file) != 0)) {
+    return EXIT_FAILURE;
+  }
+  if (regressions > 0) {
+    printf("%d case(s) slower than the baseline by more than %.1f%%\n", regressions, threshold);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
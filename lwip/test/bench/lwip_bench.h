@@ -0,0 +1,30 @@
+#ifndef LWIP_HDR_LWIP_BENCH_H
+#define LWIP_HDR_LWIP_BENCH_H
+
+/* Common header file for the lwIP micro benchmarks. They are built with the
+ * unit test lwipopts.h and port (test/unit/arch) and can use the unit test
+ * helpers, see contrib/ports/unix/bench. */
+
+#include "lwip/arch.h"
+
+/** Runs the operation under test 'iterations' times */
+typedef void (bench_fn)(void *arg, u32_t iterations);
+
+/** Time fn and report the result as ns/op under name.
+ * fn is called with growing iteration counts until one call takes long
+ * enough to be measured, the best of a few such calls is reported. */
+void bench_run(const char *name, bench_fn *fn, void *arg);
+
+/** Name of a case with a parameter, e.g. "tcp_input/pcbs=8" (static buffer) */
+const char *bench_name(const char *name, const char *param, int value);
+
+/** A group of benchmarks, sets up its state and calls bench_run() */
+typedef void (bench_group_fn)(void);
+
+void pbuf_bench(void);
+void etharp_bench(void);
+void tcp_bench(void);
+void udp_bench(void);
+void timers_bench(void);
+
+#endif /* LWIP_HDR_LWIP_BENCH_H */
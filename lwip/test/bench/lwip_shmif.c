@@ -0,0 +1,392 @@
+/*
+ * Throughput between two lwIP processes over the shared memory netif.
+ *
+ * Usage: lwip_shmif [-f filter] [-n frames] [-b bytes]
+ *
+ *  -f  only run cases whose name contains filter
+ *  -n  datagrams per UDP case (default 1000000)
+ *  -b  bytes per TCP case (default 200000000)
+ *
+ * Every case forks a receiver on port 1 and a sender on port 0 of a fresh
+ * shared file, each with its own stack. The receiver counts what arrives
+ * and reports the rate from its first to its last frame, so this measures
+ * the whole path: sender stack, ring, receiver stack.
+ */
+
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/tcp.h"
+#include "lwip/etharp.h"
+#include "lwip/timeouts.h"
+#include "netif/ethernet.h"
+#include "netif/shmif.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+
+#define SHM_UDP_PORT 9
+#define SHM_END_PORT 10
+#define SHM_TCP_PORT 5001
+/* the receiver gives up when nothing arrived for that long */
+#define SHM_IDLE_MS  3000
+
+struct shm_case {
+  const char *name;
+  int tcp;
+  u16_t len;
+};
+
+static const struct shm_case cases[] = {
+  { "udp_18",   0, 18 },    /* minimum Ethernet frame */
+  { "udp_512",  0, 512 },
+  { "udp_1472", 0, 1472 },  /* full frame */
+  { "tcp",      1, 0 },
+};
+
+/* what the receiver reports back through the pipe */
+struct shm_result {
+  u64_t frames;
+  u64_t bytes;
+  u64_t ns;
+};
+
+static struct netif shm_netif;
+static struct shm_result result;
+static u64_t first_ns;
+static int done;
+static u64_t tcp_acked;
+static u8_t pattern[TCP_MSS];
+
+unsigned int
+lwip_port_rand(void)
+{
+  return (unsigned int)rand();
+}
+
+static u64_t
+shm_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000U + (u64_t)ts.tv_nsec;
+}
+
+/* the unit test port has a settable clock, run it in real time */
+static void
+shm_timers(void)
+{
+  lwip_sys_now = (u32_t)(shm_now_ns() / 1000000U);
+  sys_check_timeouts();
+}
+
+static void
+shm_count(u32_t bytes)
+{
+  u64_t now = shm_now_ns();
+
+  if (first_ns == 0) {
+    first_ns = now;
+  }
+  result.frames++;
+  result.bytes += bytes;
+  result.ns = now - first_ns;
+}
+
+static void
+shm_netif_add(u32_t port)
+{
+  ip4_addr_t ip, mask, gw, peer;
+  struct eth_addr peer_mac = {{0x02, 0x12, 0x34, 0x56, 0x79, 0x00}};
+  char buf[4];
+
+  snprintf(buf, sizeof(buf), "%u", (unsigned)port);
+  setenv("SHMIF_PORT", buf, 1);
+  IP4_ADDR(&ip, 10, 0, 3, port + 1);
+  IP4_ADDR(&peer, 10, 0, 3, 2 - port);
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  ip4_addr_set_zero(&gw);
+  netif_add(&shm_netif, &ip, &mask, &gw, NULL, shmif_init, ethernet_input);
+  netif_set_default(&shm_netif);
+  netif_set_up(&shm_netif);
+  /* no ARP exchange in the measurement */
+  peer_mac.addr[5] = (u8_t)(1 - port);
+  etharp_add_static_entry(&peer, &peer_mac);
+}
+
+/*-------------------------------------------------------------------------*/
+/* receiver */
+
+static void
+shm_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  if (pcb->local_port == SHM_END_PORT) {
+    done = 1;
+  } else {
+    shm_count(p->tot_len);
+  }
+  pbuf_free(p);
+}
+
+static err_t
+shm_tcp_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    tcp_close(pcb);
+    done = 1;
+    return ERR_OK;
+  }
+  shm_count(p->tot_len);
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+shm_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  tcp_recv(pcb, shm_tcp_recv);
+  return ERR_OK;
+}
+
+static void
+shm_receiver(const struct shm_case *sc, int ready_fd, int result_fd)
+{
+  u64_t idle_since;
+
+  shm_netif_add(1);
+  if (sc->tcp) {
+    struct tcp_pcb *pcb = tcp_new();
+    tcp_bind(pcb, IP_ADDR_ANY, SHM_TCP_PORT);
+    pcb = tcp_listen(pcb);
+    tcp_accept(pcb, shm_tcp_accept);
+  } else {
+    struct udp_pcb *pcb = udp_new();
+    udp_bind(pcb, IP_ADDR_ANY, SHM_UDP_PORT);
+    udp_recv(pcb, shm_udp_recv, NULL);
+    pcb = udp_new();
+    udp_bind(pcb, IP_ADDR_ANY, SHM_END_PORT);
+    udp_recv(pcb, shm_udp_recv, NULL);
+  }
+  if (write(ready_fd, "r", 1) != 1) {
+    exit(EXIT_FAILURE);
+  }
+
+  idle_since = shm_now_ns();
+  while (!done) {
+    if (shmif_wait(&shm_netif, 100) && shmif_poll(&shm_netif) > 0) {
+      idle_since = shm_now_ns();
+    } else if (shm_now_ns() - idle_since > (u64_t)SHM_IDLE_MS * 1000000U) {
+      break;
+    }
+    shm_timers();
+  }
+  if (write(result_fd, &result, sizeof(result)) != sizeof(result)) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
+
+/*-------------------------------------------------------------------------*/
+/* sender */
+
+static void
+shm_udp_send(struct udp_pcb *pcb, u16_t port, u16_t len)
+{
+  ip_addr_t dst;
+  struct pbuf *p;
+  err_t err;
+
+  IP_ADDR4(&dst, 10, 0, 3, 2);
+  do {
+    p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    LWIP_ASSERT("pbuf_alloc failed", p != NULL);
+    memset(p->payload, 'x', len);
+    /* ERR_MEM means the ring is full, the receiver is behind. The headers
+       are in the pbuf by then, so it can't be sent again. */
+    err = udp_sendto(pcb, p, &dst, port);
+    pbuf_free(p);
+    if (err == ERR_MEM) {
+      sched_yield();
+    }
+  } while (err == ERR_MEM);
+}
+
+static err_t
+shm_tcp_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  tcp_acked += len;
+  return ERR_OK;
+}
+
+static err_t
+shm_tcp_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(err);
+  *(int *)arg = 1;
+  return ERR_OK;
+}
+
+static void
+shm_sender(const struct shm_case *sc, u32_t frames, u64_t bytes)
+{
+  shm_netif_add(0);
+  if (sc->tcp) {
+    struct tcp_pcb *pcb = tcp_new();
+    ip_addr_t dst;
+    int connected = 0;
+    u64_t queued = 0;
+
+    IP_ADDR4(&dst, 10, 0, 3, 2);
+    tcp_arg(pcb, &connected);
+    tcp_sent(pcb, shm_tcp_sent);
+    tcp_connect(pcb, &dst, SHM_TCP_PORT, shm_tcp_connected);
+    while (tcp_acked < bytes) {
+      /* fill the send buffer, then wait for acks */
+      while (connected && queued < bytes) {
+        u16_t len = (u16_t)LWIP_MIN(LWIP_MIN(tcp_sndbuf(pcb), sizeof(pattern)), bytes - queued);
+
+        if (len == 0 || tcp_write(pcb, pattern, len, 0) != ERR_OK) {
+          break;
+        }
+        queued += len;
+      }
+      tcp_output(pcb);
+      if (shmif_wait(&shm_netif, 1)) {
+        shmif_poll(&shm_netif);
+      }
+      shm_timers();
+    }
+    tcp_close(pcb);
+    /* let the FIN go out */
+    while (shmif_wait(&shm_netif, 50)) {
+      shmif_poll(&shm_netif);
+      shm_timers();
+    }
+  } else {
+    struct udp_pcb *pcb = udp_new();
+    u32_t i;
+
+    for (i = 0; i < frames; i++) {
+      shm_udp_send(pcb, SHM_UDP_PORT, sc->len);
+    }
+    shm_udp_send(pcb, SHM_END_PORT, 1);
+  }
+  exit(EXIT_SUCCESS);
+}
+
+/*-------------------------------------------------------------------------*/
+
+static int
+shm_run_case(const struct shm_case *sc, const char *path, u32_t frames, u64_t bytes)
+{
+  int ready[2], res[2];
+  pid_t receiver, sender;
+  struct shm_result r;
+  char c;
+  double secs;
+  int ok;
+
+  /* a fresh file per case, nothing left in the rings */
+  unlink(path);
+  setenv("SHMIF", path, 1);
+  if (pipe(ready) != 0 || pipe(res) != 0) {
+    perror("pipe");
+    return -1;
+  }
+  receiver = fork();
+  if (receiver == 0) {
+    shm_receiver(sc, ready[1], res[1]);
+  }
+  if (read(ready[0], &c, 1) != 1) {
+    printf("%-12s FAILED, receiver did not start\n", sc->name);
+    return -1;
+  }
+  sender = fork();
+  if (sender == 0) {
+    shm_sender(sc, frames, bytes);
+  }
+  ok = (read(res[0], &r, sizeof(r)) == sizeof(r));
+  waitpid(sender, NULL, 0);
+  waitpid(receiver, NULL, 0);
+  close(ready[0]);
+  close(ready[1]);
+  close(res[0]);
+  close(res[1]);
+
+  if (!ok || r.frames == 0) {
+    printf("%-12s FAILED, nothing received\n", sc->name);
+    return -1;
+  }
+  secs = (double)(r.ns ? r.ns : 1) / 1e9;
+  printf("%-12s %12.0f frames/s %10.1f Mbit/s %12lu frames", sc->name,
+         (double)r.frames / secs, (double)r.bytes * 8 / secs / 1e6, (unsigned long)r.frames);
+  if (!sc->tcp && r.frames < frames) {
+    printf(" (%lu lost)", (unsigned long)(frames - r.frames));
+  }
+  printf("\n");
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  const char *filter = NULL;
+  u32_t frames = 1000000;
+  u64_t bytes = 200000000;
+  char path[64];
+  size_t i;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:n:b:")) != -1) {
+    switch (opt) {
+      case 'f':
+        filter = optarg;
+        break;
+      case 'n':
+        frames = (u32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'b':
+        bytes = (u64_t)strtoull(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f filter] [-n frames] [-b bytes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  /* like the unit tests: no thread, but a valid mbox for tcpip_try_callback();
+     the children inherit this state */
+  tcpip_init(NULL, NULL);
+  memset(pattern, 'x', sizeof(pattern));
+  snprintf(path, sizeof(path), "%s/lwip_shmif.%u",
+           access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp", (unsigned)getpid());
+  printf("# %s, payload Mbit/s, receiver side\n", path);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(cases); i++) {
+    if ((filter == NULL) || (strstr(cases[i].name, filter) != NULL)) {
+      fflush(stdout);
+      if (shm_run_case(&cases[i], path, frames, bytes) != 0) {
+        failed++;
+      }
+    }
+  }
+  unlink(path);
+  return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,403 @@
+/*
+ * TCP performance scenarios over a simulated link, on a virtual clock.
+ *
+ * Usage: lwip_sim [-f filter] [-s seed]
+ *
+ *  -f  only run scenarios whose name contains filter
+ *  -s  seed of the link's loss, jitter and reordering (default 1)
+ *
+ * A client and a server, each on its own end of a sim_link, transfer a
+ * fixed amount of data. Goodput, retransmissions and RTT are taken from the
+ * packets on the link and are in simulated time, so a run gives the same
+ * numbers on every machine and can be diffed against an earlier one.
+ */
+
+#include "sim_link.h"
+
+#include "lwip/tcpip.h"
+#include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_PORT          5001
+/** Give up on a scenario after this much simulated time */
+#define SIM_TIMEOUT_US    ((u64_t)600 * 1000000)
+/** Scenarios start on this grid, so lwIP's cyclic timers always have the same phase */
+#define SIM_ALIGN_US      ((u64_t)60 * 1000000)
+/** Data segments on the link that wait for their ACK, for RTT samples */
+#define SIM_RTT_RING      1024
+
+struct sim_scenario {
+  const char *name;
+  u32_t bytes;
+  /* client to server */
+  struct sim_link_params data;
+  /* server to client */
+  struct sim_link_params ack;
+};
+
+/* bandwidth kbit/s, delay us, jitter us, queue bytes, loss ppm, reorder ppm, reorder us, mtu */
+static const struct sim_scenario scenarios[] = {
+  {"lan", 4000000,
+   {100000, 100, 0, 65536, 0, 0, 0, 1500},
+   {100000, 100, 0, 65536, 0, 0, 0, 1500}},
+  {"dsl", 2000000,
+   {8000, 10000, 0, 65536, 0, 0, 0, 1500},
+   {1000, 10000, 0, 16384, 0, 0, 0, 1500}},
+  {"shallow_queue", 1000000,
+   {10000, 20000, 0, 4000, 0, 0, 0, 1500},
+   {10000, 20000, 0, 4000, 0, 0, 0, 1500}},
+  {"wan_loss_1pct", 1000000,
+   {10000, 40000, 0, 65536, 10000, 0, 0, 1500},
+   {10000, 40000, 0, 65536, 10000, 0, 0, 1500}},
+  {"jitter_reorder", 1000000,
+   {10000, 20000, 5000, 65536, 0, 10000, 10000, 1500},
+   {10000, 20000, 5000, 65536, 0, 10000, 10000, 1500}},
+  {"small_mtu", 500000,
+   {2000, 50000, 0, 65536, 0, 0, 0, 576},
+   {2000, 50000, 0, 65536, 0, 0, 0, 576}},
+  {"satellite", 500000,
+   {2000, 300000, 0, 131072, 0, 0, 0, 1500},
+   {2000, 300000, 0, 131072, 0, 0, 0, 1500}}
+};
+
+struct sim_rtt_sample {
+  u32_t end;
+  u64_t sent_us;
+  int valid;
+};
+
+/** The transfer of the running scenario */
+struct sim_flow {
+  u32_t bytes;
+  u32_t written;
+  u32_t received;
+  u64_t start_us;
+  u64_t end_us;
+  int failed;
+  struct tcp_pcb *listener;
+  struct tcp_pcb *client;
+  struct tcp_pcb *server;
+  /* taken from the link */
+  u32_t segments;
+  u32_t retransmissions;
+  u32_t highest_end;
+  int have_highest;
+  struct sim_rtt_sample ring[SIM_RTT_RING];
+  int ring_head;
+  int ring_num;
+  u32_t *rtt_us;
+  size_t rtt_num;
+  size_t rtt_max;
+};
+
+static struct sim_flow flow;
+static u8_t pattern[TCP_SND_BUF];
+
+/* This function is used for LWIP_RAND by some ports... */
+unsigned int
+lwip_port_rand(void)
+{
+  return (unsigned int)rand();
+}
+
+static void
+sim_rtt_add(u32_t rtt)
+{
+  if (flow.rtt_num == flow.rtt_max) {
+    flow.rtt_max = (flow.rtt_max != 0) ? 2 * flow.rtt_max : 1024;
+    flow.rtt_us = (u32_t *)realloc(flow.rtt_us, flow.rtt_max * sizeof(u32_t));
+    LWIP_ASSERT("out of memory", flow.rtt_us != NULL);
+  }
+  flow.rtt_us[flow.rtt_num++] = rtt;
+}
+
+/* A data segment left the client. Retransmitted data gives no RTT sample (Karn). */
+static void
+sim_rtt_sent(u32_t seq, u32_t end)
+{
+  int i;
+
+  flow.segments++;
+  if (flow.have_highest && TCP_SEQ_LT(seq, flow.highest_end)) {
+    flow.retransmissions++;
+    for (i = 0; i < flow.ring_num; i++) {
+      struct sim_rtt_sample *s = &flow.ring[(flow.ring_head + i) % SIM_RTT_RING];
+      if (TCP_SEQ_GT(s->end, seq)) {
+        s->valid = 0;
+      }
+    }
+    if (TCP_SEQ_LEQ(end, flow.highest_end)) {
+      return;
+    }
+  }
+  if (flow.ring_num == SIM_RTT_RING) {
+    flow.ring_head = (flow.ring_head + 1) % SIM_RTT_RING;
+    flow.ring_num--;
+  }
+  flow.ring[(flow.ring_head + flow.ring_num) % SIM_RTT_RING].end = end;
+  flow.ring[(flow.ring_head + flow.ring_num) % SIM_RTT_RING].sent_us = sim_now_us();
+  flow.ring[(flow.ring_head + flow.ring_num) % SIM_RTT_RING].valid =
+    !flow.have_highest || !TCP_SEQ_LT(seq, flow.highest_end);
+  flow.ring_num++;
+  flow.highest_end = end;
+  flow.have_highest = 1;
+}
+
+/* An ACK reached the client */
+static void
+sim_rtt_acked(u32_t ackno)
+{
+  while (flow.ring_num > 0) {
+    struct sim_rtt_sample *s = &flow.ring[flow.ring_head];
+    if (TCP_SEQ_GT(s->end, ackno)) {
+      break;
+    }
+    if (s->valid) {
+      sim_rtt_add((u32_t)(sim_now_us() - s->sent_us));
+    }
+    flow.ring_head = (flow.ring_head + 1) % SIM_RTT_RING;
+    flow.ring_num--;
+  }
+}
+
+static void
+sim_tap(struct sim_link *link, int dir, enum sim_tap_event event, struct pbuf *p)
+{
+  u32_t buf[(IP_HLEN + TCP_HLEN) / 4];
+  const struct ip_hdr *iphdr = (const struct ip_hdr *)buf;
+  const struct tcp_hdr *tcphdr = (const struct tcp_hdr *)(buf + IP_HLEN / 4);
+  u16_t datalen;
+  LWIP_UNUSED_ARG(link);
+
+  if ((pbuf_copy_partial(p, buf, sizeof(buf), 0) != sizeof(buf)) ||
+      (IPH_PROTO(iphdr) != IP_PROTO_TCP) || (IPH_HL_BYTES(iphdr) != IP_HLEN)) {
+    return;
+  }
+  datalen = (u16_t)(lwip_ntohs(IPH_LEN(iphdr)) - IP_HLEN - TCPH_HDRLEN_BYTES(tcphdr));
+  if ((dir == 0) && (event == SIM_TAP_TX) && (datalen > 0)) {
+    u32_t seq = lwip_ntohl(tcphdr->seqno);
+    sim_rtt_sent(seq, seq + datalen);
+  } else if ((dir == 1) && (event == SIM_TAP_RX) && (TCPH_FLAGS(tcphdr) & TCP_ACK)) {
+    sim_rtt_acked(lwip_ntohl(tcphdr->ackno));
+  }
+}
+
+static void
+sim_client_send(struct tcp_pcb *pcb)
+{
+  while (flow.written < flow.bytes) {
+    u32_t len = LWIP_MIN(flow.bytes - flow.written, tcp_sndbuf(pcb));
+    if ((len == 0) || (tcp_write(pcb, pattern, (u16_t)len, 0) != ERR_OK)) {
+      break;
+    }
+    flow.written += len;
+  }
+  tcp_output(pcb);
+}
+
+static err_t
+sim_client_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(len);
+  sim_client_send(pcb);
+  return ERR_OK;
+}
+
+static err_t
+sim_client_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  flow.start_us = sim_now_us();
+  sim_client_send(pcb);
+  return ERR_OK;
+}
+
+static void
+sim_client_err(void *arg, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  flow.client = NULL;
+  flow.failed = 1;
+}
+
+static err_t
+sim_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    return ERR_OK;
+  }
+  flow.received += p->tot_len;
+  if ((flow.received >= flow.bytes) && (flow.end_us == 0)) {
+    flow.end_us = sim_now_us();
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static void
+sim_server_err(void *arg, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  flow.server = NULL;
+  flow.failed = 1;
+}
+
+static err_t
+sim_server_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  flow.server = pcb;
+  tcp_recv(pcb, sim_server_recv);
+  tcp_err(pcb, sim_server_err);
+  return ERR_OK;
+}
+
+static int
+sim_flow_done(void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+  return (flow.end_us != 0) || flow.failed;
+}
+
+static int
+sim_cmp_u32(const void *a, const void *b)
+{
+  u32_t x = *(const u32_t *)a;
+  u32_t y = *(const u32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static double
+sim_rtt_ms(double q)
+{
+  size_t i = (size_t)(q * (double)(flow.rtt_num - 1) + 0.5);
+  return flow.rtt_us[i] / 1000.0;
+}
+
+static int
+sim_run_scenario(const struct sim_scenario *sc, u32_t seed)
+{
+  static struct sim_link link;
+  ip4_addr_t client_ip, server_ip;
+  u32_t *rtt_us = flow.rtt_us;
+  size_t rtt_max = flow.rtt_max;
+  u32_t lost, drops;
+  double secs;
+
+  /* idle until the grid, this lets the tcp timer of the last scenario stop */
+  sim_run((sim_now_us() / SIM_ALIGN_US + 2) * SIM_ALIGN_US, NULL, NULL);
+  sim_seed(seed);
+  srand(seed);
+
+  memset(&flow, 0, sizeof(flow));
+  flow.rtt_us = rtt_us;
+  flow.rtt_max = rtt_max;
+  flow.bytes = sc->bytes;
+  IP4_ADDR(&client_ip, 10, 0, 0, 1);
+  IP4_ADDR(&server_ip, 10, 0, 0, 2);
+  sim_link_add(&link, &sc->data, &sc->ack, &client_ip, &server_ip);
+  link.tap = sim_tap;
+
+  flow.listener = tcp_new();
+  LWIP_ASSERT("tcp_new failed", flow.listener != NULL);
+  tcp_bind_netif(flow.listener, &link.netif[1]);
+  tcp_bind(flow.listener, IP_ADDR_ANY, SIM_PORT);
+  flow.listener = tcp_listen(flow.listener);
+  tcp_accept(flow.listener, sim_server_accept);
+
+  flow.client = tcp_new();
+  LWIP_ASSERT("tcp_new failed", flow.client != NULL);
+  tcp_bind_netif(flow.client, &link.netif[0]);
+  tcp_nagle_disable(flow.client);
+  tcp_sent(flow.client, sim_client_sent);
+  tcp_err(flow.client, sim_client_err);
+  {
+    ip_addr_t dst;
+    ip_addr_copy_from_ip4(dst, server_ip);
+    tcp_connect(flow.client, &dst, SIM_PORT, sim_client_connected);
+  }
+
+  sim_run(sim_now_us() + SIM_TIMEOUT_US, sim_flow_done, NULL);
+
+  if (flow.client != NULL) {
+    tcp_abort(flow.client);
+  }
+  if (flow.server != NULL) {
+    tcp_abort(flow.server);
+  }
+  tcp_close(flow.listener);
+  lost = link.dir[0].stats.lost + link.dir[1].stats.lost;
+  drops = link.dir[0].stats.queue_drops + link.dir[1].stats.queue_drops;
+  sim_link_remove(&link);
+
+  if (flow.end_us == 0) {
+    printf("%-16s FAILED after %u of %u bytes\n", sc->name, (unsigned)flow.received, (unsigned)flow.bytes);
+    return -1;
+  }
+  secs = (double)(flow.end_us - flow.start_us) / 1e6;
+  printf("%-16s %10.1f kbit/s %9.3f s %7u segs %6u rexmit %5u lost %5u qdrop",
+         sc->name, flow.received * 8 / secs / 1000, secs, (unsigned)flow.segments,
+         (unsigned)flow.retransmissions, (unsigned)lost, (unsigned)drops);
+  if (flow.rtt_num > 0) {
+    qsort(flow.rtt_us, flow.rtt_num, sizeof(u32_t), sim_cmp_u32);
+    printf("  rtt ms %.2f/%.2f/%.2f/%.2f", sim_rtt_ms(0), sim_rtt_ms(0.5), sim_rtt_ms(0.99), sim_rtt_ms(1));
+  }
+  printf("\n");
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  const char *filter = NULL;
+  u32_t seed = 1;
+  int failed = 0;
+  int opt;
+  size_t i;
+
+  while ((opt = getopt(argc, argv, "f:s:")) != -1) {
+    switch (opt) {
+      case 'f':
+        filter = optarg;
+        break;
+      case 's':
+        seed = (u32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-f filter] [-s seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  /* like the unit tests: no thread, but a valid mbox for tcpip_try_callback() */
+  tcpip_init(NULL, NULL);
+  memset(pattern, 'x', sizeof(pattern));
+  printf("# seed %u, TCP_MSS %d, TCP_WND %d, TCP_SND_BUF %d, rtt min/p50/p99/max\n",
+         (unsigned)seed, TCP_MSS, TCP_WND, TCP_SND_BUF);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(scenarios); i++) {
+    if ((filter == NULL) || (strstr(scenarios[i].name, filter) != NULL)) {
+      /* per scenario, so a filtered run gives the same numbers */
+      if (sim_run_scenario(&scenarios[i], seed + (u32_t)i) != 0) {
+        failed++;
+      }
+    }
+  }
+  free(flow.rtt_us);
+  return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,233 @@
+#include "sim_link.h"
+
+#include "lwip/ip.h"
+#include "lwip/timeouts.h"
+#include "arch/sys_arch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** A packet on its way */
+struct sim_pkt {
+  struct sim_pkt *next;
+  struct sim_dir *dir;
+  struct pbuf *p;
+  u64_t arrive_us;
+};
+
+/** All packets in flight, ordered by arrival */
+static struct sim_pkt *in_flight;
+static u64_t now_us;
+static u32_t rand_state = 1;
+
+void
+sim_seed(u32_t seed)
+{
+  rand_state = (seed != 0) ? seed : 1;
+}
+
+/* xorshift32: the same sequence on every host */
+u32_t
+sim_rand(void)
+{
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state;
+}
+
+u64_t
+sim_now_us(void)
+{
+  return now_us;
+}
+
+static void
+sim_set_now(u64_t t)
+{
+  now_us = t;
+  /* sys_now() of the unit test port */
+  lwip_sys_now = (u32_t)(t / 1000);
+}
+
+static int
+sim_chance(u32_t ppm)
+{
+  return (ppm != 0) && ((sim_rand() % 1000000) < ppm);
+}
+
+static void
+sim_enqueue(struct sim_pkt *pkt)
+{
+  struct sim_pkt **pp = &in_flight;
+  /* behind all packets arriving at the same time */
+  while ((*pp != NULL) && ((*pp)->arrive_us <= pkt->arrive_us)) {
+    pp = &(*pp)->next;
+  }
+  pkt->next = *pp;
+  *pp = pkt;
+}
+
+static err_t
+sim_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  struct sim_dir *dir = (struct sim_dir *)netif->state;
+  const struct sim_link_params *params = &dir->params;
+  struct sim_pkt *pkt;
+  u64_t start, arrive;
+  LWIP_UNUSED_ARG(ipaddr);
+
+  dir->stats.packets++;
+  dir->stats.bytes += p->tot_len;
+  if (dir->link->tap != NULL) {
+    dir->link->tap(dir->link, dir->index, SIM_TAP_TX, p);
+  }
+
+  start = LWIP_MAX(now_us, dir->busy_until_us);
+  if (params->bandwidth_kbps != 0) {
+    if (params->queue_bytes != 0) {
+      u64_t backlog = (start - now_us) * params->bandwidth_kbps / 8000;
+      if (backlog + p->tot_len > params->queue_bytes) {
+        dir->stats.queue_drops++;
+        return ERR_OK;
+      }
+    }
+    dir->busy_until_us = start + (u64_t)p->tot_len * 8000 / params->bandwidth_kbps;
+  } else {
+    dir->busy_until_us = start;
+  }
+  /* lost on the wire, after it took its time on the link */
+  if (sim_chance(params->loss_ppm)) {
+    dir->stats.lost++;
+    return ERR_OK;
+  }
+
+  arrive = dir->busy_until_us + params->delay_us;
+  if (params->jitter_us != 0) {
+    arrive += sim_rand() % (params->jitter_us + 1);
+  }
+  if (sim_chance(params->reorder_ppm)) {
+    arrive += params->reorder_us;
+    dir->stats.reordered++;
+  } else {
+    arrive = LWIP_MAX(arrive, dir->last_arrival_us);
+    dir->last_arrival_us = arrive;
+  }
+
+  pkt = (struct sim_pkt *)malloc(sizeof(struct sim_pkt));
+  if (pkt == NULL) {
+    dir->stats.queue_drops++;
+    return ERR_MEM;
+  }
+  /* lwIP keeps the original for retransmission */
+  pkt->p = pbuf_clone(PBUF_RAW, PBUF_POOL, p);
+  if (pkt->p == NULL) {
+    free(pkt);
+    dir->stats.queue_drops++;
+    return ERR_MEM;
+  }
+  pkt->dir = dir;
+  pkt->arrive_us = arrive;
+  sim_enqueue(pkt);
+  return ERR_OK;
+}
+
+static err_t
+sim_netif_init(struct netif *netif)
+{
+  struct sim_dir *dir = (struct sim_dir *)netif->state;
+  netif->name[0] = 's';
+  netif->name[1] = 'l';
+  netif->output = sim_output;
+  netif->mtu = dir->params.mtu;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+void
+sim_link_add(struct sim_link *link, const struct sim_link_params *params0,
+             const struct sim_link_params *params1,
+             const ip4_addr_t *addr0, const ip4_addr_t *addr1)
+{
+  const struct sim_link_params *params[2];
+  const ip4_addr_t *addr[2];
+  ip4_addr_t netmask;
+  int i;
+
+  params[0] = params0;
+  params[1] = params1;
+  addr[0] = addr0;
+  addr[1] = addr1;
+  /* point to point: the peer is reached through the pcb's netif binding */
+  IP4_ADDR(&netmask, 255, 255, 255, 255);
+  memset(link, 0, sizeof(*link));
+  for (i = 0; i < 2; i++) {
+    struct sim_dir *dir = &link->dir[i];
+    dir->params = *params[i];
+    dir->link = link;
+    dir->index = i;
+    dir->to = &link->netif[1 - i];
+    netif_add(&link->netif[i], addr[i], &netmask, IP4_ADDR_ANY4, dir, sim_netif_init, ip_input);
+    netif_set_up(&link->netif[i]);
+  }
+}
+
+void
+sim_link_remove(struct sim_link *link)
+{
+  struct sim_pkt **pp = &in_flight;
+
+  while (*pp != NULL) {
+    struct sim_pkt *pkt = *pp;
+    if (pkt->dir->link == link) {
+      *pp = pkt->next;
+      pbuf_free(pkt->p);
+      free(pkt);
+    } else {
+      pp = &pkt->next;
+    }
+  }
+  netif_remove(&link->netif[0]);
+  netif_remove(&link->netif[1]);
+}
+
+static void
+sim_deliver(void)
+{
+  while ((in_flight != NULL) && (in_flight->arrive_us <= now_us)) {
+    struct sim_pkt *pkt = in_flight;
+    struct netif *to = pkt->dir->to;
+    in_flight = pkt->next;
+    if (pkt->dir->link->tap != NULL) {
+      pkt->dir->link->tap(pkt->dir->link, pkt->dir->index, SIM_TAP_RX, pkt->p);
+    }
+    if (to->input(pkt->p, to) != ERR_OK) {
+      pbuf_free(pkt->p);
+    }
+    free(pkt);
+  }
+}
+
+void
+sim_run(u64_t end_us, int (*done)(void *arg), void *arg)
+{
+  for (;;) {
+    u64_t next = end_us;
+    u32_t sleep;
+
+    sim_deliver();
+    sys_check_timeouts();
+    if (((done != NULL) && done(arg)) || (now_us >= end_us)) {
+      break;
+    }
+    sleep = sys_timeouts_sleeptime();
+    if (sleep != SYS_TIMEOUTS_SLEEPTIME_INFINITE) {
+      u64_t t = ((u64_t)lwip_sys_now + sleep) * 1000;
+      next = LWIP_MIN(next, LWIP_MAX(t, now_us + 1));
+    }
+    if ((in_flight != NULL) && (in_flight->arrive_us < next)) {
+      next = in_flight->arrive_us;
+    }
+    sim_set_now(next);
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef LWIP_HDR_SIM_LINK_H
+#define LWIP_HDR_SIM_LINK_H
+
+/* A simulated point-to-point link between two netifs of the one lwIP stack
+ * in this process, running on a virtual clock that drives sys_now().
+ * Both endpoints bind their pcbs to their netif (tcp_bind_netif()), so the
+ * traffic between them crosses the link instead of the loopback path. */
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+/** One direction of a link */
+struct sim_link_params {
+  /** kbit/s, 0 for no serialization delay */
+  u32_t bandwidth_kbps;
+  /** propagation delay */
+  u32_t delay_us;
+  /** a random 0..jitter_us is added to the delay, packets stay in order */
+  u32_t jitter_us;
+  /** bytes waiting for the wire before packets are tail dropped, 0 for no limit */
+  u32_t queue_bytes;
+  /** random loss in packets per million */
+  u32_t loss_ppm;
+  /** packets per million that are held back by reorder_us and overtaken */
+  u32_t reorder_ppm;
+  u32_t reorder_us;
+  u16_t mtu;
+};
+
+struct sim_dir_stats {
+  u32_t packets;
+  u32_t bytes;
+  u32_t lost;
+  u32_t queue_drops;
+  u32_t reordered;
+};
+
+struct sim_link;
+
+struct sim_dir {
+  struct sim_link_params params;
+  struct sim_link *link;
+  int index;
+  struct netif *to;
+  u64_t busy_until_us;
+  u64_t last_arrival_us;
+  struct sim_dir_stats stats;
+};
+
+enum sim_tap_event {
+  /** a packet was handed to the link */
+  SIM_TAP_TX,
+  /** a packet is delivered to the receiving netif */
+  SIM_TAP_RX
+};
+
+/** Sees every packet on the link, dir is the direction it travels in and
+ * p->payload is the IP header */
+typedef void (sim_tap_fn)(struct sim_link *link, int dir, enum sim_tap_event event, struct pbuf *p);
+
+struct sim_link {
+  /** netif[0] sends over dir[0] to netif[1], netif[1] over dir[1] to netif[0] */
+  struct netif netif[2];
+  struct sim_dir dir[2];
+  sim_tap_fn *tap;
+  void *tap_arg;
+};
+
+/** Reset the random generator, the clock keeps running */
+void sim_seed(u32_t seed);
+u32_t sim_rand(void);
+u64_t sim_now_us(void);
+
+void sim_link_add(struct sim_link *link, const struct sim_link_params *params0,
+                  const struct sim_link_params *params1,
+                  const ip4_addr_t *addr0, const ip4_addr_t *addr1);
+/** Drops the packets in flight and removes the netifs */
+void sim_link_remove(struct sim_link *link);
+
+/** Run the stack until end_us or until done(arg) returns != 0.
+ * Time jumps to the next packet arrival or lwIP timeout. */
+void sim_run(u64_t end_us, int (*done)(void *arg), void *arg);
+
+#endif /* LWIP_HDR_SIM_LINK_H */
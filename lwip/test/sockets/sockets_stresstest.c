@@ -84,6 +84,17 @@
 
 static int sockets_stresstest_numthreads;
 
+/* Per direction totals of one listener iteration. Socket call times are
+   taken with sys_jiffies(), which counts nanoseconds on the unix port, so
+   the sums are 64 bit: 32 bit wrap after 4.3 seconds spent in calls. */
+struct sockets_stresstest_calls {
+  u32_t calls;
+  u64_t bytes;
+  u64_t jiffies;
+  u32_t max_jiffies;
+};
+static struct sockets_stresstest_calls sockets_stresstest_rx, sockets_stresstest_tx;
+
 struct test_settings {
   struct sockaddr_storage addr;
   int start_client;
@@ -119,8 +130,44 @@ fill_test_data(void *buf, size_t buf_len_bytes)
   p[3] = (u8_t)chk;
 }
 
+static void
+account_call(struct sockets_stresstest_calls *c, u32_t start, ssize_t ret)
+{
+  u32_t t = sys_jiffies() - start;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  c->calls++;
+  if (ret > 0) {
+    c->bytes += (u64_t)ret;
+  }
+  c->jiffies += t;
+  if (t > c->max_jiffies) {
+    c->max_jiffies = t;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+static void
+report_calls(const char *name, struct sockets_stresstest_calls *c)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+  struct sockets_stresstest_calls copy;
+
+  SYS_ARCH_PROTECT(lev);
+  copy = *c;
+  memset(c, 0, sizeof(*c));
+  SYS_ARCH_UNPROTECT(lev);
+
+  /* no long long in printf() for C90: the byte count is printed in KiB and
+     the average per call always fits 32 bit */
+  printf("sockets_stresstest: %s %"U32_F" calls %"U32_F" KiB, %"U32_F" jiffies/call (max %"U32_F")\n",
+         name, copy.calls, (u32_t)(copy.bytes >> 10),
+         (u32_t)(copy.calls ? copy.jiffies / copy.calls : 0), copy.max_jiffies);
+}
+
 static size_t
-check_test_data(const void *buf, size_t buf_len_bytes)
+check_test_data(void *buf, size_t buf_len_bytes)
 {
   u8_t *p = (u8_t*)buf;
   u16_t i, chk, chk_rx, len_rx;
@@ -154,8 +201,10 @@ static size_t
 recv_and_check_data_return_offset(int s, char *rxbuf, size_t rxbufsize, size_t rxoff, int *closed, const char *dbg)
 {
   ssize_t ret;
+  u32_t start = sys_jiffies();
 
   ret = lwip_read(s, &rxbuf[rxoff], rxbufsize - rxoff);
+  account_call(&sockets_stresstest_rx, start, ret);
   if (ret == 0) {
     *closed = 1;
     return rxoff;
@@ -439,6 +488,7 @@ sockets_stresstest_conn_client(void *arg)
   u32_t max_time = sys_now() + (TEST_TIME_SECONDS * 1000);
   int do_rx = 1;
   struct sockets_stresstest_fullduplex *data = NULL;
+  u32_t start;
 
   memcpy(&addr, arg, sizeof(addr));
   LWIP_ASSERT("", addr.ss_family == AF_INET);
@@ -487,7 +537,9 @@ sockets_stresstest_conn_client(void *arg)
       size_t send_len = (LWIP_RAND() % (sizeof(txbuf) - 4)) + 4;
       fill_test_data(txbuf, send_len);
       LWIP_DEBUGF(TEST_SOCKETS_STRESS | LWIP_DBG_TRACE, ("cli %d tx %d\n", s, (int)send_len));
+      start = sys_jiffies();
       ret = lwip_write(s, txbuf, send_len);
+      account_call(&sockets_stresstest_tx, start, ret);
       if (ret == -1) {
         /* TODO: for this to work, 'errno' has to support multithreading... */
         int err = errno;
@@ -513,8 +565,9 @@ sockets_stresstest_conn_server(void *arg)
   char txbuf[TEST_TXRX_BUFSIZE];
   char rxbuf[TEST_TXRX_BUFSIZE];
   size_t rxoff = 0;
+  u32_t start;
 
-  s = (int)arg;
+  s = (int)(size_t)arg;
 
   while (1) {
     int closed;
@@ -537,7 +590,9 @@ sockets_stresstest_conn_server(void *arg)
       size_t send_len = (LWIP_RAND() % (sizeof(txbuf) - 4)) + 4;
       fill_test_data(txbuf, send_len);
       LWIP_DEBUGF(TEST_SOCKETS_STRESS | LWIP_DBG_TRACE, ("srv %d tx %d\n", s, (int)send_len));
+      start = sys_jiffies();
       ret = lwip_write(s, txbuf, send_len);
+      account_call(&sockets_stresstest_tx, start, ret);
       if (ret == -1) {
         /* TODO: for this to work, 'errno' has to support multithreading... */
         int err = errno;
@@ -569,7 +624,7 @@ sockets_stresstest_start_clients(const struct sockaddr_storage *remote_addr)
   for (i = 0; i < max_connections; i++) {
     sys_thread_t t;
     SYS_ARCH_INC(sockets_stresstest_numthreads, 1);
-    t = sys_thread_new("sockets_stresstest_conn_client", sockets_stresstest_conn_client, (void*)remote_addr, 0, 0);
+    t = sys_thread_new("sockets_stresstest_conn_client", sockets_stresstest_conn_client, LWIP_CONST_CAST(void*, remote_addr), 0, 0);
     LWIP_ASSERT("thread != NULL", t != 0);
   }
   return max_connections;
@@ -584,6 +639,7 @@ sockets_stresstest_listener(void *arg)
   socklen_t addr_len;
   struct test_settings *settings = (struct test_settings *)arg;
   int num_clients, num_servers = 0;
+  u32_t started = sys_now();
 
   slisten = lwip_socket(AF_INET, SOCK_STREAM, 0);
   LWIP_ASSERT("slisten >= 0", slisten >= 0);
@@ -611,7 +667,7 @@ sockets_stresstest_listener(void *arg)
       sys_thread_t t;
       SYS_ARCH_INC(sockets_stresstest_numthreads, 1);
       num_servers++;
-      t = sys_thread_new("sockets_stresstest_conn_server", sockets_stresstest_conn_server, (void*)sclient, 0, 0);
+      t = sys_thread_new("sockets_stresstest_conn_server", sockets_stresstest_conn_server, (void*)(size_t)sclient, 0, 0);
       LWIP_ASSERT("thread != NULL", t != 0);
     }
 #else
@@ -628,6 +684,10 @@ sockets_stresstest_listener(void *arg)
   ret = lwip_close(slisten);
   LWIP_ASSERT("ret == 0", ret == 0);
 
+  printf("sockets_stresstest: %d connections in %"U32_F" ms\n", num_clients, sys_now() - started);
+  report_calls("rx", &sockets_stresstest_rx);
+  report_calls("tx", &sockets_stresstest_tx);
+
   LWIP_DEBUGF(TEST_SOCKETS_STRESS |LWIP_DBG_STATE, ("sockets_stresstest_listener: done\n"));
 }
 
@@ -32,6 +32,7 @@ set(LWIP_TESTFILES
 	${LWIP_TESTDIR}/tcp/tcp_helper.c
 	${LWIP_TESTDIR}/tcp/test_tcp_oos.c
 	${LWIP_TESTDIR}/tcp/test_tcp_state.c
+	${LWIP_TESTDIR}/tcp/test_tcp_gro.c
 	${LWIP_TESTDIR}/tcp/test_tcp.c
 	${LWIP_TESTDIR}/udp/test_udp.c
 	${LWIP_TESTDIR}/ppp/test_pppos.c
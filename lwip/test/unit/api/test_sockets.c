@@ -685,6 +685,468 @@ START_TEST(test_sockets_select)
 }
 END_TEST
 
+START_TEST(test_sockets_epoll)
+{
+#if LWIP_SOCKET_EPOLL && LWIP_IPV4
+  int ep, s1, s2;
+  int ret;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct epoll_event ev;
+  struct epoll_event events[4];
+  const char txbuf[] = "epoll";
+  char rxbuf[16];
+  LWIP_UNUSED_ARG(_i);
+
+  ep = lwip_epoll_create(1);
+  fail_unless(ep >= 0);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s1 >= 0);
+  ret = lwip_bind(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s1, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  s2 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s2 >= 0);
+
+  /* nothing received yet */
+  ev.events = EPOLLIN;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s1, &ev);
+  fail_unless(ret == -1);
+  fail_unless(errno == EEXIST);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  /* UDP sockets are writable right away, level triggered reports it again */
+  ev.events = EPOLLOUT;
+  ev.data.u32 = 2;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s2, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLOUT);
+  fail_unless(events[0].data.u32 == 2);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+
+  /* oneshot: reported once until rearmed */
+  ev.events = EPOLLOUT | EPOLLONESHOT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s2, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  /* a received datagram queues s1 from the event callback */
+  ret = lwip_sendto(s2, txbuf, sizeof(txbuf), 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == sizeof(txbuf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLIN);
+  fail_unless(events[0].data.fd == s1);
+
+  /* edge triggered: reported once although the datagram is still queued */
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_recv(s1, rxbuf, sizeof(rxbuf), 0);
+  fail_unless(ret == sizeof(txbuf));
+
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s2, NULL);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s2, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == ENOENT);
+
+  /* closing a registered socket removes it from the instance */
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+  ret = lwip_close(ep);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_SOCKET_EPOLL && LWIP_IPV4 */
+}
+END_TEST
+
+START_TEST(test_sockets_mmsg)
+{
+#if LWIP_IPV4
+  int s1, s2;
+  int ret;
+  unsigned int i;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct mmsghdr msgs[3];
+  struct iovec iovs[3];
+  char txbufs[2][8] = { "first", "second" };
+  char rxbufs[3][8];
+  struct timeval tv;
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s1 >= 0);
+  ret = lwip_bind(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s1, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  s2 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s2 >= 0);
+
+  /* two datagrams in one call (MEMP_NUM_NETBUF limits the receive queue),
+     the second one larger than its receive buffer */
+  memset(msgs, 0, sizeof(msgs));
+  for (i = 0; i < 2; i++) {
+    iovs[i].iov_base = txbufs[i];
+    iovs[i].iov_len = (i == 1) ? sizeof(txbufs[i]) : strlen(txbufs[i]);
+    msgs[i].msg_hdr.msg_name = &addr_storage;
+    msgs[i].msg_hdr.msg_namelen = addr_size;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  ret = lwip_sendmmsg(s2, msgs, 2, 0);
+  fail_unless(ret == 2);
+  fail_unless(msgs[0].msg_len == 5);
+  fail_unless(msgs[1].msg_len == sizeof(txbufs[1]));
+  while (tcpip_thread_poll_one());
+
+  /* receive what is queued without waiting for a third datagram */
+  memset(msgs, 0, sizeof(msgs));
+  memset(rxbufs, 0, sizeof(rxbufs));
+  for (i = 0; i < 3; i++) {
+    iovs[i].iov_base = rxbufs[i];
+    iovs[i].iov_len = (i == 1) ? 4 : sizeof(rxbufs[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  ret = lwip_recvmmsg(s1, msgs, 3, MSG_WAITFORONE, NULL);
+  fail_unless(ret == 2);
+  fail_unless(msgs[0].msg_len == 5);
+  fail_unless(!memcmp(rxbufs[0], "first", 5));
+  fail_unless(msgs[0].msg_hdr.msg_flags == 0);
+  fail_unless(msgs[1].msg_len == sizeof(txbufs[1]));
+  fail_unless(!memcmp(rxbufs[1], "seco", 4));
+  fail_unless(msgs[1].msg_hdr.msg_flags & MSG_TRUNC);
+
+  ret = lwip_recvmmsg(s1, msgs, 3, 0, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+  tv.tv_sec = tv.tv_usec = 0;
+  ret = lwip_recvmmsg(s1, msgs, 3, 0, &tv);
+  fail_unless(ret == -1);
+  fail_unless(errno == EOPNOTSUPP);
+
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_IPV4 */
+}
+END_TEST
+
+#if LWIP_SOCKET_ZEROCOPY_RECV && LWIP_IPV4
+/* connect *s1 to *s2 on loopback */
+static void
+test_sockets_zc_connect(int *s1, int *s2)
+{
+  int listnr, ret;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  listnr = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(listnr >= 0);
+  *s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(*s1 >= 0);
+  ret = lwip_bind(listnr, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_listen(listnr, 0);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(listnr, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_connect(*s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == -1);
+  fail_unless(errno == EINPROGRESS);
+  while (tcpip_thread_poll_one());
+  *s2 = lwip_accept(listnr, NULL, NULL);
+  fail_unless(*s2 >= 0);
+  ret = lwip_close(listnr);
+  fail_unless(ret == 0);
+}
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV && LWIP_IPV4 */
+
+START_TEST(test_sockets_recv_zc)
+{
+#if LWIP_SOCKET_ZEROCOPY_RECV && LWIP_IPV4
+  int s1, s2, s3, old_s1;
+  int ret, opt;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct iovec iovs[4];
+  struct msghdr msg;
+  void *handle, *handle2;
+  char rxbuf[4];
+  struct netconn *old_conn;
+  struct tcp_pcb *pcb1;
+  tcpwnd_size_t wnd1;
+  LWIP_UNUSED_ARG(_i);
+
+  /* TCP: connect s1 to s2 on loopback */
+  test_sockets_zc_connect(&s1, &s2);
+
+  ret = lwip_write(s1, "hello", 5);
+  fail_unless(ret == 5);
+  while (tcpip_thread_poll_one());
+
+  /* a copying recv leaves data behind, which is lent next */
+  ret = lwip_recv(s2, rxbuf, 2, 0);
+  fail_unless(ret == 2);
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iovs;
+  msg.msg_iovlen = 4;
+  ret = lwip_recvmsg_zc(s2, &msg, &handle, MSG_DONTWAIT);
+  fail_unless(ret == 3);
+  fail_unless(handle != NULL);
+  fail_unless(msg.msg_iovlen == 1);
+  fail_unless(iovs[0].iov_len == 3);
+  fail_unless(!memcmp(iovs[0].iov_base, "llo", 3));
+  ret = lwip_recvmsg_zc_release(s2, handle);
+  fail_unless(ret == 0);
+
+  msg.msg_iovlen = 4;
+  ret = lwip_recvmsg_zc(s2, &msg, &handle, MSG_DONTWAIT);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+  fail_unless(handle == NULL);
+
+  /* the window is only opened on the connection the pbufs came from */
+  ret = lwip_write(s1, "again", 5);
+  fail_unless(ret == 5);
+  ret = lwip_write(s2, "reply", 5);
+  fail_unless(ret == 5);
+  while (tcpip_thread_poll_one());
+  msg.msg_iovlen = 4;
+  ret = lwip_recvmsg_zc(s2, &msg, &handle2, MSG_DONTWAIT);
+  fail_unless(ret == 5);
+  msg.msg_iovlen = 4;
+  ret = lwip_recvmsg_zc(s1, &msg, &handle, MSG_DONTWAIT);
+  fail_unless(ret == 5);
+  pcb1 = lwip_socket_dbg_get_socket(s1 - LWIP_SOCKET_OFFSET)->conn->pcb.tcp;
+  wnd1 = pcb1->rcv_wnd;
+  ret = lwip_recvmsg_zc_release(s1, handle2);
+  fail_unless(ret == 0);
+  fail_unless(pcb1->rcv_wnd == wnd1);
+  ret = lwip_recvmsg_zc_release(s1, handle);
+  fail_unless(ret == 0);
+  fail_unless(pcb1->rcv_wnd == wnd1 + 5);
+
+  /* a handle that outlives its connection does not open the window of the
+     next one, even with the same descriptor and netconn ("reply" is not
+     acked yet, so Nagle would hold the segment back) */
+  opt = 1;
+  ret = lwip_setsockopt(s2, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+  ret = lwip_write(s2, "stale", 5);
+  fail_unless(ret == 5);
+  while (tcpip_thread_poll_one());
+  msg.msg_iovlen = 4;
+  ret = lwip_recvmsg_zc(s1, &msg, &handle, MSG_DONTWAIT);
+  fail_unless(ret == 5);
+  old_s1 = s1;
+  old_conn = lwip_socket_dbg_get_socket(s1 - LWIP_SOCKET_OFFSET)->conn;
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+  while (tcpip_thread_poll_one());
+  test_sockets_zc_connect(&s1, &s2);
+  fail_unless(s1 == old_s1);
+  fail_unless(lwip_socket_dbg_get_socket(s1 - LWIP_SOCKET_OFFSET)->conn == old_conn);
+  ret = lwip_write(s2, "unread", 6);
+  fail_unless(ret == 6);
+  while (tcpip_thread_poll_one());
+  pcb1 = lwip_socket_dbg_get_socket(s1 - LWIP_SOCKET_OFFSET)->conn->pcb.tcp;
+  wnd1 = pcb1->rcv_wnd;
+  ret = lwip_recvmsg_zc_release(s1, handle);
+  fail_unless(ret == 0);
+  fail_unless(pcb1->rcv_wnd == wnd1);
+
+  /* UDP: the datagram and its source address */
+  s3 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s3 >= 0);
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  ret = lwip_bind(s3, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s3, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_sendto(s3, "datagram", 8, 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 8);
+  while (tcpip_thread_poll_one());
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&addr_storage, 0, sizeof(addr_storage));
+  msg.msg_iov = iovs;
+  msg.msg_iovlen = 4;
+  msg.msg_name = &addr_storage;
+  msg.msg_namelen = sizeof(addr_storage);
+  ret = lwip_recvmsg_zc(s3, &msg, &handle, 0);
+  fail_unless(ret == 8);
+  fail_unless(msg.msg_iovlen == 1);
+  fail_unless(msg.msg_flags == 0);
+  fail_unless(!memcmp(iovs[0].iov_base, "datagram", 8));
+  fail_unless(addr_storage.ss_family == AF_INET);
+
+  /* the lent pbufs outlive the socket */
+  ret = lwip_close(s3);
+  fail_unless(ret == 0);
+  ret = lwip_recvmsg_zc_release(s3, handle);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_SOCKET_ZEROCOPY_RECV && LWIP_IPV4 */
+}
+END_TEST
+
+START_TEST(test_sockets_tcp_recv_queue)
+{
+#if LWIP_NETCONN_RECV_QUEUE && LWIP_IPV4
+  int listnr, s1, s2;
+  int ret, opt;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct netconn *conn;
+  struct pbuf *p;
+  err_t err;
+  char rxbuf[4];
+  void *msg;
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+  listnr = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(listnr >= 0);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(s1 >= 0);
+  ret = lwip_bind(listnr, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_listen(listnr, 0);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(listnr, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_connect(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == -1);
+  fail_unless(errno == EINPROGRESS);
+  while (tcpip_thread_poll_one());
+  s2 = lwip_accept(listnr, NULL, NULL);
+  fail_unless(s2 >= 0);
+  ret = lwip_close(listnr);
+  fail_unless(ret == 0);
+  opt = 1;
+  ret = lwip_setsockopt(s1, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  fail_unless(ret == 0);
+  conn = lwip_socket_dbg_get_socket(s2 - LWIP_SOCKET_OFFSET)->conn;
+
+  /* three segments received one after the other... */
+  ret = lwip_write(s1, "a", 1);
+  fail_unless(ret == 1);
+  while (tcpip_thread_poll_one());
+  ret = lwip_write(s1, "b", 1);
+  fail_unless(ret == 1);
+  while (tcpip_thread_poll_one());
+  ret = lwip_write(s1, "c", 1);
+  fail_unless(ret == 1);
+  while (tcpip_thread_poll_one());
+
+  /* ...are taken as one chain */
+  err = netconn_recv_tcp_pbuf_flags(conn, &p, NETCONN_DONTBLOCK);
+  fail_unless(err == ERR_OK);
+  fail_unless(p->tot_len == 3);
+  fail_unless(pbuf_clen(p) == 3);
+  fail_unless(pbuf_copy_partial(p, rxbuf, 3, 0) == 3);
+  fail_unless(!memcmp(rxbuf, "abc", 3));
+  pbuf_free(p);
+  ret = lwip_recv(s2, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+
+  /* the wakeup left over from the first segment doesn't hide new data */
+  ret = lwip_write(s1, "d", 1);
+  fail_unless(ret == 1);
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s2, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+  fail_unless(ret == 1);
+  fail_unless(rxbuf[0] == 'd');
+
+  /* a wakeup that did not fit into recvmbox is posted by poll_tcp() */
+  ret = lwip_recv(s2, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+  fail_unless(ret == -1);
+  fail_unless(conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_NONE);
+  while (sys_mbox_trypost(&conn->recvmbox, LWIP_CONST_CAST(void *, &ret)) == ERR_OK);
+  ret = lwip_write(s1, "f", 1);
+  fail_unless(ret == 1);
+  while (tcpip_thread_poll_one());
+  fail_unless(conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_OWED);
+  while (sys_arch_mbox_tryfetch(&conn->recvmbox, &msg) != SYS_MBOX_EMPTY);
+  LOCK_TCPIP_CORE();
+  /* parentheses: poll() is a socket API macro */
+  (conn->pcb.tcp->poll)(conn->pcb.tcp->callback_arg, conn->pcb.tcp);
+  UNLOCK_TCPIP_CORE();
+  fail_unless(conn->recvq_wakeup == NETCONN_RECVQ_WAKEUP_POSTED);
+  fail_unless(sys_arch_mbox_tryfetch(&conn->recvmbox, &msg) != SYS_MBOX_EMPTY);
+  fail_unless(msg == conn);
+  conn->recvq_wakeup = NETCONN_RECVQ_WAKEUP_NONE;
+  ret = lwip_recv(s2, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+  fail_unless(ret == 1);
+  fail_unless(rxbuf[0] == 'f');
+
+  /* FIN is passed on after the queued data */
+  ret = lwip_write(s1, "e", 1);
+  fail_unless(ret == 1);
+  ret = lwip_shutdown(s1, SHUT_WR);
+  fail_unless(ret == 0);
+  while (tcpip_thread_poll_one());
+  ret = lwip_recv(s2, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+  fail_unless(ret == 1);
+  fail_unless(rxbuf[0] == 'e');
+  ret = lwip_recv(s2, rxbuf, sizeof(rxbuf), MSG_DONTWAIT);
+  fail_unless(ret == 0);
+
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+  while (tcpip_thread_poll_one());
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_NETCONN_RECV_QUEUE && LWIP_IPV4 */
+}
+END_TEST
+
 START_TEST(test_sockets_recv_after_rst)
 {
   int sl, sact;
@@ -837,6 +1299,10 @@ sockets_suite(void)
     TESTFUNC(test_sockets_allfunctions_basic),
     TESTFUNC(test_sockets_msgapis),
     TESTFUNC(test_sockets_select),
+    TESTFUNC(test_sockets_epoll),
+    TESTFUNC(test_sockets_mmsg),
+    TESTFUNC(test_sockets_recv_zc),
+    TESTFUNC(test_sockets_tcp_recv_queue),
     TESTFUNC(test_sockets_recv_after_rst),
   };
   return create_suite("SOCKETS", tests, sizeof(tests)/sizeof(testfunc), sockets_setup, sockets_teardown);
@@ -276,7 +276,8 @@ sys_mbox_trypost(sys_mbox_t *q, void *msg)
   LWIP_ASSERT("q->size > 0", q->size > 0);
   LWIP_ASSERT("q->used <= q->size", q->used <= q->size);
 
-  if (q->used == q->size) {
+  /* head == tail means empty, so the ring holds one less than its size */
+  if (q->used >= q->size - 1) {
     return ERR_MEM;
   }
   sys_mbox_post(q, msg);
@@ -2,6 +2,7 @@
 
 #include "lwip/icmp.h"
 #include "lwip/ip4.h"
+#include "lwip/ip4_frag.h"
 #include "lwip/etharp.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/stats.h"
@@ -71,7 +72,7 @@ test_netif_remove(void)
 
 /* Helper functions */
 static void
-create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
+create_ip4_input_fragment_proto(u16_t ip_id, u8_t proto, u16_t start, u16_t len, int last)
 {
   struct pbuf *p;
   struct netif *input_netif = netif_list; /* just use any netif */
@@ -94,7 +95,7 @@ create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
       IPH_OFFSET_SET(iphdr, lwip_htons((start / 8) | IP_MF));
     }
     IPH_TTL_SET(iphdr, 5);
-    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    IPH_PROTO_SET(iphdr, proto);
     IPH_CHKSUM_SET(iphdr, 0);
     ip4_addr_copy(iphdr->src, *netif_ip4_addr(input_netif));
     iphdr->src.addr = lwip_htonl(lwip_htonl(iphdr->src.addr) + 1);
@@ -109,6 +110,52 @@ create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
   }
 }
 
+static void
+create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
+{
+  create_ip4_input_fragment_proto(ip_id, IP_PROTO_UDP, start, len, last);
+}
+
+/* time out all datagrams still being reassembled */
+static void
+flush_ip4_reass(void)
+{
+  int i;
+  for (i = 0; i <= IP_REASS_MAXAGE; i++) {
+    ip_reass_tmr();
+  }
+}
+
+/* checks the fragments of the 0..255 pattern sent by test_ip4_frag_hdr_pbuf */
+static u16_t frag_expected_off;
+
+static err_t
+test_netif_frag_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+  u16_t off = (u16_t)((lwip_ntohs(IPH_OFFSET(iphdr)) & IP_OFFMASK) * 8);
+  u16_t i;
+
+  fail_unless(netif == &test_netif);
+  linkoutput_ctr++;
+  linkoutput_byte_ctr += p->tot_len;
+  /* the header lives in its own (custom) pbuf, the data is chained to it */
+  fail_unless(p->len == IP_HLEN);
+  fail_unless(p->flags & PBUF_FLAG_IS_CUSTOM);
+  fail_unless(p->next != NULL);
+  fail_unless(inet_chksum(iphdr, IP_HLEN) == 0);
+  fail_unless(lwip_ntohs(IPH_LEN(iphdr)) == p->tot_len);
+  fail_unless(off == frag_expected_off);
+  for (i = IP_HLEN; i < p->tot_len; i++) {
+    if (pbuf_get_at(p, i) != (u8_t)(off + i - IP_HLEN)) {
+      fail("fragment data mismatch");
+      break;
+    }
+  }
+  frag_expected_off = (u16_t)(frag_expected_off + p->tot_len - IP_HLEN);
+  return ERR_OK;
+}
+
 static err_t arpless_output(struct netif *netif, struct pbuf *p,
                             const ip4_addr_t *ipaddr) {
   LWIP_UNUSED_ARG(ipaddr);
@@ -162,6 +209,43 @@ START_TEST(test_ip4_frag)
 }
 END_TEST
 
+START_TEST(test_ip4_frag_hdr_pbuf)
+{
+  /* a datagram spread over a chain, so fragments mirror several pbufs */
+  struct pbuf *data = pbuf_alloc(PBUF_IP, 4000, PBUF_POOL);
+  struct pbuf *q;
+  ip_addr_t peer_ip = IPADDR4_INIT_BYTES(192,168,0,5);
+  u16_t i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(data != NULL);
+  fail_unless(data->next != NULL);
+  i = 0;
+  for (q = data; q != NULL; q = q->next) {
+    u16_t j;
+    for (j = 0; j < q->len; j++, i++) {
+      ((u8_t *)q->payload)[j] = (u8_t)i;
+    }
+  }
+  test_netif_add();
+  test_netif.output = arpless_output;
+  test_netif.linkoutput = test_netif_frag_linkoutput;
+  linkoutput_ctr = 0;
+  linkoutput_byte_ctr = 0;
+  frag_expected_off = 0;
+
+  err = ip4_output_if_src(data, &test_ipaddr, ip_2_ip4(&peer_ip),
+                          16, 0, IP_PROTO_UDP, &test_netif);
+  fail_unless(err == ERR_OK);
+  fail_unless(linkoutput_ctr == 3);
+  fail_unless(linkoutput_byte_ctr == (4000 + (3 * IP_HLEN)));
+  fail_unless(frag_expected_off == 4000);
+  pbuf_free(data);
+  test_netif_remove();
+}
+END_TEST
+
 START_TEST(test_ip4_reass)
 {
   const u16_t ip_id = 128;
@@ -234,6 +318,95 @@ START_TEST(test_ip4_reass)
 }
 END_TEST
 
+/* fragments with the same ID but a different protocol belong to different datagrams */
+START_TEST(test_ip4_reass_proto)
+{
+  const u16_t ip_id = 129;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&lwip_stats.mib2, 0, sizeof(lwip_stats.mib2));
+  memset(&lwip_stats.ip_frag, 0, sizeof(lwip_stats.ip_frag));
+
+  create_ip4_input_fragment_proto(ip_id, IP_PROTO_UDP, 0, 200, 0);
+  create_ip4_input_fragment_proto(ip_id, IP_PROTO_TCP, 0, 200, 0);
+  create_ip4_input_fragment_proto(ip_id, IP_PROTO_TCP, 200, 100, 1);
+  fail_unless(lwip_stats.ip_frag.drop == 0);
+  fail_unless(lwip_stats.mib2.ipreasmoks == 1);
+
+  create_ip4_input_fragment_proto(ip_id, IP_PROTO_UDP, 200, 100, 1);
+  fail_unless(lwip_stats.ip_frag.drop == 0);
+  fail_unless(lwip_stats.mib2.ipreasmoks == 2);
+  fail_unless(lwip_stats.mib2.ipreasmfails == 0);
+}
+END_TEST
+
+/* a single datagram must not take more than IP_REASS_MAX_PBUFS_PER_DATAGRAM pbufs */
+START_TEST(test_ip4_reass_budget)
+{
+  const u16_t ip_id = 130;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&lwip_stats.mib2, 0, sizeof(lwip_stats.mib2));
+  memset(&lwip_stats.ip_frag, 0, sizeof(lwip_stats.ip_frag));
+
+  /* tiny fragments with holes in between */
+  for (i = 0; i < IP_REASS_MAX_PBUFS_PER_DATAGRAM; i++) {
+    create_ip4_input_fragment(ip_id, (u16_t)(8 + i * 16), 8, 0);
+  }
+  fail_unless(lwip_stats.ip_frag.drop == 0);
+  fail_unless(lwip_stats.mib2.ipreasmfails == 0);
+
+  /* one more drops the whole datagram */
+  create_ip4_input_fragment(ip_id, (u16_t)(8 + i * 16), 8, 0);
+  fail_unless(lwip_stats.ip_frag.memerr == 1);
+  fail_unless(lwip_stats.ip_frag.drop == 1);
+  fail_unless(lwip_stats.mib2.ipreasmfails == 1);
+
+  /* other datagrams are not affected */
+  create_ip4_input_fragment(ip_id + 1, 0, 200, 0);
+  create_ip4_input_fragment(ip_id + 1, 200, 200, 1);
+  fail_unless(lwip_stats.mib2.ipreasmoks == 1);
+
+  flush_ip4_reass();
+}
+END_TEST
+
+/* a source must not have more than IP_REASS_MAX_DATAGRAMS_PER_SRC datagrams in reassembly */
+START_TEST(test_ip4_reass_per_src)
+{
+#if IP_REASS_MAX_DATAGRAMS_PER_SRC
+  const u16_t ip_id = 140;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&lwip_stats.mib2, 0, sizeof(lwip_stats.mib2));
+  memset(&lwip_stats.ip_frag, 0, sizeof(lwip_stats.ip_frag));
+
+  for (i = 0; i < IP_REASS_MAX_DATAGRAMS_PER_SRC; i++) {
+    create_ip4_input_fragment((u16_t)(ip_id + i), 200, 200, 1);
+  }
+  fail_unless(lwip_stats.mib2.ipreasmfails == 0);
+
+  /* the next datagram frees the oldest one of this source */
+  create_ip4_input_fragment((u16_t)(ip_id + i), 200, 200, 1);
+  fail_unless(lwip_stats.mib2.ipreasmfails == 1);
+
+  /* the oldest one is gone... */
+  create_ip4_input_fragment(ip_id, 0, 200, 0);
+  fail_unless(lwip_stats.mib2.ipreasmoks == 0);
+  fail_unless(lwip_stats.mib2.ipreasmfails == 2);
+  /* ...but the newest one is still there */
+  create_ip4_input_fragment((u16_t)(ip_id + i), 0, 200, 0);
+  fail_unless(lwip_stats.mib2.ipreasmoks == 1);
+
+  flush_ip4_reass();
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* IP_REASS_MAX_DATAGRAMS_PER_SRC */
+}
+END_TEST
+
 /* packets to 127.0.0.1 shall not be sent out to netif_default */
 START_TEST(test_127_0_0_1)
 {
@@ -326,17 +499,54 @@ START_TEST(test_ip4_icmp_replylen_first_8)
 }
 END_TEST
 
+/* a burst of packets is passed to tcpip_thread in one message */
+START_TEST(test_ip4_inpkt_burst)
+{
+  /* IP packet to 192.168.0.1 using proto 0x22 and 1 byte payload */
+  const u8_t unknown_proto[] = {
+    0x45, 0x00, 0x00, 0x15, 0xd4, 0x31, 0x00, 0x00, 0xff, 0x22,
+    0x66, 0x41, 0xc0, 0xa8, 0x00, 0x02, 0xc0, 0xa8, 0x00, 0x01,
+    0xaa };
+  struct pbuf *p[TCPIP_INPKT_BURST_MAX];
+  struct netif *inp[TCPIP_INPKT_BURST_MAX];
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  test_netif.output = arpless_output;
+  linkoutput_ctr = 0;
+  for (i = 0; i < TCPIP_INPKT_BURST_MAX; i++) {
+    p[i] = pbuf_alloc(PBUF_IP, sizeof(unknown_proto), PBUF_RAM);
+    fail_unless(p[i] != NULL);
+    pbuf_take(p[i], unknown_proto, sizeof(unknown_proto));
+    inp[i] = &test_netif;
+  }
+  fail_unless(tcpip_inpkt_burst(p, inp, TCPIP_INPKT_BURST_MAX, ip4_input) == ERR_OK);
+  fail_unless(linkoutput_ctr == 0);
+
+  /* one message for the whole burst */
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless(linkoutput_ctr == TCPIP_INPKT_BURST_MAX);
+  fail_unless(tcpip_thread_poll_one() == 0);
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 ip4_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_ip4_frag),
+    TESTFUNC(test_ip4_frag_hdr_pbuf),
     TESTFUNC(test_ip4_reass),
+    TESTFUNC(test_ip4_reass_proto),
+    TESTFUNC(test_ip4_reass_budget),
+    TESTFUNC(test_ip4_reass_per_src),
     TESTFUNC(test_127_0_0_1),
     TESTFUNC(test_ip4addr_aton),
     TESTFUNC(test_ip4_icmp_replylen_short),
     TESTFUNC(test_ip4_icmp_replylen_first_8),
+    TESTFUNC(test_ip4_inpkt_burst),
   };
   return create_suite("IPv4", tests, sizeof(tests)/sizeof(testfunc), ip4_setup, ip4_teardown);
 }
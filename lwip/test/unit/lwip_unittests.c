@@ -6,6 +6,7 @@
 #include "tcp/test_tcp.h"
 #include "tcp/test_tcp_oos.h"
 #include "tcp/test_tcp_state.h"
+#include "tcp/test_tcp_gro.h"
 #include "core/test_def.h"
 #include "core/test_dns.h"
 #include "core/test_mem.h"
@@ -81,6 +82,7 @@ int main(void)
     tcp_suite,
     tcp_oos_suite,
     tcp_state_suite,
+    tcp_gro_suite,
     def_suite,
     dns_suite,
     mem_suite,
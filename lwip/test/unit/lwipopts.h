@@ -47,9 +47,13 @@
 #define LWIP_SOCKET                     !NO_SYS
 #define LWIP_NETCONN_FULLDUPLEX         LWIP_SOCKET
 #define LWIP_NETCONN_SEM_PER_THREAD     1
+#define LWIP_NETCONN_RECV_QUEUE         1
+#define LWIP_SOCKET_EPOLL               1
+#define LWIP_SOCKET_ZEROCOPY_RECV       1
 #define LWIP_NETBUF_RECVINFO            1
 #define LWIP_HAVE_LOOPIF                1
 #define TCPIP_THREAD_TEST
+#define TCPIP_INPKT_BURST_MAX           8
 
 /* Enable DHCP to test it */
 #define LWIP_DHCP                       1
@@ -64,10 +68,16 @@
 #define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
 #define TCP_SND_BUF                     (12 * TCP_MSS)
 #define TCP_WND                         (10 * TCP_MSS)
+#define TCP_OOSEQ_GLOBAL_MAX_BYTES      TCP_WND /* one window over all pcbs */
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   0
+#define LWIP_TCP_WRITE_ZEROCOPY         1
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
 
+/* Per-datagram and per-source reassembly budgets for IPv4 tests */
+#define IP_REASS_MAX_PBUFS_PER_DATAGRAM 9
+#define IP_REASS_MAX_DATAGRAMS_PER_SRC  2
+
 /* Enable IGMP and MDNS for MDNS tests */
 #define LWIP_IGMP                       1
 #define LWIP_MDNS_RESPONDER             1
@@ -80,7 +90,18 @@
 /* Minimal changes to opt.h required for etharp unit tests: */
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
 
+#ifdef LWIP_BENCH
+/* test/bench scales pcb lists, the ARP table and the timeout list
+   well beyond what the unit tests need */
+#define MEMP_NUM_TCP_PCB                64
+#define MEMP_NUM_UDP_PCB                64
+#define ARP_TABLE_SIZE                  64
+#define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 72)
+/* lwip_sim runs the cyclic timers, ip6_reass_tmr() asserts this on 64 bit hosts */
+#define IPV6_FRAG_COPYHEADER            1
+#else
 #define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 8)
+#endif
 
 /* MIB2 stats are required to check IPv4 reassembly results */
 #define MIB2_STATS                      1
@@ -88,6 +109,9 @@
 /* netif tests want to test this, so enable: */
 #define LWIP_NETIF_EXT_STATUS_CALLBACK  1
 
+/* Enable receive coalescing for the tcp_gro tests */
+#define LWIP_GRO                        1
+
 /* Check lwip_stats.mem.illegal instead of asserting */
 #define LWIP_MEM_ILLEGAL_FREE(msg)      /* to nothing */
 
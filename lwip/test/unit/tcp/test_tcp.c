@@ -1669,6 +1669,101 @@ START_TEST(test_tcp_persist_split)
 }
 END_TEST
 
+#if LWIP_TCP_WRITE_ZEROCOPY
+static int test_tcp_zc_released;
+static void *test_tcp_zc_token;
+
+static void
+test_tcp_zc_release(void *token)
+{
+  test_tcp_zc_released++;
+  test_tcp_zc_token = token;
+}
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+
+/** Send a buffer with tcp_write_zc() and check that the release callback is
+ * called only once all segments referencing it are ACKed. */
+START_TEST(test_tcp_write_zc)
+{
+#if LWIP_TCP_WRITE_ZEROCOPY
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  static u8_t zc_data[2 * TCP_MSS + 100];
+  int token;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_zc_released = 0;
+  test_tcp_zc_token = NULL;
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  /* disable initial congestion window (we don't send a SYN here...) */
+  pcb->cwnd = pcb->snd_wnd;
+  tcp_nagle_disable(pcb);
+
+  /* first 100 bytes by ROM reference, the rest (contiguous) by tcp_write_zc */
+  err = tcp_write(pcb, zc_data, 100, TCP_WRITE_FLAG_MORE);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_write_zc(pcb, &zc_data[100], 2 * TCP_MSS, 0, test_tcp_zc_release, &token);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_REF) == 1);
+  /* the ROM pbuf must not have been extended over the zero-copy buffer */
+  EXPECT(pbuf_clen(pcb->unsent->p) == 3);
+  EXPECT(test_tcp_zc_released == 0);
+
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 3);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* ACK the first 2 segments: the last one still references the buffer */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 2 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked != NULL);
+  EXPECT(test_tcp_zc_released == 0);
+
+  /* ACK the rest */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 100, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(test_tcp_zc_released == 1);
+  EXPECT(test_tcp_zc_token == &token);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_REF) == 0);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_PBUF) == 0);
+
+  /* unacked data is released when the pcb is aborted */
+  err = tcp_write_zc(pcb, zc_data, sizeof(zc_data), 0, test_tcp_zc_release, NULL);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(test_tcp_zc_released == 1);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  EXPECT(test_tcp_zc_released == 2);
+  EXPECT(test_tcp_zc_token == NULL);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_REF) == 0);
+#else /* LWIP_TCP_WRITE_ZEROCOPY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_WRITE_ZEROCOPY */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 tcp_suite(void)
@@ -1694,7 +1789,8 @@ tcp_suite(void)
     TESTFUNC(test_tcp_rto_timeout_syn_sent_link_down),
     TESTFUNC(test_tcp_zwp_timeout),
     TESTFUNC(test_tcp_zwp_timeout_link_down),
-    TESTFUNC(test_tcp_persist_split)
+    TESTFUNC(test_tcp_persist_split),
+    TESTFUNC(test_tcp_write_zc)
   };
   return create_suite("TCP", tests, sizeof(tests)/sizeof(testfunc), tcp_setup, tcp_teardown);
 }
@@ -0,0 +1,251 @@
+#include "test_tcp_gro.h"
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ethernet.h"
+#include "netif/ethernet.h"
+#include "netif/gro.h"
+#include "tcp_helper.h"
+
+#if !LWIP_STATS || !TCP_STATS || !MEMP_STATS
+#error "This tests needs TCP- and MEMP-statistics enabled"
+#endif
+
+#if LWIP_GRO
+
+#define GRO_TEST_SEGS 3
+
+static struct netif *old_netif_list;
+static struct netif *old_netif_default;
+static char gro_data[GRO_TEST_SEGS * TCP_MSS];
+
+/* Setups/teardown functions */
+
+static void
+tcp_gro_setup(void)
+{
+  size_t i;
+
+  old_netif_list = netif_list;
+  old_netif_default = netif_default;
+  netif_list = NULL;
+  netif_default = NULL;
+  tcp_remove_all();
+  for (i = 0; i < sizeof(gro_data); i++) {
+    gro_data[i] = (char)i;
+  }
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+tcp_gro_teardown(void)
+{
+  gro_flush();
+  netif_list = NULL;
+  netif_default = NULL;
+  tcp_remove_all();
+  /* restore netif_list for next tests (e.g. loopif) */
+  netif_list = old_netif_list;
+  netif_default = old_netif_default;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/* helper functions */
+
+static void
+gro_init_netif(struct netif *netif, struct test_tcp_txcounters *txcounters)
+{
+  test_tcp_init_netif(netif, txcounters, &test_local_ip, &test_netmask);
+  netif->input = ethernet_input;
+  netif->flags |= NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET;
+}
+
+/** Put an ethernet header in front of a segment from tcp_create_rx_segment() */
+static struct pbuf *
+gro_frame(struct pbuf *ip)
+{
+  struct pbuf *p;
+  struct eth_hdr *ethhdr;
+  struct ip_hdr *iphdr;
+
+  EXPECT_RETNULL(ip != NULL);
+  p = pbuf_alloc(PBUF_RAW, (u16_t)(SIZEOF_ETH_HDR + ip->tot_len), PBUF_POOL);
+  EXPECT_RETNULL(p != NULL);
+  EXPECT_RETNULL(p->next == NULL);
+  ethhdr = (struct eth_hdr *)p->payload;
+  memset(ethhdr, 0, SIZEOF_ETH_HDR);
+#if ETH_PAD_SIZE
+  {
+    /* the pad is not part of the frame: make it differ between frames */
+    static u8_t pad;
+    memset(ethhdr->padding, ++pad, ETH_PAD_SIZE);
+  }
+#endif
+  ethhdr->dest.addr[5] = 1;
+  ethhdr->src.addr[5] = 2;
+  ethhdr->type = PP_HTONS(ETHTYPE_IP);
+  EXPECT(pbuf_copy_partial(ip, (u8_t *)p->payload + SIZEOF_ETH_HDR, ip->tot_len, 0) == ip->tot_len);
+  pbuf_free(ip);
+  /* tcp_create_segment() leaves these fields for tcp_input() tests */
+  iphdr = (struct ip_hdr *)((u8_t *)p->payload + SIZEOF_ETH_HDR);
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+  IPH_CHKSUM_SET(iphdr, 0);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  return p;
+}
+
+static struct tcp_pcb *
+gro_new_pcb(struct test_tcp_counters *counters)
+{
+  struct tcp_pcb *pcb;
+
+  memset(counters, 0, sizeof(*counters));
+  counters->expected_data = gro_data;
+  counters->expected_data_len = sizeof(gro_data);
+  pcb = test_tcp_new_counters_pcb(counters);
+  EXPECT_RETNULL(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  return pcb;
+}
+
+/** Pass data segment 'seg' to gro_input(), seqno_offset is relative to rcv_nxt */
+static void
+gro_input_seg(struct tcp_pcb *pcb, struct netif *netif, u32_t seg, u32_t seqno_offset, u8_t flags)
+{
+  struct pbuf *p = gro_frame(tcp_create_rx_segment(pcb, &gro_data[seg * TCP_MSS], TCP_MSS,
+                                                   seqno_offset, 0, flags));
+  EXPECT_RET(p != NULL);
+  if (gro_input(p, netif) != ERR_OK) {
+    pbuf_free(p);
+  }
+}
+
+/* Test functions */
+
+/** In-order segments of one batch reach the application in one callback
+ * and are acked at once */
+START_TEST(test_tcp_gro_merge)
+{
+  struct test_tcp_counters counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb *pcb;
+  u32_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  gro_init_netif(&netif, &txcounters);
+  pcb = gro_new_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+
+  for (i = 0; i < GRO_TEST_SEGS; i++) {
+    gro_input_seg(pcb, &netif, i, i * TCP_MSS, TCP_ACK);
+  }
+  /* all segments are held back until the batch ends */
+  EXPECT(counters.recv_calls == 0);
+  EXPECT(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == GRO_TEST_SEGS);
+  gro_flush();
+
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == sizeof(gro_data));
+  EXPECT(lwip_stats.tcp.chkerr == 0);
+  /* acked right away instead of waiting for the delayed ACK timer */
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  tcp_abort(pcb);
+}
+END_TEST
+
+/** A corrupted segment makes the whole merged segment fail the checksum */
+START_TEST(test_tcp_gro_chksum)
+{
+  struct test_tcp_counters counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u16_t chkerr = lwip_stats.tcp.chkerr;
+  LWIP_UNUSED_ARG(_i);
+
+  gro_init_netif(&netif, &txcounters);
+  pcb = gro_new_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+
+  gro_input_seg(pcb, &netif, 0, 0, TCP_ACK);
+  p = gro_frame(tcp_create_rx_segment(pcb, &gro_data[TCP_MSS], TCP_MSS, TCP_MSS, 0, TCP_ACK));
+  EXPECT_RET(p != NULL);
+  ((u8_t *)p->payload)[p->len - 1] ^= 0x55;
+  EXPECT(gro_input(p, &netif) == ERR_OK);
+  gro_flush();
+
+  EXPECT(counters.recv_calls == 0);
+  EXPECT(lwip_stats.tcp.chkerr == chkerr + 1);
+
+  tcp_abort(pcb);
+}
+END_TEST
+
+/** A segment that doesn't continue the burst flushes the held data first,
+ * PSH ends a burst */
+START_TEST(test_tcp_gro_flush)
+{
+  struct test_tcp_counters counters;
+  struct test_tcp_txcounters txcounters;
+  struct netif netif;
+  struct tcp_pcb *pcb;
+  LWIP_UNUSED_ARG(_i);
+
+  gro_init_netif(&netif, &txcounters);
+  pcb = gro_new_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+
+  /* segment 2 is out of order: segment 0 is passed on, 2 goes to ooseq */
+  gro_input_seg(pcb, &netif, 0, 0, TCP_ACK);
+  gro_input_seg(pcb, &netif, 2, 2 * TCP_MSS, TCP_ACK);
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == TCP_MSS);
+  gro_flush();
+  EXPECT(pcb->ooseq != NULL);
+
+  /* segment 1 fills the hole, PSH delivers it without gro_flush() */
+  gro_input_seg(pcb, &netif, 1, 0, TCP_ACK | TCP_PSH);
+  EXPECT(counters.recv_calls == 2);
+  EXPECT(counters.recved_bytes == sizeof(gro_data));
+  EXPECT(pcb->ooseq == NULL);
+
+  tcp_abort(pcb);
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+tcp_gro_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_tcp_gro_merge),
+    TESTFUNC(test_tcp_gro_chksum),
+    TESTFUNC(test_tcp_gro_flush)
+  };
+  return create_suite("TCP_GRO", tests, sizeof(tests)/sizeof(testfunc), tcp_gro_setup, tcp_gro_teardown);
+}
+
+#else /* LWIP_GRO */
+
+/* allow to build the unit tests without GRO support */
+START_TEST(test_tcp_gro_dummy)
+{
+  LWIP_UNUSED_ARG(_i);
+}
+END_TEST
+
+Suite *
+tcp_gro_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_tcp_gro_dummy),
+  };
+  return create_suite("TCP_GRO", tests, sizeof(tests)/sizeof(testfunc), NULL, NULL);
+}
+#endif /* LWIP_GRO */
@@ -2,6 +2,7 @@
 
 #include "lwip/priv/tcp_priv.h"
 #include "lwip/stats.h"
+#include "lwip/tcpip.h"
 #include "tcp_helper.h"
 
 #if !LWIP_STATS || !TCP_STATS || !MEMP_STATS
@@ -117,6 +118,26 @@ tcp_oos_tcplen(struct tcp_pcb* pcb)
   return len;
 }
 
+/** Check that ooseq_tail and the ooseq byte counts match the ooseq list */
+static void
+tcp_oos_check_accounting(struct tcp_pcb* pcb)
+{
+  u32_t bytes = 0;
+  struct tcp_seg* seg = pcb->ooseq;
+  struct tcp_seg* last = NULL;
+
+  while(seg != NULL) {
+    bytes += seg->len;
+    last = seg;
+    seg = seg->next;
+  }
+  EXPECT(pcb->ooseq_bytes == bytes);
+  EXPECT(tcp_ooseq_bytes == bytes);
+  if (last != NULL) {
+    EXPECT(pcb->ooseq_tail == last);
+  }
+}
+
 /* Setup/teardown functions */
 static struct netif *old_netif_list;
 static struct netif *old_netif_default;
@@ -141,6 +162,7 @@ tcp_oos_teardown(void)
   /* restore netif_list for next tests (e.g. loopif) */
   netif_list = old_netif_list;
   netif_default = old_netif_default;
+  EXPECT(tcp_ooseq_bytes == 0);
   lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
 }
 
@@ -780,6 +802,90 @@ START_TEST(test_tcp_recv_ooseq_max_pbufs)
 }
 END_TEST
 
+/** Pass segments in ascending order behind a hole (appended at the tail),
+ * then some in between, and check the ooseq accounting on every step */
+START_TEST(test_tcp_recv_ooseq_tail)
+{
+  int i;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  struct netif netif;
+  const int seglen = TCP_MSS / 2;
+  LWIP_UNUSED_ARG(_i);
+
+  for(i = 0; i < (int)sizeof(data_full_wnd); i++) {
+    data_full_wnd[i] = (char)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, NULL, &test_local_ip, &test_netmask);
+  /* initialize counter struct */
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = TCP_WND;
+  counters.expected_data = data_full_wnd;
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->rcv_nxt = 0x8000;
+
+  /* segments 2, 4, 6, 8 and 9 (segment 0 is missing) */
+  for(i = 2; i < 10; i += 2) {
+    p = tcp_create_rx_segment(pcb, &data_full_wnd[i * seglen], seglen, i * seglen, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    tcp_oos_check_accounting(pcb);
+  }
+  p = tcp_create_rx_segment(pcb, &data_full_wnd[9 * seglen], seglen, 9 * seglen, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  tcp_oos_check_accounting(pcb);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 5);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 4) == (u32_t)(0x8000 + 9 * seglen));
+
+  /* segment 7 (overlapping 8 by one byte) goes in between */
+  p = tcp_create_rx_segment(pcb, &data_full_wnd[7 * seglen], seglen + 1, 7 * seglen, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  tcp_oos_check_accounting(pcb);
+  EXPECT_OOSEQ(tcp_oos_count(pcb) == 6);
+  EXPECT_OOSEQ(tcp_oos_seg_tcplen(pcb, 3) == seglen);
+
+  /* segments 1, 3 and 5 (covering 1 to 6) replace segments 2, 4 and 6 */
+  for(i = 1; i < 7; i += 2) {
+    p = tcp_create_rx_segment(pcb, &data_full_wnd[i * seglen], 2 * seglen, i * seglen, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    tcp_oos_check_accounting(pcb);
+  }
+  EXPECT(counters.recv_calls == 0);
+  EXPECT_OOSEQ(tcp_oos_tcplen(pcb) == 9 * seglen);
+
+  /* keep the lowest 4 * seglen bytes only */
+  tcp_ooseq_limit(pcb, 4 * seglen, 0xFFFF);
+  tcp_oos_check_accounting(pcb);
+  EXPECT_OOSEQ(tcp_oos_tcplen(pcb) == 4 * seglen);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb, 0) == (u32_t)(0x8000 + seglen));
+
+  /* the missing segment makes the remaining ooseq data in-sequence */
+  p = tcp_create_rx_segment(pcb, &data_full_wnd[0], seglen, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == (u32_t)(5 * seglen));
+  EXPECT(pcb->ooseq == NULL);
+  tcp_oos_check_accounting(pcb);
+
+  /* make sure the pcb is freed */
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  EXPECT(tcp_ooseq_bytes == 0);
+}
+END_TEST
+
 static void
 check_rx_counters(struct tcp_pcb *pcb, struct test_tcp_counters *counters, u32_t exp_close_calls, u32_t exp_rx_calls,
                   u32_t exp_rx_bytes, u32_t exp_err_calls, int exp_oos_count, int exp_oos_len)
@@ -793,6 +899,7 @@ check_rx_counters(struct tcp_pcb *pcb, struct test_tcp_counters *counters, u32_t
   EXPECT_OOSEQ(tcp_oos_count(pcb) == exp_oos_count);
   oos_len = tcp_oos_tcplen(pcb);
   EXPECT_OOSEQ(exp_oos_len == oos_len);
+  tcp_oos_check_accounting(pcb);
 }
 
 /* this test uses 4 packets:
@@ -959,6 +1066,92 @@ static void test_tcp_recv_ooseq_double_FINs(int delay_packet)
   EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
 }
 
+START_TEST(test_tcp_recv_ooseq_global_max_bytes)
+{
+#if TCP_OOSEQ_GLOBAL_MAX_BYTES && (TCP_OOSEQ_GLOBAL_MAX_BYTES >= 4 * TCP_MSS) && (TCP_OOSEQ_GLOBAL_MAX_BYTES <= TCP_WND) && PBUF_POOL_FREE_OOSEQ && defined(TCPIP_THREAD_TEST) && (PBUF_POOL_BUFSIZE >= (TCP_MSS + PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN + PBUF_IP_HLEN + PBUF_TRANSPORT_HLEN))
+  struct test_tcp_counters counters1, counters2;
+  struct tcp_pcb *pcb1, *pcb2;
+  struct pbuf *p, *pool = NULL;
+  struct netif netif;
+  u32_t i, blen1;
+
+  for(i = 0; i < sizeof(data_full_wnd); i++) {
+    data_full_wnd[i] = (char)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, NULL, &test_local_ip, &test_netmask);
+  /* initialize counter structs */
+  memset(&counters1, 0, sizeof(counters1));
+  memset(&counters2, 0, sizeof(counters2));
+
+  /* create and initialize two pcbs */
+  pcb1 = test_tcp_new_counters_pcb(&counters1);
+  EXPECT_RET(pcb1 != NULL);
+  tcp_set_state(pcb1, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb1->rcv_nxt = 0x8000;
+  pcb2 = test_tcp_new_counters_pcb(&counters2);
+  EXPECT_RET(pcb2 != NULL);
+  tcp_set_state(pcb2, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT + 1, TEST_REMOTE_PORT);
+  pcb2->rcv_nxt = 0x8000;
+
+  /* pcb1 queues all but one TCP_MSS of the budget (the first byte is missing) */
+  blen1 = (TCP_OOSEQ_GLOBAL_MAX_BYTES / TCP_MSS - 1) * TCP_MSS;
+  for(i = 1; i < 1 + blen1; i += TCP_MSS) {
+    p = tcp_create_rx_segment(pcb1, &data_full_wnd[i], TCP_MSS, i, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT(pcb1->ooseq_bytes == blen1);
+  EXPECT(tcp_ooseq_bytes == blen1);
+
+  /* pcb2 gets three segments, but only the first fits into the rest of the
+     budget: its own queue is trimmed, the one of pcb1 is left alone */
+  for(i = 1; i < 1 + 3 * TCP_MSS; i += TCP_MSS) {
+    p = tcp_create_rx_segment(pcb2, &data_full_wnd[i], TCP_MSS, i, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    EXPECT(tcp_ooseq_bytes <= TCP_OOSEQ_GLOBAL_MAX_BYTES);
+  }
+  EXPECT_OOSEQ(tcp_oos_count(pcb2) == 1);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb2, 0) == 0x8001);
+  EXPECT(pcb2->ooseq_bytes == TCP_MSS);
+  EXPECT(pcb1->ooseq_bytes == blen1);
+  EXPECT(tcp_ooseq_bytes == blen1 + TCP_MSS);
+
+  /* running out of pool pbufs queues pbuf_free_ooseq(), which frees the
+     upper half of the largest queue: the older one of pcb1 */
+  while ((p = pbuf_alloc(PBUF_RAW, 1, PBUF_POOL)) != NULL) {
+    if (pool == NULL) {
+      pool = p;
+    } else {
+      pbuf_cat(pool, p);
+    }
+  }
+  EXPECT_RET(pool != NULL);
+  pbuf_free(pool);
+  while (tcpip_thread_poll_one());
+  EXPECT(pcb1->ooseq_bytes == (blen1 / 2 / TCP_MSS) * TCP_MSS);
+  EXPECT_OOSEQ(tcp_oos_seg_seqno(pcb1, 0) == 0x8001);
+  EXPECT(pcb2->ooseq_bytes == TCP_MSS);
+  EXPECT(tcp_ooseq_bytes == pcb1->ooseq_bytes + TCP_MSS);
+
+  /* the budget is given back by tcp_abort() and tcp_free_ooseq() */
+  tcp_abort(pcb2);
+  EXPECT(tcp_ooseq_bytes == pcb1->ooseq_bytes);
+  tcp_free_ooseq(pcb1);
+  EXPECT(pcb1->ooseq == NULL);
+  EXPECT(tcp_ooseq_bytes == 0);
+
+  /* make sure the pcb is freed */
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb1);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#endif /* TCP_OOSEQ_GLOBAL_MAX_BYTES && ... */
+  LWIP_UNUSED_ARG(_i);
+}
+END_TEST
+
 /** create multiple segments and pass them to tcp_input with the first segment missing
  * to simulate overruning the rxwin with ooseq queueing enabled */
 #define FIN_TEST(name, num) \
@@ -997,6 +1190,8 @@ tcp_oos_suite(void)
     TESTFUNC(test_tcp_recv_ooseq_overrun_rxwin_edge),
     TESTFUNC(test_tcp_recv_ooseq_max_bytes),
     TESTFUNC(test_tcp_recv_ooseq_max_pbufs),
+    TESTFUNC(test_tcp_recv_ooseq_tail),
+    TESTFUNC(test_tcp_recv_ooseq_global_max_bytes),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_0),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_1),
     TESTFUNC(test_tcp_recv_ooseq_double_FIN_2),
@@ -0,0 +1,40 @@
+/* Time-to-network measurement: reset -> main -> lwip_init() -> first IP */
+
+#include <stdio.h>
+#include "timer.h"
+#include "boot.h"
+
+static const char * const boot_stage_names[BOOT_STAGES] = {
+  "main",
+  "lwip_init",
+  "first ip"
+};
+
+static uint32_t boot_times[BOOT_STAGES];
+static unsigned int boot_mask;
+
+void boot_stamp (enum boot_stage stage)
+{
+  if (!boot_stamped(stage)) {
+    boot_times[stage] = timer_us();
+    boot_mask |= 1U << stage;
+  }
+}
+
+int boot_stamped (enum boot_stage stage)
+{
+  return (boot_mask & (1U << stage)) != 0U;
+}
+
+void boot_report (void)
+{
+  unsigned int i;
+
+  printf("boot:");
+  for (i = 0U; i < BOOT_STAGES; i++) {
+    if (boot_stamped((enum boot_stage)i)) {
+      printf(" %s %lu us", boot_stage_names[i], (unsigned long)boot_times[i]);
+    }
+  }
+  printf("\n");
+}
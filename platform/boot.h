@@ -0,0 +1,20 @@
+#ifndef __boot__
+#define __boot__
+
+/* Boot stages timed from reset (timer 0 is started by _Reset()). */
+enum boot_stage {
+  BOOT_MAIN,
+  BOOT_LWIP_INIT,
+  BOOT_FIRST_IP,
+  BOOT_STAGES
+};
+
+/* Record the time a stage was reached, only the first call counts. */
+void boot_stamp (enum boot_stage stage);
+
+int boot_stamped (enum boot_stage stage);
+
+/* Print the recorded stages in microseconds since reset. */
+void boot_report (void);
+
+#endif
@@ -0,0 +1,140 @@
+/* Alignment aware memcpy()/memset() for the ARM926EJ-S (little endian).
+ * Without __arm__ the bursts are plain C, so the same file can be tested
+ * on the build host (see test/test_fastmem.c). */
+
+#include <stdint.h>
+#include "fastmem.h"
+
+/* word access to byte buffers */
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+/* below this, setting up word copies does not pay off */
+#define FASTMEM_MIN 16U
+
+/* copy n / 32 cache lines, d must be word aligned, s too */
+static inline void copy_lines (uint8_t **d, const uint8_t **s, size_t lines)
+{
+#if defined(__arm__)
+  __asm__ __volatile__(
+    "1: ldmia %1!, {r3-r10}\n"
+    "subs %2, %2, #1\n"
+    "stmia %0!, {r3-r10}\n"
+    "bne 1b\n"
+    : "+r" (*d), "+r" (*s), "+r" (lines)
+    : : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+  word_t *wd = (word_t *)*d;
+  const word_t *ws = (const word_t *)*s;
+  while (lines--) {
+    wd[0] = ws[0]; wd[1] = ws[1]; wd[2] = ws[2]; wd[3] = ws[3];
+    wd[4] = ws[4]; wd[5] = ws[5]; wd[6] = ws[6]; wd[7] = ws[7];
+    wd += 8;
+    ws += 8;
+  }
+  *d = (uint8_t *)wd;
+  *s = (const uint8_t *)ws;
+#endif
+}
+
+/* fill n / 32 cache lines with w, d must be word aligned */
+static inline void fill_lines (uint8_t **d, uint32_t w, size_t lines)
+{
+#if defined(__arm__)
+  __asm__ __volatile__(
+    "mov r3, %2\n"
+    "mov r4, %2\n"
+    "mov r5, %2\n"
+    "mov r6, %2\n"
+    "mov r7, %2\n"
+    "mov r8, %2\n"
+    "mov r9, %2\n"
+    "mov r10, %2\n"
+    "1: subs %1, %1, #1\n"
+    "stmia %0!, {r3-r10}\n"
+    "bne 1b\n"
+    : "+r" (*d), "+r" (lines)
+    : "r" (w)
+    : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+  word_t *wd = (word_t *)*d;
+  while (lines--) {
+    wd[0] = w; wd[1] = w; wd[2] = w; wd[3] = w;
+    wd[4] = w; wd[5] = w; wd[6] = w; wd[7] = w;
+    wd += 8;
+  }
+  *d = (uint8_t *)wd;
+#endif
+}
+
+void *fast_memcpy (void *dst, const void *src, size_t n)
+{
+  uint8_t *d = dst;
+  const uint8_t *s = src;
+
+  if (n >= FASTMEM_MIN) {
+    /* align the destination */
+    while ((uintptr_t)d & 3U) {
+      *d++ = *s++;
+      n--;
+    }
+    if (((uintptr_t)s & 3U) == 0U) {
+      if (n >= 32U) {
+        copy_lines(&d, &s, n >> 5);
+        n &= 31U;
+      }
+      while (n >= 4U) {
+        *(word_t *)d = *(const word_t *)s;
+        d += 4;
+        s += 4;
+        n -= 4U;
+      }
+    } else {
+      /* Source is misaligned: read aligned words and merge two of them
+       * into each destination word. Only whole words that hold at least
+       * one source byte are read. */
+      const unsigned int sh = ((uintptr_t)s & 3U) * 8U;
+      const word_t *ws = (const word_t *)((uintptr_t)s & ~(uintptr_t)3U);
+      uint32_t lo = *ws++;
+      while (n >= 8U) {
+        uint32_t hi = *ws++;
+        *(word_t *)d = (lo >> sh) | (hi << (32U - sh));
+        lo = hi;
+        d += 4;
+        n -= 4U;
+      }
+      s = (const uint8_t *)ws - 4 + (sh >> 3);
+    }
+  }
+  while (n--) {
+    *d++ = *s++;
+  }
+  return dst;
+}
+
+void *fast_memset (void *dst, int c, size_t n)
+{
+  uint8_t *d = dst;
+  uint32_t w = (uint8_t)c;
+
+  if (n >= FASTMEM_MIN) {
+    while ((uintptr_t)d & 3U) {
+      *d++ = (uint8_t)c;
+      n--;
+    }
+    w |= w << 8;
+    w |= w << 16;
+    if (n >= 32U) {
+      fill_lines(&d, w, n >> 5);
+      n &= 31U;
+    }
+    while (n >= 4U) {
+      *(word_t *)d = w;
+      d += 4;
+      n -= 4U;
+    }
+  }
+  while (n--) {
+    *d++ = (uint8_t)c;
+  }
+  return dst;
+}
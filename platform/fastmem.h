@@ -0,0 +1,17 @@
+#ifndef __fastmem__
+#define __fastmem__
+
+#include <stddef.h>
+
+/* memcpy()/memset() replacements that move aligned data in 32 byte
+ * (one cache line) ldm/stm bursts and merge misaligned words with
+ * shifts instead of falling back to byte copies. lwIP uses them through
+ * MEMCPY/SMEMCPY in lwipopts.h. */
+void *fast_memcpy (void *dst, const void *src, size_t n);
+void *fast_memset (void *dst, int c, size_t n);
+
+/* Print fast_memcpy() against the C library memcpy() for packet sized
+ * copies at all alignments, in nanoseconds per call (target only). */
+void fastmem_bench (void);
+
+#endif
@@ -0,0 +1,126 @@
+/* Exception vectors and PL190 VIC dispatch for versatilepb. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "irq.h"
+#include "mmu.h"
+
+#define VIC_BASE        0x10140000UL
+#define VIC_IRQSTATUS   (*(volatile uint32_t *)(VIC_BASE + 0x000))
+#define VIC_INTSELECT   (*(volatile uint32_t *)(VIC_BASE + 0x00c))
+#define VIC_INTENABLE   (*(volatile uint32_t *)(VIC_BASE + 0x010))
+#define VIC_INTENCLEAR  (*(volatile uint32_t *)(VIC_BASE + 0x014))
+
+#define VIC_SOURCES 32U
+
+static irq_handler_t irq_handlers[VIC_SOURCES];
+
+/* "ldr pc, [pc, #24]" in each slot, followed by the eight targets. Unused
+ * exceptions stop in exception_halt so a debugger shows where we are. */
+extern const uint32_t vector_table[16];
+__asm__(
+  ".pushsection .text.vector_table, \"ax\"\n"
+  ".align 2\n"
+  "vector_table:\n"
+  ".rept 8\n"
+  "ldr pc, [pc, #24]\n"
+  ".endr\n"
+  ".word _Reset\n"			/* reset */
+  ".word exception_halt\n"		/* undefined instruction */
+  ".word exception_halt\n"		/* swi */
+  ".word exception_halt\n"		/* prefetch abort */
+  ".word exception_halt\n"		/* data abort */
+  ".word exception_halt\n"		/* reserved */
+  ".word irq_entry\n"			/* irq */
+  ".word exception_halt\n"		/* fiq */
+  ".popsection\n");
+
+__attribute__ ((naked,used)) static void exception_halt (void)
+{
+  __asm__ __volatile__("b .");
+}
+
+uint32_t irq_pc;
+uint32_t irq_lr;
+
+void irq_dispatch (uint32_t pc, uint32_t lr);
+
+void irq_dispatch (uint32_t pc, uint32_t lr)
+{
+  uint32_t pending;
+
+  irq_pc = pc;
+  irq_lr = lr;
+  while ((pending = VIC_IRQSTATUS) != 0U) {
+    unsigned int num = (unsigned int)__builtin_ctz(pending);
+    if (irq_handlers[num] != NULL) {
+      irq_handlers[num]();
+    } else {
+      /* nobody to clear it, keep it from firing forever */
+      VIC_INTENCLEAR = 1U << num;
+    }
+  }
+}
+
+/* Save the caller saved registers, pass the interrupted pc and the lr of
+ * the interrupted mode (read by briefly switching to it, user mode
+ * through system mode) to irq_dispatch(). Six words keep the IRQ stack
+ * 8-byte aligned. IRQs are not nested. */
+__asm__(
+  ".pushsection .text.irq_entry, \"ax\"\n"
+  ".align 2\n"
+  "irq_entry:\n"
+  "sub lr, lr, #4\n"
+  "stmfd sp!, {r0-r3, r12, lr}\n"
+  "mov r0, lr\n"
+  "mrs r2, spsr\n"
+  "and r2, r2, #0x1f\n"
+  "cmp r2, #0x10\n"
+  "moveq r2, #0x1f\n"
+  "orr r2, r2, #0xc0\n"
+  "msr cpsr_c, r2\n"
+  "mov r1, lr\n"
+  "msr cpsr_c, #0xd2\n"
+  "bl irq_dispatch\n"
+  "ldmfd sp!, {r0-r3, r12, pc}^\n"
+  ".popsection\n");
+
+void irq_init (void)
+{
+  uint32_t *dst;
+  unsigned int i;
+
+  VIC_INTENCLEAR = 0xffffffffU;
+  VIC_INTSELECT = 0U;
+
+  /* the vectors live at address 0, hide that from the compiler so it does
+   * not treat the copy as a NULL pointer access */
+  __asm__ __volatile__("mov %0, #0" : "=r" (dst));
+  for (i = 0U; i < 16U; i++) {
+    dst[i] = vector_table[i];
+  }
+  dcache_clean_range(dst, 16U * sizeof(uint32_t));
+  icache_invalidate_all();
+
+  /* IRQ mode stack from layout.ld, then back to SVC mode with IRQs on */
+  __asm__ __volatile__(
+    "msr cpsr_c, #0xd2\n"
+    "ldr sp, =irq_stack_top\n"
+    "msr cpsr_c, #0x53\n"
+    : : : "memory");
+}
+
+void irq_register (unsigned int num, irq_handler_t handler)
+{
+  if (num < VIC_SOURCES) {
+    irq_handlers[num] = handler;
+    VIC_INTENABLE = 1U << num;
+  }
+}
+
+void irq_disable (unsigned int num)
+{
+  if (num < VIC_SOURCES) {
+    VIC_INTENCLEAR = 1U << num;
+  }
+}
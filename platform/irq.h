@@ -0,0 +1,46 @@
+#ifndef __irq__
+#define __irq__
+
+#include <stdint.h>
+
+/* versatilepb primary interrupt controller (PL190) sources */
+#define IRQ_TIMER01  4
+#define IRQ_TIMER23  5
+#define IRQ_UART0   12
+
+typedef void (*irq_handler_t) (void);
+
+/* Install the exception vectors at address 0, set up the IRQ mode stack
+ * and unmask IRQs in the CPU. All VIC sources start disabled. */
+void irq_init (void);
+
+/* Call handler from the IRQ exception while source num is pending and
+ * enable it in the VIC. */
+void irq_register (unsigned int num, irq_handler_t handler);
+
+void irq_disable (unsigned int num);
+
+/* Where the current interrupt hit: the interrupted pc and the lr of the
+ * interrupted code. Valid inside handlers. */
+extern uint32_t irq_pc;
+extern uint32_t irq_lr;
+
+/* Mask IRQs in the CPU, returns the previous state for irq_restore(). */
+static inline uint32_t irq_save (void)
+{
+  uint32_t cpsr, tmp;
+
+  __asm__ __volatile__(
+    "mrs %0, cpsr\n"
+    "orr %1, %0, #0x80\n"
+    "msr cpsr_c, %1\n"
+    : "=r" (cpsr), "=r" (tmp) : : "memory");
+  return cpsr;
+}
+
+static inline void irq_restore (uint32_t cpsr)
+{
+  __asm__ __volatile__("msr cpsr_c, %0" : : "r" (cpsr) : "memory");
+}
+
+#endif
@@ -0,0 +1,120 @@
+/* MMU and cache setup for the ARM926EJ-S on versatilepb. */
+
+#include <stdint.h>
+#include "mmu.h"
+
+/* first level descriptor of a 1MB section (bit 4 must be one on ARMv5) */
+#define SECTION           0x12U
+#define SECTION_B         (1U << 2)		/* bufferable */
+#define SECTION_C         (1U << 3)		/* cacheable */
+#define SECTION_AP_RW     (3U << 10)		/* read/write in all modes */
+#define SECTION_DOMAIN(d) ((uint32_t)(d) << 5)
+
+/* CP15 c1 control register bits */
+#define CR_M (1U << 0)				/* MMU */
+#define CR_C (1U << 2)				/* D-cache */
+#define CR_I (1U << 12)				/* I-cache */
+
+/* Domain access control: domain 0 is "client", permissions are checked */
+#define DACR_CLIENT_D0 1U
+
+/* versatilepb has up to 256MB of SDRAM at address 0. Everything above
+ * (system registers, LAN91C111 at 0x10010000, VIC at 0x10140000,
+ * timers at 0x101e2000, UARTs at 0x101f1000, flash, ...) is mapped
+ * strongly ordered: uncached and unbuffered. */
+#define SDRAM_MB 256U
+
+/* one word per MB of address space, must be 16KB aligned. Kept out of
+ * BSS since mmu_init() runs before BSS is cleared. */
+static uint32_t ttb[4096] __attribute__((section(".ttb"), aligned(16384)));
+
+void mmu_init (void)
+{
+  unsigned int i;
+  uint32_t cr;
+
+  for (i = 0U; i < 4096U; i++) {
+    uint32_t desc = ((uint32_t)i << 20) | SECTION | SECTION_AP_RW | SECTION_DOMAIN(0);
+    if (i < SDRAM_MB) {
+      /* write-back cacheable */
+      desc |= SECTION_C | SECTION_B;
+    }
+    ttb[i] = desc;
+  }
+
+  __asm__ __volatile__(
+    "mcr p15, 0, %0, c7, c7, 0\n"		/* invalidate I- and D-cache */
+    "mcr p15, 0, %0, c7, c10, 4\n"		/* drain write buffer */
+    "mcr p15, 0, %0, c8, c7, 0\n"		/* invalidate TLBs */
+    "mcr p15, 0, %1, c2, c0, 0\n"		/* translation table base */
+    "mcr p15, 0, %2, c3, c0, 0\n"		/* domain access control */
+    : : "r" (0U), "r" (ttb), "r" (DACR_CLIENT_D0) : "memory");
+
+  /* the map is flat, so execution simply continues after enabling */
+  __asm__ __volatile__("mrc p15, 0, %0, c1, c0, 0" : "=r" (cr));
+  cr |= CR_M | CR_C | CR_I;
+  __asm__ __volatile__("mcr p15, 0, %0, c1, c0, 0" : : "r" (cr) : "memory");
+}
+
+static inline void drain_write_buffer (void)
+{
+  __asm__ __volatile__("mcr p15, 0, %0, c7, c10, 4" : : "r" (0U) : "memory");
+}
+
+void dcache_clean_range (const void *addr, size_t len)
+{
+  uintptr_t p = (uintptr_t)addr & ~(uintptr_t)(CACHE_LINE_SIZE - 1U);
+  uintptr_t end = (uintptr_t)addr + len;
+
+  for (; p < end; p += CACHE_LINE_SIZE) {
+    __asm__ __volatile__("mcr p15, 0, %0, c7, c10, 1" : : "r" (p) : "memory");
+  }
+  drain_write_buffer();
+}
+
+void dcache_invalidate_range (const void *addr, size_t len)
+{
+  uintptr_t p = (uintptr_t)addr;
+  uintptr_t end = (uintptr_t)addr + len;
+
+  if (p & (CACHE_LINE_SIZE - 1U)) {
+    /* partial first line: clean and invalidate */
+    p &= ~(uintptr_t)(CACHE_LINE_SIZE - 1U);
+    __asm__ __volatile__("mcr p15, 0, %0, c7, c14, 1" : : "r" (p) : "memory");
+    p += CACHE_LINE_SIZE;
+  }
+  if ((end & (CACHE_LINE_SIZE - 1U)) && end > p) {
+    /* partial last line: clean and invalidate */
+    end &= ~(uintptr_t)(CACHE_LINE_SIZE - 1U);
+    __asm__ __volatile__("mcr p15, 0, %0, c7, c14, 1" : : "r" (end) : "memory");
+  }
+  for (; p < end; p += CACHE_LINE_SIZE) {
+    __asm__ __volatile__("mcr p15, 0, %0, c7, c6, 1" : : "r" (p) : "memory");
+  }
+  drain_write_buffer();
+}
+
+void dcache_flush_range (const void *addr, size_t len)
+{
+  uintptr_t p = (uintptr_t)addr & ~(uintptr_t)(CACHE_LINE_SIZE - 1U);
+  uintptr_t end = (uintptr_t)addr + len;
+
+  for (; p < end; p += CACHE_LINE_SIZE) {
+    __asm__ __volatile__("mcr p15, 0, %0, c7, c14, 1" : : "r" (p) : "memory");
+  }
+  drain_write_buffer();
+}
+
+void dcache_flush_all (void)
+{
+  /* "test, clean and invalidate" loops until no dirty line is left */
+  __asm__ __volatile__(
+    "1: mrc p15, 0, APSR_nzcv, c7, c14, 3\n"
+    "bne 1b\n" : : : "cc", "memory");
+  drain_write_buffer();
+}
+
+void icache_invalidate_all (void)
+{
+  __asm__ __volatile__("mcr p15, 0, %0, c7, c5, 0" : : "r" (0U) : "memory");
+}
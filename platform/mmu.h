@@ -0,0 +1,32 @@
+#ifndef __mmu__
+#define __mmu__
+
+#include <stddef.h>
+
+/* ARM926EJ-S data and instruction cache line size */
+#define CACHE_LINE_SIZE 32U
+
+/* Build a flat 1MB section map (SDRAM cached, peripherals strongly
+ * ordered) and enable MMU, I-cache and D-cache. Called from _Reset()
+ * before .data and .bss are set up. */
+void mmu_init (void);
+
+/* Write dirty lines of [addr, addr + len) back to memory, e.g. before
+ * a DMA engine reads a TX buffer. */
+void dcache_clean_range (const void *addr, size_t len);
+
+/* Discard [addr, addr + len) from the D-cache, e.g. before the CPU reads
+ * a buffer a DMA engine has written. Partial lines at both ends are
+ * cleaned first so neighbouring data is not lost. */
+void dcache_invalidate_range (const void *addr, size_t len);
+
+/* Clean and invalidate [addr, addr + len). */
+void dcache_flush_range (const void *addr, size_t len);
+
+/* Clean and invalidate the whole D-cache. */
+void dcache_flush_all (void);
+
+/* Invalidate the whole I-cache, e.g. after code was loaded or patched. */
+void icache_invalidate_all (void);
+
+#endif
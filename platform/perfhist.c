@@ -0,0 +1,80 @@
+/* Per site latency statistics for PERF_START/PERF_STOP. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "perfhist.h"
+
+static struct perf_site perf_sites[PERF_SITES];
+static unsigned int perf_nsites;
+
+struct perf_site *perf_site (const char *name)
+{
+  unsigned int i;
+
+  for (i = 0U; i < perf_nsites; i++) {
+    if (strcmp(perf_sites[i].name, name) == 0) {
+      return &perf_sites[i];
+    }
+  }
+  if (perf_nsites == PERF_SITES) {
+    return NULL;
+  }
+  perf_sites[perf_nsites].name = name;
+  return &perf_sites[perf_nsites++];
+}
+
+void perf_record (struct perf_site *site, uint32_t us)
+{
+  unsigned int bucket;
+
+  if (site == NULL) {
+    return;
+  }
+  site->count++;
+  site->total += us;
+  if (us > site->max) {
+    site->max = us;
+  }
+  /* bucket n holds [2^(n-1), 2^n) */
+  bucket = us == 0U ? 0U : 32U - (unsigned int)__builtin_clz(us);
+  if (bucket >= PERF_BUCKETS) {
+    bucket = PERF_BUCKETS - 1U;
+  }
+  site->hist[bucket]++;
+}
+
+void perf_dump (void)
+{
+  unsigned int i, b;
+
+  printf("%-20s %10s %10s %8s %8s  histogram (us:count)\n",
+         "site", "calls", "total ms", "avg us", "max us");
+  for (i = 0U; i < perf_nsites; i++) {
+    const struct perf_site *site = &perf_sites[i];
+
+    /* newlib nano has no %llu */
+    printf("%-20s %10lu %10lu %8lu %8lu ", site->name, (unsigned long)site->count,
+           (unsigned long)(site->total / 1000U),
+           (unsigned long)(site->count ? site->total / site->count : 0U),
+           (unsigned long)site->max);
+    for (b = 0U; b < PERF_BUCKETS; b++) {
+      if (site->hist[b] != 0U) {
+        printf(" %lu:%lu", b == 0U ? 0UL : 1UL << (b - 1U), (unsigned long)site->hist[b]);
+      }
+    }
+    printf("\n");
+  }
+}
+
+void perf_reset (void)
+{
+  unsigned int i;
+
+  for (i = 0U; i < perf_nsites; i++) {
+    const char *name = perf_sites[i].name;
+    memset(&perf_sites[i], 0, sizeof(perf_sites[i]));
+    perf_sites[i].name = name;
+  }
+}
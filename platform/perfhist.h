@@ -0,0 +1,48 @@
+#ifndef __perfhist__
+#define __perfhist__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "timer.h"
+
+/* Distinct PERF_STOP() names that can be recorded. */
+#ifndef PERF_SITES
+#define PERF_SITES 16U
+#endif
+
+/* Latency histogram buckets: 0us, 1us, 2-3us, 4-7us, ... and the last
+ * one collects everything from 2^(PERF_BUCKETS-2) microseconds up. */
+#define PERF_BUCKETS 16U
+
+struct perf_site {
+  const char *name;
+  uint32_t count;
+  uint32_t max;
+  uint64_t total;
+  uint32_t hist[PERF_BUCKETS];
+};
+
+/* Time from PERF_START to PERF_STOP(name) in microseconds of timer 0.
+ * One PERF_START per scope; several PERF_STOP() with the same name add
+ * up in one site. Used by lwIP through arch/perf.h (LWIP_PERF) and by
+ * the probes in app.c. Not for interrupt handlers. */
+#define PERF_START uint32_t perf_start_ = timer_us()
+#define PERF_STOP(x) do { \
+    static struct perf_site *perf_site_; \
+    if (perf_site_ == NULL) { \
+      perf_site_ = perf_site(x); \
+    } \
+    perf_record(perf_site_, timer_us() - perf_start_); \
+  } while (0)
+
+/* Site of that name, registered on first use. NULL if all are taken. */
+struct perf_site *perf_site (const char *name);
+
+void perf_record (struct perf_site *site, uint32_t us);
+
+/* Print calls, total, average, maximum and the histogram of each site. */
+void perf_dump (void);
+
+void perf_reset (void);
+
+#endif
@@ -0,0 +1,87 @@
+/* PC sampling profiler on SP804 timer 1 of versatilepb.
+ *
+ * Timer 0 is the free running clock of timer.h and has no interrupt
+ * enabled, so timer 1 can use the shared TIMER01 interrupt alone. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "irq.h"
+#include "uart.h"
+#include "profiler.h"
+
+/* system controller: timer 1 clock select, 1 = 1MHz TIMCLK */
+#define SCCTRL              (*(volatile uint32_t *)0x101e0000UL)
+#define SCCTRL_TIMEREN1SEL  (1U << 17)
+
+#define TIMER1_LOAD         (*(volatile uint32_t *)0x101e2020UL)
+#define TIMER1_CONTROL      (*(volatile uint32_t *)0x101e2028UL)
+#define TIMER1_INTCLR       (*(volatile uint32_t *)0x101e202cUL)
+#define TIMER_CTRL_32BIT    (1U << 1)
+#define TIMER_CTRL_IE       (1U << 5)
+#define TIMER_CTRL_PERIODIC (1U << 6)
+#define TIMER_CTRL_ENABLE   (1U << 7)
+
+#if (PROF_SAMPLES & (PROF_SAMPLES - 1U))
+#error "PROF_SAMPLES must be a power of two"
+#endif
+
+static struct prof_sample prof_buf[PROF_SAMPLES];
+/* samples taken since prof_start() */
+static volatile uint32_t prof_head;
+static volatile int prof_on;
+
+static void prof_irq (void)
+{
+  struct prof_sample *s = &prof_buf[prof_head & (PROF_SAMPLES - 1U)];
+
+  TIMER1_INTCLR = 1U;
+  s->pc = irq_pc;
+  s->lr = irq_lr;
+  prof_head++;
+}
+
+void prof_start (void)
+{
+  prof_stop();
+  prof_head = 0U;
+  SCCTRL |= SCCTRL_TIMEREN1SEL;
+  TIMER1_LOAD = PROF_PERIOD_US;
+  TIMER1_INTCLR = 1U;
+  irq_register(IRQ_TIMER01, prof_irq);
+  TIMER1_CONTROL = TIMER_CTRL_ENABLE | TIMER_CTRL_PERIODIC | TIMER_CTRL_IE | TIMER_CTRL_32BIT;
+  prof_on = 1;
+}
+
+void prof_stop (void)
+{
+  TIMER1_CONTROL = 0U;
+  TIMER1_INTCLR = 1U;
+  irq_disable(IRQ_TIMER01);
+  prof_on = 0;
+}
+
+int prof_running (void)
+{
+  return prof_on;
+}
+
+void prof_dump (void)
+{
+  enum uart_tx_policy policy;
+  uint32_t head;
+  uint32_t i;
+
+  /* do not sample the dump itself */
+  prof_stop();
+  policy = uart_set_tx_policy(UART_TX_BLOCK);
+  head = prof_head;
+  i = head > PROF_SAMPLES ? head - PROF_SAMPLES : 0U;
+
+  printf("prof: begin %lu %lu %u\n", (unsigned long)(head - i), (unsigned long)head, PROF_PERIOD_US);
+  for (; i != head; i++) {
+    const struct prof_sample *s = &prof_buf[i & (PROF_SAMPLES - 1U)];
+    printf("prof: %08lx %08lx\n", (unsigned long)s->pc, (unsigned long)s->lr);
+  }
+  printf("prof: end\n");
+  uart_set_tx_policy(policy);
+}
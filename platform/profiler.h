@@ -0,0 +1,34 @@
+#ifndef __profiler__
+#define __profiler__
+
+#include <stdint.h>
+
+/* Samples kept, a power of two. Older samples are overwritten. */
+#ifndef PROF_SAMPLES
+#define PROF_SAMPLES 4096U
+#endif
+
+/* Sampling period of timer 1. Not a round number, so sampling does not
+ * run in lockstep with millisecond timers. */
+#ifndef PROF_PERIOD_US
+#define PROF_PERIOD_US 997U
+#endif
+
+struct prof_sample {
+  uint32_t pc;
+  uint32_t lr;
+};
+
+/* Start sampling the interrupted pc and lr from the timer 1 interrupt.
+ * Clears previous samples. Needs irq_init(). */
+void prof_start (void);
+
+void prof_stop (void);
+
+int prof_running (void);
+
+/* Stop sampling and print the samples as "prof: <pc> <lr>" lines for
+ * tools/prof_report.py. */
+void prof_dump (void);
+
+#endif
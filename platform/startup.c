@@ -3,16 +3,68 @@ __attribute__ ((naked,used)) void _Reset (void)
 	/* setup stack pointer */
 	__asm__ __volatile__("ldr sp, =stack_top");
 
-	/* clear BSS */
+	/* start the boot clock */
+	__asm__ __volatile__("bl timer_init");
+
+	/* page table is not part of BSS: enable MMU and caches first */
+	__asm__ __volatile__("bl mmu_init");
+
+	/* copy .data from its load address, unless it is run in place */
+	__asm__ __volatile__(
+		"ldr r0, =__data_start__\n"
+		"ldr r1, =__data_end__\n"
+		"ldr r2, =__data_load__\n"
+		"cmp r0, r2\n"
+		"beq data_copy_done\n"
+	"data_copy_burst:\n"
+		"sub r3, r1, r0\n"
+		"cmp r3, #16\n"
+		"blo data_copy_loop\n"
+		"ldmia r2!, {r3-r6}\n"
+		"stmia r0!, {r3-r6}\n"
+		"b data_copy_burst\n"
+	"data_copy_loop:\n"
+		"cmp r0, r1\n"
+		"ldrlo r3, [r2], #4\n"
+		"strlo r3, [r0], #4\n"
+		"blo data_copy_loop\n"
+	"data_copy_done:\n");
+
+	/* clear BSS, one cache line (8 words) per store */
         __asm__ __volatile__(
 		"ldr r0, =__bss_start__\n"
-		"ldr r1, =end\n"
+		"ldr r1, =__bss_end__\n"
 		"mov r2, #0\n"
+		"mov r3, #0\n"
+		"mov r4, #0\n"
+		"mov r5, #0\n"
+		"mov r6, #0\n"
+		"mov r7, #0\n"
+		"mov r8, #0\n"
+		"mov r9, #0\n"
+	"bss_clear_burst:\n"
+		"sub r10, r1, r0\n"
+		"cmp r10, #32\n"
+		"blo bss_clear_loop\n"
+		"stmia r0!, {r2-r9}\n"
+		"b bss_clear_burst\n"
 	"bss_clear_loop:\n"
 		"cmp r0, r1\n"
 		"strlo r2, [r0], #4\n"
 		"blo bss_clear_loop\n");
 
+	/* C constructors */
+	__asm__ __volatile__(
+		"ldr r4, =__init_array_start\n"
+		"ldr r5, =__init_array_end\n"
+	"init_array_loop:\n"
+		"cmp r4, r5\n"
+		"bhs init_array_done\n"
+		"ldr r3, [r4], #4\n"
+		"blx r3\n"
+		"b init_array_loop\n"
+	"init_array_done:\n");
+
 	/* main() */
 	__asm__ __volatile__("bl main");
 
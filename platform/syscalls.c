@@ -1,14 +1,7 @@
 #include <sys/stat.h>
 #include <stdio.h>
 #include <unistd.h>
-
-enum {
- UART_FR_RXFE = 0x10,
- UART0_ADDR = 0x101f1000
-};
-
-#define UART_DR(baseaddr) (*(unsigned int *)(baseaddr))
-#define UART_FR(baseaddr) (*(((unsigned int *)(baseaddr))+6))
+#include "uart.h"
 
 int _close(int file __unused) { return -1; }
 
@@ -24,18 +17,12 @@ int _lseek(int file __unused, int ptr __unused, int dir __unused) { return 0; }
 int _open(const char *name __unused, int flags __unused, int mode __unused) { return -1; }
 
 int _read(int file __unused, char *ptr, int len) {
- int todo;
+ int n;
  if(len == 0)
   return 0;
- while(UART_FR(UART0_ADDR) & UART_FR_RXFE);
- *ptr++ = UART_DR(UART0_ADDR);
- for(todo = 1; todo < len; todo++) {
-  if(UART_FR(UART0_ADDR) & UART_FR_RXFE) {
-   break;
-  }
-  *ptr++ = UART_DR(UART0_ADDR);
- }
- return todo;
+ /* stdio wants at least one byte, use uart_read() to poll */
+ while((n = uart_read(ptr, len)) == 0);
+ return n;
 }
 
 extern char heap_low; /* Defined by the linker */
@@ -54,12 +41,7 @@ caddr_t _sbrk(int incr) {
  }
 
 int _write(int file __unused, char *ptr, int len) {
- int todo;
-
- for (todo = 0; todo < len; todo++) {
-  UART_DR(UART0_ADDR) = *ptr++;
- }
- return len;
+ return uart_write(ptr, len);
 }
 
 __dead2 void abort (void)
@@ -74,6 +56,7 @@ __dead2 void abort (void)
 #endif
 
   printf("Abort called from instruction address 0x%lx.\n", addr);
+  uart_flush();
 
   _exit(1);
 }
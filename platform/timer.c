@@ -0,0 +1,42 @@
+/* SP804 timer 0 of versatilepb as free running microsecond clock. */
+
+#include <stdint.h>
+#include "timer.h"
+
+/* system controller: timer 0 clock select, 1 = 1MHz TIMCLK */
+#define SCCTRL              (*(volatile uint32_t *)0x101e0000UL)
+#define SCCTRL_TIMEREN0SEL  (1U << 15)
+
+#define TIMER0_LOAD         (*(volatile uint32_t *)0x101e2000UL)
+#define TIMER0_CONTROL      (*(volatile uint32_t *)0x101e2008UL)
+#define TIMER_CTRL_32BIT    (1U << 1)
+#define TIMER_CTRL_ENABLE   (1U << 7)
+
+void timer_init (void)
+{
+  SCCTRL |= SCCTRL_TIMEREN0SEL;
+  TIMER0_CONTROL = 0U;
+  TIMER0_LOAD = 0xffffffffU;
+  /* free running, no interrupt, no prescaler */
+  TIMER0_CONTROL = TIMER_CTRL_ENABLE | TIMER_CTRL_32BIT;
+}
+
+#if !USE_FREERTOS
+/* lwIP's millisecond clock. Timer 0 wraps after about 71 minutes, which is
+ * not a multiple of a millisecond wrap, so milliseconds are accumulated
+ * from the elapsed microseconds instead of divided down. Needs to be
+ * called at least once per timer wrap, the main loop does that. */
+uint32_t sys_now (void)
+{
+  static uint32_t last_us;
+  static uint32_t rest_us;
+  static uint32_t now_ms;
+  uint32_t us = timer_us();
+  uint32_t elapsed = us - last_us + rest_us;
+
+  last_us = us;
+  now_ms += elapsed / 1000U;
+  rest_us = elapsed % 1000U;
+  return now_ms;
+}
+#endif
@@ -0,0 +1,35 @@
+#ifndef __timer__
+#define __timer__
+
+#include <stdint.h>
+
+#if USE_HOST
+#include <time.h>
+
+/* host build (make host): the monotonic clock stands in for timer 0 */
+static inline uint32_t timer_us (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)ts.tv_sec * 1000000U + (uint32_t)(ts.tv_nsec / 1000);
+}
+#else
+/* versatilepb SP804 timer 0 value register, counting down at 1MHz */
+#define TIMER0_VALUE (*(volatile uint32_t *)0x101e2004UL)
+
+/* Start timer 0 free running from 0xffffffff. Called first thing in
+ * _Reset(), so it must not use .data or .bss. */
+void timer_init (void);
+
+/* Microseconds since reset, wraps after about 71 minutes. */
+static inline uint32_t timer_us (void)
+{
+  return ~TIMER0_VALUE;
+}
+
+/* Milliseconds since reset for lwIP timeouts, see lwip/sys.h. */
+uint32_t sys_now (void);
+#endif
+
+#endif
@@ -0,0 +1,161 @@
+/* Binary trace ring: printf() style records stored without formatting. */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "irq.h"
+#include "timer.h"
+#include "uart.h"
+#include "trace.h"
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+#if (TRACE_RECORDS & (TRACE_RECORDS - 1U))
+#error "TRACE_RECORDS must be a power of two"
+#endif
+
+static struct trace_record trace_buf[TRACE_RECORDS] __attribute__((aligned(32)));
+/* records written since reset, the next one goes to trace_head % TRACE_RECORDS */
+static volatile uint32_t trace_head;
+
+void trace_write (unsigned int nargs, unsigned int wide, const char *fmt, ...)
+{
+  struct trace_record *rec;
+  va_list ap;
+  unsigned int i;
+  unsigned int w;
+  uint32_t cpsr;
+  uint32_t n;
+  uint64_t v;
+
+  /* interrupt handlers may trace as well */
+  cpsr = irq_save();
+  n = trace_head;
+  trace_head = n + 1U;
+  irq_restore(cpsr);
+
+  rec = &trace_buf[n & (TRACE_RECORDS - 1U)];
+  rec->fmt = fmt;
+  rec->ts = timer_us();
+  /* int, char, short and pointers are passed as 32-bit words, 64-bit
+   * arguments are stored low word first in two slots */
+  va_start(ap, fmt);
+  for (i = 0U, w = 0U; i < nargs && w < TRACE_MAX_ARGS; i++) {
+    if (wide & (1U << i)) {
+      v = va_arg(ap, uint64_t);
+      rec->args[w++] = (uint32_t)v;
+      if (w < TRACE_MAX_ARGS) {
+        rec->args[w++] = (uint32_t)(v >> 32);
+      }
+    } else {
+      rec->args[w++] = va_arg(ap, unsigned int);
+    }
+  }
+  va_end(ap);
+}
+
+/* Oldest sequence number still in the ring. */
+static uint32_t trace_first (uint32_t head)
+{
+  return head > TRACE_RECORDS ? head - TRACE_RECORDS : 0U;
+}
+
+void trace_dump (void)
+{
+  enum uart_tx_policy policy = uart_set_tx_policy(UART_TX_BLOCK);
+  uint32_t head = trace_head;
+  uint32_t seq;
+  unsigned int i;
+
+  printf("trace: begin %lu %u\n", (unsigned long)(head - trace_first(head)), TRACE_MAX_ARGS);
+  for (seq = trace_first(head); seq != head; seq++) {
+    const struct trace_record *rec = &trace_buf[seq & (TRACE_RECORDS - 1U)];
+    printf("trace: %08lx %08lx %08lx", (unsigned long)seq, (unsigned long)rec->ts,
+           (unsigned long)(uintptr_t)rec->fmt);
+    for (i = 0U; i < TRACE_MAX_ARGS; i++) {
+      printf(" %08lx", (unsigned long)rec->args[i]);
+    }
+    printf("\n");
+  }
+  printf("trace: end\n");
+  uart_set_tx_policy(policy);
+}
+
+#if LWIP_UDP
+
+/* Little endian like the records. A request may carry the first sequence
+ * number wanted (4 bytes), the reply covers it up to the newest record in
+ * as many datagrams as needed. */
+struct trace_udp_hdr {
+  char magic[4];		/* "LWTR" */
+  uint32_t seq;			/* sequence number of the first record */
+  uint32_t head;		/* records written since reset */
+  uint16_t count;		/* records in this datagram */
+  uint8_t nargs;		/* TRACE_MAX_ARGS */
+  uint8_t rec_size;		/* sizeof(struct trace_record) */
+};
+
+#define TRACE_UDP_RECORDS 40U
+
+static void trace_udp_recv (void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            const ip_addr_t *addr, u16_t port)
+{
+  struct trace_udp_hdr hdr;
+  uint32_t head = trace_head;
+  uint32_t seq = trace_first(head);
+  uint32_t from;
+
+  LWIP_UNUSED_ARG(arg);
+  if (pbuf_copy_partial(p, &from, sizeof(from), 0) == sizeof(from) &&
+      from > seq && from <= head) {
+    seq = from;
+  }
+  pbuf_free(p);
+
+  memcpy(hdr.magic, "LWTR", sizeof(hdr.magic));
+  hdr.head = head;
+  hdr.nargs = TRACE_MAX_ARGS;
+  hdr.rec_size = sizeof(struct trace_record);
+  do {
+    uint32_t count = head - seq;
+    uint32_t i;
+    struct pbuf *q;
+
+    if (count > TRACE_UDP_RECORDS) {
+      count = TRACE_UDP_RECORDS;
+    }
+    q = pbuf_alloc(PBUF_TRANSPORT, (u16_t)(sizeof(hdr) + count * sizeof(struct trace_record)), PBUF_RAM);
+    if (q == NULL) {
+      return;
+    }
+    hdr.seq = seq;
+    hdr.count = (uint16_t)count;
+    memcpy(q->payload, &hdr, sizeof(hdr));
+    for (i = 0U; i < count; i++) {
+      memcpy((uint8_t *)q->payload + sizeof(hdr) + i * sizeof(struct trace_record),
+             &trace_buf[(seq + i) & (TRACE_RECORDS - 1U)], sizeof(struct trace_record));
+    }
+    (void)udp_sendto(pcb, q, addr, port);
+    pbuf_free(q);
+    seq += count;
+  } while (seq != head);
+}
+
+void trace_udp_init (void)
+{
+  struct udp_pcb *pcb = udp_new();
+
+  if (pcb == NULL) {
+    return;
+  }
+  if (udp_bind(pcb, IP_ANY_TYPE, TRACE_UDP_PORT) != ERR_OK) {
+    udp_remove(pcb);
+    return;
+  }
+  udp_recv(pcb, trace_udp_recv, NULL);
+}
+
+#endif /* LWIP_UDP */
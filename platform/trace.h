@@ -0,0 +1,67 @@
+#ifndef __trace__
+#define __trace__
+
+#include <stdint.h>
+
+/* Number of records kept, a power of two. Older records are overwritten. */
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS 1024U
+#endif
+
+/* Argument words stored per record, further ones are not recorded. With
+ * six, a record fills one 32-byte cache line. */
+#define TRACE_MAX_ARGS 6U
+
+/* UDP port trace_udp_init() answers on. */
+#ifndef TRACE_UDP_PORT
+#define TRACE_UDP_PORT 7777U
+#endif
+
+/* A printf() call that is not formatted: the format pointer, the time in
+ * microseconds and the raw 32-bit arguments are stored in RAM and
+ * tools/trace_decode.py renders them later from the format strings in
+ * obj/app.elf. The format must therefore be a string literal, and "%s"
+ * arguments are only shown if they point into the image. */
+struct trace_record {
+  const char *fmt;
+  uint32_t ts;
+  uint32_t args[TRACE_MAX_ARGS];
+};
+
+/* counts up to 16 arguments after the format, as used by ethernet.c */
+#define TRACE_NARGS(...) \
+  TRACE_NARGS_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define TRACE_NARGS_(fmt, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, \
+                     a13, a14, a15, a16, n, ...) n
+
+/* Bit i set if argument i is passed as 64 bits (long long, uint64_t).
+ * Those take two words in the record and need their own va_arg()
+ * because of the 8-byte alignment in the argument list. The conditional
+ * applies the same promotions as the call, so arrays and string literals
+ * count as pointers. */
+#define TRACE_WIDE(...) \
+  TRACE_WIDE_(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+#define TRACE_WIDE_(fmt, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, \
+                    a13, a14, a15, a16, ...) \
+  (TRACE_W_(a1, 0) | TRACE_W_(a2, 1) | TRACE_W_(a3, 2) | TRACE_W_(a4, 3) | \
+   TRACE_W_(a5, 4) | TRACE_W_(a6, 5) | TRACE_W_(a7, 6) | TRACE_W_(a8, 7) | \
+   TRACE_W_(a9, 8) | TRACE_W_(a10, 9) | TRACE_W_(a11, 10) | \
+   TRACE_W_(a12, 11) | TRACE_W_(a13, 12) | TRACE_W_(a14, 13) | \
+   TRACE_W_(a15, 14) | TRACE_W_(a16, 15))
+#define TRACE_W_(a, i) ((sizeof(1 ? (a) : (a)) > 4U ? 1U : 0U) << (i))
+
+/* TRACE("tx %u bytes\n", len) */
+#define TRACE(...) \
+  trace_write(TRACE_NARGS(__VA_ARGS__), TRACE_WIDE(__VA_ARGS__), __VA_ARGS__)
+
+void trace_write (unsigned int nargs, unsigned int wide, const char *fmt, ...);
+
+/* Print the ring as hex lines ("trace: ...") on the console for
+ * tools/trace_decode.py, waiting for the UART instead of dropping. */
+void trace_dump (void);
+
+/* Answer each datagram on TRACE_UDP_PORT with the records in the ring,
+ * see tools/trace_decode.py for the format. */
+void trace_udp_init (void);
+
+#endif
@@ -0,0 +1,198 @@
+/* Interrupt driven PL011 UART0 console for versatilepb.
+ *
+ * TX and RX each use a single producer/single consumer ring with free
+ * running indices. Each index is written by one side only, so the ring
+ * itself needs no lock. The TX ring is drained by the TX interrupt; the
+ * short sections that also feed the FIFO from thread context run with
+ * IRQs masked, which makes the interrupt handler and uart_tx_kick() one
+ * consumer. */
+
+#include <stdint.h>
+#include "irq.h"
+#include "uart.h"
+
+#define UART0_BASE      0x101f1000UL
+#define UART_DR         (*(volatile uint32_t *)(UART0_BASE + 0x000))
+#define UART_FR         (*(volatile uint32_t *)(UART0_BASE + 0x018))
+#define UART_LCR_H      (*(volatile uint32_t *)(UART0_BASE + 0x02c))
+#define UART_CR         (*(volatile uint32_t *)(UART0_BASE + 0x030))
+#define UART_IFLS       (*(volatile uint32_t *)(UART0_BASE + 0x034))
+#define UART_IMSC       (*(volatile uint32_t *)(UART0_BASE + 0x038))
+#define UART_MIS        (*(volatile uint32_t *)(UART0_BASE + 0x040))
+#define UART_ICR        (*(volatile uint32_t *)(UART0_BASE + 0x044))
+
+#define UART_DR_OE      (1U << 11)
+#define UART_FR_RXFE    (1U << 4)
+#define UART_FR_TXFF    (1U << 5)
+#define UART_LCR_H_FEN  (1U << 4)
+#define UART_LCR_H_WLEN8 (3U << 5)
+#define UART_CR_UARTEN  (1U << 0)
+#define UART_CR_TXE     (1U << 8)
+#define UART_CR_RXE     (1U << 9)
+#define UART_INT_RX     (1U << 4)
+#define UART_INT_TX     (1U << 5)
+#define UART_INT_RT     (1U << 6)
+#define UART_INT_OE     (1U << 10)
+
+/* bytes written into the FIFO per call, keeps IRQ masked sections short */
+#define UART_FIFO_DEPTH 16U
+
+#if (UART_TX_BUF_SIZE & (UART_TX_BUF_SIZE - 1U)) || (UART_RX_BUF_SIZE & (UART_RX_BUF_SIZE - 1U))
+#error "UART_TX_BUF_SIZE and UART_RX_BUF_SIZE must be powers of two"
+#endif
+
+struct uart_stats uart_stats;
+
+static char tx_buf[UART_TX_BUF_SIZE];
+static volatile uint32_t tx_head;	/* written by uart_write() */
+static volatile uint32_t tx_tail;	/* written with IRQs masked */
+
+static char rx_buf[UART_RX_BUF_SIZE];
+static volatile uint32_t rx_head;	/* written by the interrupt handler */
+static volatile uint32_t rx_tail;	/* written by uart_read() */
+
+static enum uart_tx_policy tx_policy = UART_TX_POLICY_DEFAULT;
+
+/* Move queued bytes into the FIFO. Caller has IRQs masked. */
+static void uart_tx_fill (void)
+{
+  uint32_t tail = tx_tail;
+  uint32_t head = tx_head;
+  unsigned int n;
+
+  for (n = 0U; n < UART_FIFO_DEPTH && tail != head; n++) {
+    if (UART_FR & UART_FR_TXFF) {
+      break;
+    }
+    UART_DR = (uint8_t)tx_buf[tail & (UART_TX_BUF_SIZE - 1U)];
+    tail++;
+  }
+  tx_tail = tail;
+  if (tail == head) {
+    UART_IMSC &= ~UART_INT_TX;
+  } else {
+    UART_IMSC |= UART_INT_TX;
+  }
+}
+
+static void uart_tx_kick (void)
+{
+  uint32_t cpsr = irq_save();
+  uart_tx_fill();
+  irq_restore(cpsr);
+}
+
+static void uart_irq (void)
+{
+  uint32_t mis = UART_MIS;
+
+  if (mis & (UART_INT_RX | UART_INT_RT | UART_INT_OE)) {
+    while (!(UART_FR & UART_FR_RXFE)) {
+      uint32_t data = UART_DR;
+      uint32_t head = rx_head;
+      if (data & UART_DR_OE) {
+        uart_stats.rx_overrun++;
+      }
+      if (head - rx_tail == UART_RX_BUF_SIZE) {
+        uart_stats.rx_dropped++;
+        continue;
+      }
+      rx_buf[head & (UART_RX_BUF_SIZE - 1U)] = (char)data;
+      rx_head = head + 1U;
+    }
+    UART_ICR = UART_INT_RX | UART_INT_RT | UART_INT_OE;
+  }
+  if (mis & UART_INT_TX) {
+    uart_tx_fill();
+  }
+}
+
+void uart_init (void)
+{
+  UART_CR = 0U;
+  UART_IMSC = 0U;
+  UART_ICR = 0x7ffU;
+  /* baud rate is left as set up by the boot loader, QEMU ignores it */
+  UART_LCR_H = UART_LCR_H_WLEN8 | UART_LCR_H_FEN;
+  /* TX and RX interrupts at half full */
+  UART_IFLS = (2U << 3) | 2U;
+  UART_CR = UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE;
+  UART_IMSC = UART_INT_RX | UART_INT_RT | UART_INT_OE;
+  irq_register(IRQ_UART0, uart_irq);
+  /* send whatever was printed before */
+  uart_tx_kick();
+}
+
+enum uart_tx_policy uart_set_tx_policy (enum uart_tx_policy policy)
+{
+  enum uart_tx_policy old = tx_policy;
+  tx_policy = policy;
+  return old;
+}
+
+int uart_write (const char *buf, int len)
+{
+  int done = 0;
+
+  if (len <= 0) {
+    return 0;
+  }
+  if (tx_policy == UART_TX_DROP &&
+      (uint32_t)len > UART_TX_BUF_SIZE - (tx_head - tx_tail)) {
+    /* keep lines whole: drop all of it rather than a tail */
+    uart_stats.tx_dropped += (uint32_t)len;
+    return len;
+  }
+  while (done < len) {
+    uint32_t head = tx_head;
+    uint32_t room = UART_TX_BUF_SIZE - (head - tx_tail);
+    uint32_t i;
+
+    if (room == 0U) {
+      /* UART_TX_BLOCK: feed the FIFO ourselves in case IRQs are masked */
+      uart_tx_kick();
+      continue;
+    }
+    if (room > (uint32_t)(len - done)) {
+      room = (uint32_t)(len - done);
+    }
+    for (i = 0U; i < room; i++) {
+      tx_buf[(head + i) & (UART_TX_BUF_SIZE - 1U)] = buf[done + (int)i];
+    }
+    tx_head = head + room;
+    done += (int)room;
+  }
+  uart_tx_kick();
+  return len;
+}
+
+int uart_read (char *buf, int len)
+{
+  uint32_t tail = rx_tail;
+  uint32_t head = rx_head;
+  int n = 0;
+
+  while (n < len && tail != head) {
+    buf[n++] = rx_buf[tail & (UART_RX_BUF_SIZE - 1U)];
+    tail++;
+  }
+  rx_tail = tail;
+  return n;
+}
+
+int uart_getc (void)
+{
+  char c;
+
+  if (uart_read(&c, 1) == 0) {
+    return -1;
+  }
+  return (uint8_t)c;
+}
+
+void uart_flush (void)
+{
+  while (tx_head != tx_tail) {
+    uart_tx_kick();
+  }
+}
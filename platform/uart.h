@@ -0,0 +1,55 @@
+#ifndef __uart__
+#define __uart__
+
+#include <stdint.h>
+
+/* Console TX ring size in bytes, a power of two. */
+#ifndef UART_TX_BUF_SIZE
+#define UART_TX_BUF_SIZE 4096U
+#endif
+
+/* Console RX ring size in bytes, a power of two. */
+#ifndef UART_RX_BUF_SIZE
+#define UART_RX_BUF_SIZE 256U
+#endif
+
+/* What uart_write() does when the TX ring has no room for a write. */
+enum uart_tx_policy {
+  UART_TX_DROP,		/* discard the whole write and count it */
+  UART_TX_BLOCK		/* wait, feeding the FIFO by polling if needed */
+};
+
+#ifndef UART_TX_POLICY_DEFAULT
+#define UART_TX_POLICY_DEFAULT UART_TX_DROP
+#endif
+
+struct uart_stats {
+  uint32_t tx_dropped;	/* bytes discarded by UART_TX_DROP */
+  uint32_t rx_dropped;	/* bytes lost because the RX ring was full */
+  uint32_t rx_overrun;	/* bytes lost in the hardware FIFO */
+};
+
+extern struct uart_stats uart_stats;
+
+/* Set up UART0 with FIFOs and register its interrupt. Needs irq_init(). */
+void uart_init (void);
+
+/* Returns the previous policy. */
+enum uart_tx_policy uart_set_tx_policy (enum uart_tx_policy policy);
+
+/* Queue len bytes for transmission and return without waiting for the
+ * line, unless the policy is UART_TX_BLOCK and the ring is full.
+ * Single producer: do not call from interrupt handlers. */
+int uart_write (const char *buf, int len);
+
+/* Copy up to len received bytes to buf, returns 0 if there are none. */
+int uart_read (char *buf, int len);
+
+/* Next received byte or -1. */
+int uart_getc (void);
+
+/* Wait until everything queued has been handed to the UART FIFO, e.g.
+ * before a reset. Works with interrupts masked. */
+void uart_flush (void);
+
+#endif
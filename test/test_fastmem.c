@@ -0,0 +1,49 @@
+/* Host check of platform/fastmem.c against the C library for all sizes up
+ * to a full Ethernet frame and all source/destination alignments. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fastmem.h"
+
+#define MAX_SIZE 1514U
+#define GUARD    16U
+
+static uint8_t src[MAX_SIZE + 2U * GUARD];
+static uint8_t dst[MAX_SIZE + 2U * GUARD];
+static uint8_t ref[MAX_SIZE + 2U * GUARD];
+
+int main (void)
+{
+  unsigned int size, da, sa, i;
+  unsigned int errors = 0U;
+
+  for (i = 0U; i < sizeof(src); i++) {
+    src[i] = (uint8_t)(i * 7U + 1U);
+  }
+  for (size = 0U; size <= MAX_SIZE; size++) {
+    for (da = 0U; da < 8U; da++) {
+      for (sa = 0U; sa < 8U; sa++) {
+        memset(dst, 0xa5, sizeof(dst));
+        memset(ref, 0xa5, sizeof(ref));
+        memcpy(ref + GUARD + da, src + GUARD + sa, size);
+        if (fast_memcpy(dst + GUARD + da, src + GUARD + sa, size) != dst + GUARD + da ||
+            memcmp(dst, ref, sizeof(dst)) != 0) {
+          printf("fast_memcpy: size %u dst-align %u src-align %u failed\n", size, da, sa);
+          errors++;
+        }
+      }
+      memset(dst, 0xa5, sizeof(dst));
+      memset(ref, 0xa5, sizeof(ref));
+      memset(ref + GUARD + da, 0x3c, size);
+      if (fast_memset(dst + GUARD + da, 0x3c, size) != dst + GUARD + da ||
+          memcmp(dst, ref, sizeof(dst)) != 0) {
+        printf("fast_memset: size %u align %u failed\n", size, da);
+        errors++;
+      }
+    }
+  }
+  printf("test_fastmem: %u errors\n", errors);
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""End-to-end throughput and latency benchmark of the firmware.
+
+Boots obj/app.bin in qemu-system-arm with user mode networking, so no
+root and no tap device are needed, and forwards host ports to the lwiperf
+server (port 5001) and the echo responder (port 7) that app.c starts with
+CONFIG_BENCH. Then measures:
+
+  tcp_rx_mbps   host -> target TCP throughput (lwiperf receives)
+  tcp_tx_mbps   target -> host TCP throughput (lwiperf connects back)
+  udp_echo_pps  UDP echo round trips per second with a window of packets
+  udp_rtt_us    UDP echo round trip percentiles, one packet at a time
+  tcp_rtt_us    TCP echo round trip percentiles, one message at a time
+
+and prints them as JSON. With --target HOST the image is not started and
+HOST (real hardware, or obj/host/app) is measured directly.
+"""
+
+import argparse
+import json
+import os
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+LWIPERF_PORT = 5001
+ECHO_PORT = 7
+# lwiperf_settings_t flags
+ANSWER_TEST = 0x80000000
+ANSWER_NOW = 0x00000001
+# iperf2 sends its settings at the start of every 128KB buffer
+IPERF_BUF = 128 * 1024
+
+
+def free_port(kind):
+    with socket.socket(socket.AF_INET, kind) as s:
+        s.bind(('127.0.0.1', 0))
+        return s.getsockname()[1]
+
+
+def percentiles(samples):
+    samples = sorted(samples)
+    pick = lambda q: samples[min(len(samples) - 1, int(q * len(samples)))]
+    return {'p50': pick(0.50), 'p90': pick(0.90), 'p99': pick(0.99), 'max': samples[-1],
+            'count': len(samples)}
+
+
+def iperf_header(flags, port, seconds):
+    # flags, num_threads, remote_port, buffer_len, win_band, amount
+    # a negative amount is a duration in 10ms units
+    return struct.pack('>IIIIIi', flags, 1, port, 0, 0, -int(seconds * 100))
+
+
+def tcp_rx(host, port, seconds):
+    buf = bytearray(b'0123456789' * (IPERF_BUF // 10 + 1))[:IPERF_BUF]
+    buf[:24] = iperf_header(0, 0, seconds)
+    sent = 0
+    with socket.create_connection((host, port), timeout=10) as s:
+        start = time.monotonic()
+        while time.monotonic() - start < seconds:
+            s.sendall(buf)
+            sent += len(buf)
+        s.shutdown(socket.SHUT_WR)
+        # lwiperf closes once it has read everything
+        while s.recv(4096):
+            pass
+        elapsed = time.monotonic() - start
+    return sent * 8 / elapsed / 1e6
+
+
+def tcp_tx(host, port, back_port, seconds):
+    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as lsock:
+        lsock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        lsock.bind(('', back_port))
+        lsock.listen(1)
+        lsock.settimeout(10)
+        with socket.create_connection((host, port), timeout=10) as ctrl:
+            ctrl.sendall(iperf_header(ANSWER_TEST | ANSWER_NOW, back_port, seconds))
+            conn, _ = lsock.accept()
+            with conn:
+                conn.settimeout(seconds + 10)
+                received = 0
+                start = time.monotonic()
+                while True:
+                    data = conn.recv(65536)
+                    if not data:
+                        break
+                    received += len(data)
+                elapsed = time.monotonic() - start
+    return received * 8 / elapsed / 1e6
+
+
+def udp_rate(host, port, seconds, window=16, size=64):
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect((host, port))
+        s.settimeout(0.2)
+        payload = bytes(size)
+        echoed = 0
+        start = time.monotonic()
+        while time.monotonic() - start < seconds:
+            for _ in range(window):
+                s.send(payload)
+            for _ in range(window):
+                try:
+                    s.recv(2048)
+                    echoed += 1
+                except socket.timeout:
+                    break
+        return echoed / (time.monotonic() - start)
+
+
+def udp_rtt(host, port, count, size=64):
+    rtts = []
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect((host, port))
+        s.settimeout(1.0)
+        for i in range(count):
+            payload = struct.pack('>I', i) + bytes(size - 4)
+            start = time.perf_counter_ns()
+            s.send(payload)
+            try:
+                while s.recv(2048)[:4] != payload[:4]:
+                    pass
+            except socket.timeout:
+                continue
+            rtts.append((time.perf_counter_ns() - start) // 1000)
+    return percentiles(rtts) if rtts else None
+
+
+def tcp_rtt(host, port, count, size=64):
+    rtts = []
+    with socket.create_connection((host, port), timeout=5) as s:
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        payload = bytes(size)
+        for _ in range(count):
+            start = time.perf_counter_ns()
+            s.sendall(payload)
+            got = 0
+            while got < size:
+                data = s.recv(size - got)
+                if not data:
+                    raise ConnectionError('echo connection closed')
+                got += len(data)
+            rtts.append((time.perf_counter_ns() - start) // 1000)
+    return percentiles(rtts)
+
+
+def wait_ready(host, port, timeout):
+    """Wait until the echo responder answers, i.e. the target has an address."""
+    deadline = time.monotonic() + timeout
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.settimeout(0.25)
+        while time.monotonic() < deadline:
+            s.sendto(b'ready?', (host, port))
+            try:
+                s.recvfrom(64)
+                return True
+            except (socket.timeout, ConnectionRefusedError):
+                pass
+    return False
+
+
+def start_qemu(opts, ports):
+    fwd = ','.join(f'hostfwd={proto}:127.0.0.1:{host}-:{guest}'
+                   for proto, host, guest in ports)
+    cmd = [opts.qemu, '-M', 'versatilepb', '-m', '128M', '-display', 'none',
+           '-serial', f'file:{opts.console}', '-monitor', 'none',
+           '-net', 'nic', '-net', f'user,{fwd}', '-kernel', opts.kernel]
+    return subprocess.Popen(cmd, stdin=subprocess.DEVNULL)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--qemu', default='qemu-system-arm')
+    ap.add_argument('--kernel', default='obj/app.bin')
+    ap.add_argument('--console', default='obj/bench-console.log',
+                    help='where the serial output of the target goes')
+    ap.add_argument('--target', metavar='HOST', help='measure HOST instead of starting QEMU')
+    ap.add_argument('--time', type=float, default=10.0, help='seconds per throughput test')
+    ap.add_argument('--count', type=int, default=1000, help='round trips per latency test')
+    ap.add_argument('--json', metavar='FILE', help='also write the results to FILE')
+    opts = ap.parse_args()
+
+    qemu = None
+    back_port = free_port(socket.SOCK_STREAM)
+    if opts.target:
+        host, iperf_port, echo_port = opts.target, LWIPERF_PORT, ECHO_PORT
+    else:
+        host = '127.0.0.1'
+        iperf_port = free_port(socket.SOCK_STREAM)
+        echo_port = free_port(socket.SOCK_STREAM)
+        qemu = start_qemu(opts, [('tcp', iperf_port, LWIPERF_PORT),
+                                 ('tcp', echo_port, ECHO_PORT),
+                                 ('udp', echo_port, ECHO_PORT)])
+    try:
+        start = time.monotonic()
+        if not wait_ready(host, echo_port, 60):
+            sys.exit('bench: target does not answer on the echo port')
+        results = {'ready_s': round(time.monotonic() - start, 3)}
+        results['tcp_rx_mbps'] = round(tcp_rx(host, iperf_port, opts.time), 3)
+        # lwiperf connects back to 10.0.2.2, which QEMU maps to the host
+        results['tcp_tx_mbps'] = round(tcp_tx(host, iperf_port, back_port, opts.time), 3)
+        results['udp_echo_pps'] = round(udp_rate(host, echo_port, opts.time), 1)
+        results['udp_rtt_us'] = udp_rtt(host, echo_port, opts.count)
+        results['tcp_rtt_us'] = tcp_rtt(host, echo_port, opts.count)
+    finally:
+        if qemu:
+            qemu.terminate()
+            qemu.wait()
+
+    text = json.dumps(results, indent=2, sort_keys=True)
+    print(text)
+    if opts.json:
+        with open(opts.json, 'w') as f:
+            f.write(text + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,50 @@
+"""Just enough of ELF32 for the host tools: constant data and symbols."""
+
+import struct
+import sys
+
+SHT_PROGBITS = 1
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+
+class Elf:
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            sys.exit(f'{path}: not an ELF32 file')
+        self.end = '<' if self.data[5] == 1 else '>'
+        shoff, = struct.unpack_from(self.end + 'I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from(self.end + 'HH', self.data, 0x2e)
+        self.headers = [struct.unpack_from(self.end + 'IIIIIIIIII', self.data, shoff + i * shentsize)
+                        for i in range(shnum)]
+        # (addr, offset, size) of sections with contents in the image
+        self.sections = [(h[3], h[4], h[5]) for h in self.headers if h[1] == SHT_PROGBITS and h[3]]
+
+    def string(self, addr):
+        """The NUL terminated string at addr, None if not in the image."""
+        for base, offset, size in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                stop = self.data.find(b'\0', start, offset + size)
+                if stop < 0:
+                    return None
+                return self.data[start:stop].decode('latin-1')
+        return None
+
+    def functions(self):
+        """Sorted (addr, size, name) of all function symbols."""
+        funcs = []
+        for h in self.headers:
+            if h[1] != SHT_SYMTAB:
+                continue
+            strtab = self.headers[h[6]]
+            for off in range(h[4], h[4] + h[5], h[9]):
+                name, value, size, info, _, shndx = struct.unpack_from(self.end + 'IIIBBH', self.data, off)
+                if info & 0xf != STT_FUNC or shndx == 0:
+                    continue
+                start = strtab[4] + name
+                funcs.append((value & ~1, size, self.data[start:self.data.find(b'\0', start)].decode()))
+        return sorted(set(funcs))
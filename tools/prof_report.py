@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Flat and call-site profiles from the samples of platform/profiler.c.
+
+Each sample is the interrupted pc and lr. The pc gives the flat profile.
+The lr gives the caller as long as the interrupted function has not
+called anything yet, so the call-site profile is approximate for
+non-leaf functions.
+
+Press 's' on the console, run the load, press 'd' and save the output:
+
+  prof_report.py obj/app.elf console.log [--map obj/app.map]
+"""
+
+import argparse
+import bisect
+import collections
+import re
+
+from elf32 import Elf
+
+MAP_SECTION = re.compile(r'^ (\.text\S*)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)$', re.M)
+
+
+class Symbols:
+
+    def __init__(self, funcs):
+        self.funcs = funcs
+        self.starts = [f[0] for f in funcs]
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i < 0:
+            return '?'
+        start, size, name = self.funcs[i]
+        # assembler labels have no size, they run up to the next symbol
+        if size and addr >= start + size:
+            return '?'
+        return name
+
+
+def map_objects(path):
+    """Sorted (addr, size, object file) of the code input sections."""
+    with open(path) as f:
+        # long section names put the address on the next line
+        text = re.sub(r'^ (\.text\S*)\n\s+', r' \1 ', f.read(), flags=re.M)
+    objs = [(int(a, 16), int(s, 16), o) for _, a, s, o in MAP_SECTION.findall(text) if int(s, 16)]
+    return Symbols(sorted(objs))
+
+
+def read_samples(path):
+    with open(path, errors='replace') as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 3 and fields[0] == 'prof:' and fields[1] not in ('begin', 'end'):
+                yield int(fields[1], 16), int(fields[2], 16)
+
+
+def table(title, counter, total, top):
+    print(f'\n{title}')
+    print(f'{"samples":>8} {"%":>6}  name')
+    for key, n in counter.most_common(top):
+        print(f'{n:8d} {100.0 * n / total:6.2f}  {key}')
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('elf', help='the image that was sampled, obj/app.elf')
+    ap.add_argument('log', help='console output containing prof_dump()')
+    ap.add_argument('--map', help='linker map (obj/app.map) for a per-object profile')
+    ap.add_argument('--top', type=int, default=30, help='lines per table')
+    opts = ap.parse_args()
+
+    syms = Symbols(Elf(opts.elf).functions())
+    objs = map_objects(opts.map) if opts.map else None
+    flat = collections.Counter()
+    sites = collections.Counter()
+    files = collections.Counter()
+    total = 0
+    for pc, lr in read_samples(opts.log):
+        total += 1
+        func = syms.lookup(pc)
+        caller = syms.lookup(lr)
+        flat[func] += 1
+        if caller != func:
+            sites[f'{caller} -> {func}'] += 1
+        if objs:
+            files[objs.lookup(pc)] += 1
+    if not total:
+        raise SystemExit(f'{opts.log}: no "prof:" samples')
+
+    print(f'{total} samples')
+    table('flat profile', flat, total, opts.top)
+    table('call sites (caller -> sampled function)', sites, total, opts.top)
+    if objs:
+        table('by object file', files, total, opts.top)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Render the binary trace records of platform/trace.c.
+
+The target stores the address of each printf() format string, a
+microsecond timestamp and the raw argument words. The strings are read
+back from the ELF image here.
+
+  trace_decode.py obj/app.elf console.log     # lines from trace_dump()
+  trace_decode.py obj/app.elf --udp 10.0.2.99 # ask trace_udp_init()
+"""
+
+import argparse
+import re
+import socket
+import struct
+
+from elf32 import Elf
+
+TRACE_UDP_PORT = 7777
+CONV = re.compile(r'%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|z|t|j)?([diouxXcspn%])')
+
+
+def render(elf, fmt_addr, args):
+    fmt = elf.string(fmt_addr)
+    if fmt is None:
+        return f'<unknown format 0x{fmt_addr:08x}> ' + ' '.join(f'{a:x}' for a in args)
+    args = list(args)
+
+    def conv(m):
+        flags, width, prec, length, kind = m.groups()
+        if kind == '%':
+            return '%'
+        if kind == 'n' or width == '*' or prec == '*':
+            return m.group(0)
+        if not args:
+            return '?'
+        value = args.pop(0)
+        wide = length in ('ll', 'j') and kind in 'diouxX'
+        if wide:
+            # stored low word first in two slots by trace_write()
+            value |= (args.pop(0) if args else 0) << 32
+        spec = '%' + flags + (width or '') + ('.' + prec if prec else '')
+        if kind in 'di':
+            if wide:
+                value -= (value & 0x8000000000000000) << 1
+            elif length == 'hh':
+                value = (value & 0xff) - ((value & 0x80) << 1)
+            elif length == 'h':
+                value = (value & 0xffff) - ((value & 0x8000) << 1)
+            else:
+                value -= (value & 0x80000000) << 1
+            return (spec + 'd') % value
+        if kind in 'ouxX':
+            if length == 'hh':
+                value &= 0xff
+            elif length == 'h':
+                value &= 0xffff
+            return (spec + kind) % value
+        if kind == 'c':
+            return (spec + 'c') % chr(value & 0xff)
+        if kind == 'p':
+            return f'0x{value:08x}'
+        text = elf.string(value)
+        return (spec + 's') % (text if text is not None else f'<0x{value:08x}>')
+
+    return CONV.sub(conv, fmt)
+
+
+def from_log(path):
+    with open(path, errors='replace') as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) < 4 or fields[0] != 'trace:' or fields[1] in ('begin', 'end'):
+                continue
+            words = [int(x, 16) for x in fields[1:]]
+            yield words[0], words[1], words[2], words[3:]
+
+
+def from_udp(host, port, first):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(1.0)
+    sock.sendto(struct.pack('<I', first), (host, port))
+    while True:
+        try:
+            data, _ = sock.recvfrom(2048)
+        except socket.timeout:
+            return
+        magic, seq, head, count, nargs, rec_size = struct.unpack_from('<4sIIHBB', data)
+        if magic != b'LWTR':
+            continue
+        for i in range(count):
+            rec = struct.unpack_from(f'<II{nargs}I', data, 16 + i * rec_size)
+            yield seq + i, rec[1], rec[0], rec[2:]
+        if seq + count == head:
+            return
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('elf', help='the image running on the target, obj/app.elf')
+    ap.add_argument('log', nargs='?', help='console output containing trace_dump()')
+    ap.add_argument('--udp', metavar='HOST', help='fetch the ring from HOST')
+    ap.add_argument('--port', type=int, default=TRACE_UDP_PORT)
+    ap.add_argument('--from', dest='first', type=int, default=0,
+                    help='first sequence number wanted (--udp)')
+    opts = ap.parse_args()
+    if (opts.log is None) == (opts.udp is None):
+        ap.error('give either a log file or --udp')
+
+    elf = Elf(opts.elf)
+    records = from_udp(opts.udp, opts.port, opts.first) if opts.udp else from_log(opts.log)
+    last = None
+    for seq, ts, fmt, args in records:
+        delta = 0 if last is None else (ts - last) & 0xffffffff
+        last = ts
+        text = render(elf, fmt, args).rstrip('\n')
+        print(f'{seq:8d} {ts / 1e6:12.6f} +{delta:<8d} {text}')
+
+
+if __name__ == '__main__':
+    main()